@@ -0,0 +1,145 @@
+#pragma once
+
+#include "vtex/PageFormat.h"
+#include "vtex/FlatHashMap.h"
+
+#include <textile/Page.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vtex
+{
+
+class PageSource;
+class UploadScheduler;
+
+// Reads and decodes pages on worker threads. The number of pages in
+// flight is bounded, finished pages wait in a lock-free queue until the
+// render thread drains them. Requests are identified by a caller chosen
+// key and may come from different sources with the same page size.
+// Pages in another format than the loader's are transcoded on the
+// workers. Everything except the workers runs on the render thread.
+class AsyncPageLoader : private boost::noncopyable
+{
+public:
+	AsyncPageLoader(PageFormat fmt, size_t page_size, int thread_n, int max_in_flight);
+	~AsyncPageLoader();
+
+	// false if the key is already in flight or no slot is free
+	bool Submit(PageSource& src, const textile::Page& page, uint64_t key);
+
+	// the page is dropped when its load finishes
+	void Cancel(uint64_t key);
+	void CancelIf(const std::function<bool(uint64_t key)>& pred);
+
+	bool IsLoading(uint64_t key) const;
+
+	// hands finished pages to cb while the scheduler's budget allows
+	int Drain(const std::function<void(uint64_t key, const textile::Page& page, const uint8_t* data)>& cb,
+		UploadScheduler& sched);
+
+	// blocks until the workers hold no request
+	void WaitIdle();
+	// blocks only while a worker is reading a page from src, at most
+	// one page per worker, cancelled loads that have not started never
+	// touch it, so src can be destroyed after cancelling its loads
+	void WaitReads(const PageSource& src);
+
+	int GetInFlightCount() const { return static_cast<int>(m_in_flight.Size()); }
+	int GetMaxInFlight() const { return static_cast<int>(m_slots.size()); }
+
+	PageFormat GetPageFormat() const { return m_format; }
+	size_t GetPageSize() const { return m_page_size; }
+	// bytes of one finished page, in the loader's format
+	size_t GetPageBytes() const { return m_page_bytes; }
+
+private:
+	struct Slot
+	{
+		PageSource* src = nullptr;
+		textile::Page page;
+		uint64_t key = 0;
+
+		uint8_t* data = nullptr;
+		// the finished page, data or the memory of a zero copy source
+		const uint8_t* mapped = nullptr;
+		bool succeed = false;
+
+		float decode_ms = 0;
+
+		std::atomic<bool> cancelled;
+		// a worker is reading from src, guarded by m_pending_mtx
+		bool reading = false;
+	};
+
+	// bounded multi producer queue of slot indices
+	class CompletionQueue : private boost::noncopyable
+	{
+	public:
+		explicit CompletionQueue(size_t capacity);
+
+		bool Push(int val);
+		bool Pop(int& val);
+
+		// exact only when no push is in progress
+		size_t Size() const;
+
+	private:
+		struct Cell
+		{
+			std::atomic<size_t> seq;
+			int val;
+		};
+
+	private:
+		std::unique_ptr<Cell[]> m_cells;
+		size_t m_mask;
+
+		std::atomic<size_t> m_enqueue_pos;
+		std::atomic<size_t> m_dequeue_pos;
+
+	}; // CompletionQueue
+
+private:
+	void WorkerLoop();
+
+	void FreeSlot(int slot);
+
+private:
+	PageFormat m_format;
+	size_t m_page_size;
+	size_t m_page_bytes;
+
+	std::vector<Slot> m_slots;
+	std::vector<int>  m_free_slots;
+	uint8_t* m_buf = nullptr;
+
+	// key to slot, render thread only
+	FlatHashMap<uint64_t, int> m_in_flight;
+
+	std::mutex              m_pending_mtx;
+	std::condition_variable m_pending_cv;
+	std::condition_variable m_idle_cv;
+	// fifo of slots, a slot is queued at most once
+	std::vector<int>        m_pending;
+	size_t                  m_pending_head = 0;
+	size_t                  m_pending_n = 0;
+	int                     m_busy = 0;
+	bool                    m_stop = false;
+
+	CompletionQueue m_done;
+
+	std::vector<std::thread> m_threads;
+
+}; // AsyncPageLoader
+
+}
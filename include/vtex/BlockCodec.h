@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+namespace vtex
+{
+
+// CPU encoders and decoders for single 4x4 blocks, `rgba` is 16 texels
+// row by row. The encoders fit endpoints along the principal axis of
+// the block, good enough for transcoding on the loader threads, not a
+// replacement for an offline compressor.
+class BlockCodec
+{
+public:
+	static void EncodeBC1(const uint8_t* rgba, uint8_t* dst);
+	static void EncodeBC3(const uint8_t* rgba, uint8_t* dst);
+	// always writes mode 6, one subset with rgba endpoints
+	static void EncodeBC7(const uint8_t* rgba, uint8_t* dst);
+
+	static void DecodeBC1(const uint8_t* src, uint8_t* rgba);
+	static void DecodeBC3(const uint8_t* src, uint8_t* rgba);
+	// only mode 6, false for blocks in any other mode
+	static bool DecodeBC7(const uint8_t* src, uint8_t* rgba);
+
+}; // BlockCodec
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "vtex/ReplacementPolicy.h"
+#include "vtex/RequestSet.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vtex
+{
+
+// Replays recorded request streams against a replacement policy on a
+// cache of `capacity` slots, loads of a frame finish within that frame.
+// A model of the policy alone, not of PageCache: misses load most
+// requested first instead of in LoadQueue's count, age and mip order,
+// no levels are pinned, victims are not limited to leaf pages and
+// there is no in-flight limit, only loads_per_frame. Its hit rates rank
+// policies against each other, TraceReplayer measures the real cache.
+class CacheSimulator
+{
+public:
+	struct Result
+	{
+		std::string policy;
+
+		int64_t requests  = 0;
+		int64_t hits      = 0;
+		int64_t misses    = 0;
+		int64_t loads     = 0;
+		int64_t evictions = 0;
+
+		float HitRate() const {
+			return requests > 0 ? static_cast<float>(hits) / requests : 0.0f;
+		}
+	};
+
+public:
+	// loads_per_frame 0 is unlimited
+	CacheSimulator(int capacity, int loads_per_frame = 0);
+
+	Result Run(ReplacementPolicy& policy, const std::vector<RequestFrame>& frames) const;
+
+	// every built in policy
+	std::vector<Result> RunAll(const std::vector<RequestFrame>& frames) const;
+
+private:
+	int m_capacity;
+	int m_loads_per_frame;
+
+}; // CacheSimulator
+
+}
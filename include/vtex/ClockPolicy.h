@@ -0,0 +1,35 @@
+#pragma once
+
+#include "vtex/ReplacementPolicy.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace vtex
+{
+
+// Second chance: the hand clears reference bits until it finds a slot
+// that wasn't touched since its last pass.
+class ClockPolicy : public ReplacementPolicy
+{
+public:
+	virtual void Reset(int slot_n) override;
+
+	virtual void OnInsert(int slot) override;
+	virtual void OnRemove(int slot) override;
+
+	virtual void OnTouch(int slot, int count) override;
+
+	virtual int SelectVictim(const std::function<bool(int slot)>& evictable) override;
+
+	virtual const char* GetName() const override { return "clock"; }
+
+private:
+	std::vector<uint8_t> m_resident;
+	std::vector<uint8_t> m_referenced;
+
+	int m_hand = 0;
+
+}; // ClockPolicy
+
+}
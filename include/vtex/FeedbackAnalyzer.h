@@ -0,0 +1,71 @@
+#pragma once
+
+#include "vtex/RequestSet.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace textile { class PageIndexer; }
+
+namespace vtex
+{
+
+// Reduces the RGBA8 feedback image to unique (x, y, mip) keys first,
+// then expands the parent chain level by level, so the indexer is
+// called once per distinct page instead of once per pixel and mip.
+class FeedbackAnalyzer : private boost::noncopyable
+{
+public:
+	FeedbackAnalyzer(const textile::PageIndexer& indexer, int max_mip);
+
+	// pixels: pixel_n RGBA8 texels, x/y/mip in rgb, alpha 255 if valid
+	// adds every page and its parents to requests
+	void Analyze(const uint8_t* pixels, size_t pixel_n, RequestSet& requests);
+
+	int GetMaxMip() const { return m_max_mip; }
+
+	// keys of the last `frames` analyses are merged into the requests,
+	// for feedback that samples another subset of the pixels each frame
+	void SetHistory(int frames);
+	int GetHistory() const { return m_history.empty() ? 1 : static_cast<int>(m_history.size()); }
+
+	// unique keys found by the last Analyze()
+	size_t GetUniqueCount() const { return m_unique_n; }
+
+private:
+	struct Item
+	{
+		uint32_t key;
+		uint32_t count;
+	};
+
+	void CollectKeys(const uint8_t* pixels, size_t pixel_n);
+	void MergeHistory();
+	void ExpandKeys(RequestSet& requests);
+
+	void InsertKey(uint32_t key, uint32_t count);
+	void ResetTable();
+	void Grow();
+
+private:
+	const textile::PageIndexer& m_indexer;
+
+	int m_max_mip;
+
+	// open addressing, key 0 is empty (valid keys always have alpha set)
+	std::vector<Item>     m_table;
+	std::vector<uint32_t> m_used;
+
+	std::vector<std::vector<Item>> m_levels;
+
+	// ring of the earlier frames' keys, empty without history
+	std::vector<std::vector<Item>> m_history;
+	int m_history_next = 0;
+
+	size_t m_unique_n = 0;
+
+}; // FeedbackAnalyzer
+
+}
@@ -1,6 +1,9 @@
 #pragma once
 
-#include <unirender/typedef.h>
+#include "vtex/FeedbackAnalyzer.h"
+#include "vtex/FeedbackWorker.h"
+#include "vtex/ReadbackRing.h"
+#include "vtex/RenderBackend.h"
 
 #include <boost/noncopyable.hpp>
 
@@ -9,42 +12,102 @@
 #include <vector>
 
 namespace textile { class PageIndexer; }
-namespace ur { class Device; class Framebuffer; }
 
 namespace vtex
 {
 
+// With a subsample of n the pass renders a (size / n)^2 target, each
+// of its pixels samples one pixel of an n x n block of the size^2
+// image, at a jitter that visits every position of the block once per
+// n * n frames, in an order shuffled every round. The keys of the last
+// n * n frames are merged, so the requests converge to the ones of
+// the full image while reading back and analyzing 1 / n^2 of it.
 class FeedbackBuffer : private boost::noncopyable
 {
 public:
-	FeedbackBuffer(const ur::Device& dev, int size, int page_table_w,
-        int page_table_h, const textile::PageIndexer& indexer);
+	FeedbackBuffer(RenderBackend& backend, int size, int page_table_w,
+        int page_table_h, const textile::PageIndexer& indexer, int latency = 0,
+		int subsample = 1);
 	~FeedbackBuffer();
 
-	void BindRT();
+	// also picks the frame's jitter
+	void BindRT(uint64_t frame);
 	void UnbindRT();
 
-	void Download(const ur::Device& dev);
-
-	const std::vector<int>& GetRequests() const { return m_requests; }
+	// reads back the feedback rendered `latency` frames ago,
+	// returns false while the ring is still filling up, or when async
+	// while no newer analysis was published
+	bool Download(uint64_t frame);
+
+	// analyze on a FeedbackWorker, Download() then only reads back and
+	// picks up the worker's latest result, usually of an earlier one
+	void SetAsync(bool async);
+	bool IsAsync() const { return m_worker != nullptr; }
+	// blocks until the worker published every readback, async only
+	void WaitAnalysis();
+
+	const RequestSet& GetRequests() const {
+		return m_worker ? m_worker->GetResult().requests : m_requests;
+	}
+	// frame the current requests were rendered in
+	uint64_t GetRequestsFrame() const {
+		return m_worker ? m_worker->GetResult().frame : m_requests_frame;
+	}
+	// time spent analyzing them, on the worker if async
+	float GetAnalyzeTime() const {
+		return m_worker ? m_worker->GetResult().analyze_ms : m_analyze_ms;
+	}
 
 	void Clear();
 
-    auto GetTexture() const { return m_fbo_col_tex; }
+    auto GetTexture() const { return m_slots[m_write_slot]->color; }
+
+	int GetLatency() const { return m_ring.GetLatency(); }
+
+	int GetSubsample() const { return m_subsample; }
+	// the render target's, size / subsample
+	int GetTargetSize() const { return m_target_size; }
+	// position sampled in the n x n blocks by the pass of the last
+	// BindRT(), in pixels of the full image
+	int GetJitterX() const { return m_jitter_x; }
+	int GetJitterY() const { return m_jitter_y; }
+
+	// of the last Download(), 0 if it read nothing back
+	size_t GetReadbackBytes() const { return m_readback_bytes; }
 
 private:
+	RenderBackend& m_backend;
+
 	const textile::PageIndexer& m_indexer;
 
 	int m_size;
 	int m_page_table_w, m_page_table_h;
 
-    ur::TexturePtr m_fbo_col_tex = nullptr;
-    ur::TexturePtr m_fbo_depth_tex = nullptr;
-    std::shared_ptr<ur::Framebuffer> m_fbo = nullptr;
+	int m_subsample;
+	int m_target_size;
+
+	// block positions of the current round, y * n + x
+	std::vector<int> m_pattern;
+	uint32_t m_rng_state = 0x9e3779b9;
+	int m_jitter_x = 0, m_jitter_y = 0;
+
+	size_t m_readback_bytes = 0;
+
+	ReadbackRing m_ring;
+
+	std::vector<RenderBackend::RenderTargetPtr> m_slots;
+	int m_write_slot = 0;
+
 	uint8_t* m_data;
 
-	std::vector<int> m_requests;
+	FeedbackAnalyzer m_analyzer;
+
+	RequestSet m_requests;
+	uint64_t m_requests_frame = 0;
+	float m_analyze_ms = 0;
+
+	std::unique_ptr<FeedbackWorker> m_worker = nullptr;
 
 }; // FeedbackBuffer
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "vtex/FeedbackAnalyzer.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace textile { class PageIndexer; }
+
+namespace vtex
+{
+
+// Analyzes read back feedback on its own thread. The render thread
+// fills GetPixels() and calls Submit(), the worker decodes the pixels
+// and expands the mip chains, then publishes the requests. Results are
+// triple buffered, Poll() takes the newest one with a single atomic
+// exchange and never waits for the worker. Everything except the
+// worker runs on the render thread.
+class FeedbackWorker : private boost::noncopyable
+{
+public:
+	struct Result
+	{
+		RequestSet requests;
+		// frame the feedback was rendered in
+		uint64_t frame = 0;
+
+		float analyze_ms = 0;
+	};
+
+public:
+	// history: see FeedbackAnalyzer::SetHistory(), as many submits
+	// wait for the worker, so a frame of every jitter position of a
+	// subsampled feedback reaches the history
+	FeedbackWorker(const textile::PageIndexer& indexer, int max_mip, size_t pixel_n, int history);
+	~FeedbackWorker();
+
+	// RGBA8 buffer of pixel_n texels handed over by the next Submit()
+	uint8_t* GetPixels() { return m_pixels[m_fill].get(); }
+
+	// with history submits waiting already the oldest one is dropped
+	void Submit(uint64_t frame);
+
+	// true if a result was published since the last poll, it stays
+	// in GetResult() until the next successful poll
+	bool Poll();
+
+	const Result& GetResult() const { return m_results[m_front]; }
+	void ClearResult();
+
+	// blocks until every submit is published
+	void WaitIdle();
+
+	// submits dropped before the worker took them
+	int GetDropCount() const { return m_dropped; }
+
+private:
+	void WorkerLoop();
+
+private:
+	static const int FRESH = 4;
+
+private:
+	FeedbackAnalyzer m_analyzer;
+
+	size_t m_pixel_n;
+
+	// history + 2 buffers: filled by the render thread, analyzed by
+	// the worker, the others waiting or free
+	std::vector<std::unique_ptr<uint8_t[]>> m_pixels;
+	int m_fill = 0;
+	int m_work = 1;
+	std::vector<int> m_free;
+
+	struct Pending
+	{
+		int buf = 0;
+		uint64_t frame = 0;
+	};
+
+	// fifo of submits the worker has not taken
+	std::vector<Pending> m_pending;
+	size_t m_pending_head = 0;
+	size_t m_pending_n = 0;
+	int m_dropped = 0;
+
+	std::mutex              m_mtx;
+	std::condition_variable m_work_cv;
+	std::condition_variable m_idle_cv;
+	bool                    m_busy = false;
+	bool                    m_stop = false;
+
+	// render thread, worker, and the one in between with FRESH set
+	// while it holds an unpolled result
+	Result m_results[3];
+	int m_front = 0;
+	int m_back = 1;
+	std::atomic<int> m_ready;
+
+	std::thread m_thread;
+
+}; // FeedbackWorker
+
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vtex
+{
+
+// Integer keys to small values in one array, linear probing with
+// backward shift erase, so erasing leaves no tombstones. Memory is only
+// allocated when the table grows, with Reserve() up front inserts and
+// erases never allocate. Replaces std::unordered_map on the per frame
+// paths, which allocates a node per insert.
+template <typename Key, typename Value>
+class FlatHashMap
+{
+public:
+	explicit FlatHashMap(size_t capacity = 0) {
+		Reserve(capacity);
+	}
+
+	// room for n keys without growing
+	void Reserve(size_t n)
+	{
+		size_t size = MIN_TABLE_SIZE;
+		while (size < n * 2) {
+			size <<= 1;
+		}
+		if (size > m_cells.size()) {
+			Rehash(size);
+		}
+	}
+
+	// false if the key is already there, its value is kept
+	bool Insert(Key key, const Value& val)
+	{
+		if ((m_size + 1) * 2 > m_cells.size()) {
+			Rehash(m_cells.empty() ? MIN_TABLE_SIZE : m_cells.size() * 2);
+		}
+
+		size_t pos = Home(key);
+		while (m_cells[pos].used)
+		{
+			if (m_cells[pos].key == key) {
+				return false;
+			}
+			pos = (pos + 1) & m_mask;
+		}
+
+		auto& c = m_cells[pos];
+		c.key  = key;
+		c.val  = val;
+		c.used = true;
+		++m_size;
+		return true;
+	}
+
+	Value* Find(Key key)
+	{
+		size_t pos = Locate(key);
+		return pos == NPOS ? nullptr : &m_cells[pos].val;
+	}
+	const Value* Find(Key key) const
+	{
+		size_t pos = Locate(key);
+		return pos == NPOS ? nullptr : &m_cells[pos].val;
+	}
+	bool Contains(Key key) const { return Locate(key) != NPOS; }
+
+	bool Erase(Key key)
+	{
+		size_t pos = Locate(key);
+		if (pos == NPOS) {
+			return false;
+		}
+		EraseAt(pos);
+		return true;
+	}
+
+	// fn(key, value)
+	template <typename Fn>
+	void ForEach(Fn fn) const
+	{
+		for (auto& c : m_cells) {
+			if (c.used) {
+				fn(c.key, c.val);
+			}
+		}
+	}
+
+	// erases the keys pred(key, value) is true for
+	template <typename Pred>
+	void EraseIf(Pred pred)
+	{
+		// a shift may move an entry from the front of the table to
+		// the back, it is then tested twice, which is harmless
+		for (size_t i = 0; i < m_cells.size(); )
+		{
+			if (m_cells[i].used && pred(m_cells[i].key, m_cells[i].val)) {
+				EraseAt(i);
+			} else {
+				++i;
+			}
+		}
+	}
+
+	// walks the table, keeps its memory
+	void Clear()
+	{
+		for (auto& c : m_cells) {
+			c.used = false;
+		}
+		m_size = 0;
+	}
+
+	size_t Size() const { return m_size; }
+	bool IsEmpty() const { return m_size == 0; }
+
+private:
+	struct Cell
+	{
+		Key   key  = 0;
+		Value val  = Value();
+		bool  used = false;
+	};
+
+	static const size_t MIN_TABLE_SIZE = 16;
+	static const size_t NPOS = ~size_t(0);
+
+private:
+	size_t Home(Key key) const
+	{
+		uint64_t h = static_cast<uint64_t>(key) * 0x9e3779b97f4a7c15ull;
+		return static_cast<size_t>(h ^ (h >> 32)) & m_mask;
+	}
+
+	size_t Locate(Key key) const
+	{
+		if (m_size == 0) {
+			return NPOS;
+		}
+		size_t pos = Home(key);
+		while (m_cells[pos].used)
+		{
+			if (m_cells[pos].key == key) {
+				return pos;
+			}
+			pos = (pos + 1) & m_mask;
+		}
+		return NPOS;
+	}
+
+	void EraseAt(size_t hole)
+	{
+		// pull back later entries of the run whose home is not
+		// between the hole and them
+		size_t pos = hole;
+		while (true)
+		{
+			pos = (pos + 1) & m_mask;
+			if (!m_cells[pos].used) {
+				break;
+			}
+			size_t home = Home(m_cells[pos].key);
+			if (((pos - home) & m_mask) >= ((pos - hole) & m_mask))
+			{
+				m_cells[hole] = m_cells[pos];
+				hole = pos;
+			}
+		}
+		m_cells[hole].used = false;
+		--m_size;
+	}
+
+	void Rehash(size_t size)
+	{
+		std::vector<Cell> old;
+		old.swap(m_cells);
+
+		m_cells.resize(size);
+		m_mask = size - 1;
+		m_size = 0;
+		for (auto& c : old) {
+			if (c.used) {
+				Insert(c.key, c.val);
+			}
+		}
+	}
+
+private:
+	std::vector<Cell> m_cells;
+	size_t m_mask = 0;
+	size_t m_size = 0;
+
+}; // FlatHashMap
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+
+namespace vtex
+{
+
+// Source image of the tiler, read once from top to bottom so it never
+// has to fit in memory.
+class ImageSource
+{
+public:
+	virtual ~ImageSource() {}
+
+	virtual int GetWidth() const = 0;
+	virtual int GetHeight() const = 0;
+
+	// rows [y, y + n) as RGBA8, called with increasing y
+	virtual bool ReadRows(int y, int n, uint8_t* dst) = 0;
+
+}; // ImageSource
+
+}
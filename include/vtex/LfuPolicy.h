@@ -0,0 +1,53 @@
+#pragma once
+
+#include "vtex/ReplacementPolicy.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace vtex
+{
+
+// Evicts the slot with the lowest request frequency. Frequencies sum the
+// feedback counts and halve every `half_life` frames, so pages that
+// cover much of the screen survive a short absence and old hot pages
+// fade out.
+class LfuPolicy : public ReplacementPolicy
+{
+public:
+	explicit LfuPolicy(float half_life = 8.0f);
+
+	virtual void Reset(int slot_n) override;
+
+	virtual void OnInsert(int slot) override;
+	virtual void OnRemove(int slot) override;
+
+	virtual void OnTouch(int slot, int count) override;
+
+	virtual void OnFrame() override { ++m_frame; }
+
+	virtual int SelectVictim(const std::function<bool(int slot)>& evictable) override;
+
+	virtual const char* GetName() const override { return "lfu"; }
+
+private:
+	float CalcFreq(int slot) const;
+
+private:
+	struct Entry
+	{
+		float freq = 0;
+		uint32_t frame = 0;
+		uint32_t insert_frame = 0;
+		bool resident = false;
+	};
+
+	float m_half_life;
+
+	std::vector<Entry> m_entries;
+
+	uint32_t m_frame = 0;
+
+}; // LfuPolicy
+
+}
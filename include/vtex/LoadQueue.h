@@ -0,0 +1,91 @@
+#pragma once
+
+#include "vtex/FlatHashMap.h"
+
+#include <textile/Page.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace vtex
+{
+
+// Misses of one virtual texture waiting for a loader slot. Pending pages
+// are kept across feedback frames, so how long a page has waited counts
+// towards its priority. Pages missing from a frame went out of view and
+// are dropped. Select() partitions out the best k and sorts only those,
+// O(n + k log k) instead of sorting every miss each frame.
+class LoadQueue : private boost::noncopyable
+{
+public:
+	// priority = count_weight * log2(count) + age_weight * frames waited
+	//          - mip_weight * mip
+	// count is the page's feedback pixel count, its screen coverage
+	struct Config
+	{
+		float mip_weight   = 4.0f;
+		float count_weight = 1.0f;
+		float age_weight   = 0.25f;
+	};
+
+public:
+	explicit LoadQueue(const Config& cfg);
+
+	void BeginFrame(uint64_t frame);
+	// a miss of this frame that is not loading already
+	void Push(const textile::Page& page, int page_idx, int count);
+	// drops the pages not pushed since BeginFrame()
+	void EndFrame();
+
+	// the best k pending pages, best first, they stay pending until
+	// removed
+	const std::vector<textile::Page>& Select(int k);
+
+	// handed to the loader
+	void Remove(int page_idx);
+
+	int GetCount() const { return static_cast<int>(m_items.size()); }
+	// frames the page has been pending, -1 if it is not
+	int GetAge(int page_idx) const;
+
+	void SetConfig(const Config& cfg) { m_cfg = cfg; }
+	const Config& GetConfig() const { return m_cfg; }
+
+	void Clear();
+
+	// room for n pending pages without growing
+	void Reserve(int n);
+
+private:
+	struct Item
+	{
+		textile::Page page;
+		int page_idx;
+		int count;
+
+		uint64_t first_frame;
+		uint64_t last_frame;
+
+		float priority;
+	};
+
+private:
+	void RemoveAt(int pos);
+
+private:
+	Config m_cfg;
+
+	uint64_t m_frame = 0;
+
+	std::vector<Item> m_items;
+	// page idx to position in m_items
+	FlatHashMap<int, int> m_lookup;
+
+	std::vector<int> m_order;
+	std::vector<textile::Page> m_selected;
+
+}; // LoadQueue
+
+}
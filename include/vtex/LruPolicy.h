@@ -0,0 +1,40 @@
+#pragma once
+
+#include "vtex/ReplacementPolicy.h"
+
+#include <vector>
+
+namespace vtex
+{
+
+class LruPolicy : public ReplacementPolicy
+{
+public:
+	virtual void Reset(int slot_n) override;
+
+	virtual void OnInsert(int slot) override;
+	virtual void OnRemove(int slot) override;
+
+	virtual void OnTouch(int slot, int count) override;
+
+	virtual int SelectVictim(const std::function<bool(int slot)>& evictable) override;
+
+	virtual const char* GetName() const override { return "lru"; }
+
+private:
+	void Unlink(int slot);
+	void PushFront(int slot);
+
+private:
+	// linked from most to least recently used
+	struct Node
+	{
+		int prev = -1, next = -1;
+	};
+
+	std::vector<Node> m_nodes;
+	int m_head = -1, m_tail = -1;
+
+}; // LruPolicy
+
+}
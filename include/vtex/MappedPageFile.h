@@ -0,0 +1,61 @@
+#pragma once
+
+#include "vtex/PageSource.h"
+#include "vtex/PageFile.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <string>
+
+namespace textile { class PageIndexer; }
+
+namespace vtex
+{
+
+// PageFile layout read through a memory mapping. Pages that need no
+// expanding are handed to the loader straight from the mapping. The whole file is
+// mapped at once, so multi-GB files need a 64 bit build.
+// Zero copy ends at the atlas: TextureAtlas::UploadPage() copies every
+// page into its staging arena, so neighbours upload in one call. What is
+// saved is the read into a loader buffer, not the copy before upload.
+class MappedPageFile : public PageSource, private boost::noncopyable
+{
+public:
+	MappedPageFile(const std::string& filepath, const textile::PageIndexer& indexer);
+	~MappedPageFile();
+
+	virtual PageFormat GetPageFormat() const override;
+	virtual size_t GetPageBytes() const override;
+
+	virtual bool ReadPage(const textile::Page& page, uint8_t* dst) override;
+
+	virtual const uint8_t* MapPage(const textile::Page& page) override;
+
+	virtual void Prefetch(const textile::Page& page) override;
+
+	virtual bool IsValid() const override { return m_offsets != nullptr; }
+
+private:
+	const uint8_t* FindPage(const textile::Page& page, size_t& size) const;
+
+	void Close();
+
+private:
+	const textile::PageIndexer& m_indexer;
+
+	const uint8_t* m_base = nullptr;
+	size_t m_size = 0;
+
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#else
+	int m_fd = -1;
+#endif // _WIN32
+
+	PageFile::Header m_header = PageFile::Header();
+	const uint64_t* m_offsets = nullptr;
+
+}; // MappedPageFile
+
+}
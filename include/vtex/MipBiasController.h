@@ -0,0 +1,73 @@
+#pragma once
+
+namespace vtex
+{
+
+// Closed loop control of one texture's feedback mip bias. Lowers it
+// while the texture asks for more pages than the atlas holds or keeps
+// evicting what it asked for, raises it again once demand fits easily.
+// The thresholds of the two directions are apart and a condition has
+// to hold for some frames, so the bias does not flip back and forth.
+class MipBiasController
+{
+public:
+	struct Config
+	{
+		int min_bias = 0;
+		int max_bias = 3;
+
+		// requested pages per atlas slot, one bias step changes it
+		// about 4x, raise_pressure below lower_pressure / 4 keeps a
+		// raise from asking for more than a lower gives back
+		float lower_pressure = 0.9f;
+		float raise_pressure = 0.15f;
+
+		// evicted pages of the texture, and finished loads without a
+		// slot, per requested page
+		float lower_thrash = 0.05f;
+		float raise_thrash = 0.01f;
+
+		// feedback frames a condition has to hold before the bias moves
+		int hold_frames = 8;
+
+		// weight of the newest frame in the averages
+		float smoothing = 0.25f;
+	};
+
+public:
+	// bias is clamped to the config's range
+	MipBiasController(const Config& cfg, int bias);
+
+	// once per feedback frame rendered with the current bias, slot_n
+	// is the texture's share of the atlas slots,
+	// returns the change of the bias: -1, 0 or 1
+	int Update(int requested, int thrashed, int slot_n);
+
+	int GetBias() const { return m_bias; }
+	// restarts the averages
+	void SetBias(int bias);
+
+	// smoothed, since the last change
+	float GetPressure() const { return m_pressure; }
+	float GetThrash() const { return m_thrash; }
+
+	void SetConfig(const Config& cfg);
+	const Config& GetConfig() const { return m_cfg; }
+
+private:
+	Config m_cfg;
+
+	int m_bias;
+
+	float m_pressure = 0;
+	float m_thrash   = 0;
+	// frames averaged since the last change
+	int m_frames = 0;
+
+	// direction the last frames asked for and for how many
+	int m_want = 0;
+	int m_held = 0;
+
+}; // MipBiasController
+
+}
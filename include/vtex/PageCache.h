@@ -1,25 +1,171 @@
 #pragma once
 
-#include <textile/PageCache.h>
+#include "vtex/ReplacementPolicy.h"
+#include "vtex/FlatHashMap.h"
+
+#include <textile/Page.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace textile { class PageIndexer; }
 
 namespace vtex
 {
 
 class TextureAtlas;
 class PageTable;
+class PageSource;
+class AsyncPageLoader;
 
-class PageCache : public textile::PageCache
+// Atlas slots shared by every registered virtual texture, pages are
+// keyed by (texture id, page idx) and compete under one policy.
+class PageCache : private boost::noncopyable
 {
 public:
-	PageCache(TextureAtlas& atlas, textile::PageLoader& loader,
-		PageTable& table, const textile::PageIndexer& indexer);
+	// running totals of one texture
+	struct TextureStats
+	{
+		int64_t loaded  = 0;
+		int64_t evicted = 0;   // to make room for another page
+		int64_t dropped = 0;   // finished loads that found no slot
+	};
+
+public:
+	PageCache(TextureAtlas& atlas, AsyncPageLoader& loader);
+
+	// returns the texture id
+	int Register(PageTable& table, const textile::PageIndexer& indexer, PageSource& src);
+	// drops its pages and cancels its loads, the loader discards them
+	// when they finish, waits only for reads of src already started,
+	// so src can be destroyed
+	void Unregister(int tex);
+
+	// switching keeps the resident pages
+	void SetPolicy(std::unique_ptr<ReplacementPolicy> policy);
+	const ReplacementPolicy& GetPolicy() const { return *m_policy; }
+
+	// pages on the top `levels` mips are never evicted, so the coarse
+	// fallback always stays resident
+	void SetPinnedLevels(int levels) { m_pinned_levels = levels; }
+	int GetPinnedLevels() const { return m_pinned_levels; }
+
+	// once per frame, before the touches of the next one
+	void BeginFrame() { m_policy->OnFrame(); }
+
+	// true if resident, count is the page's feedback request count
+	bool Touch(int tex, const textile::Page& page, int count = 1);
+	bool IsResident(int tex, const textile::Page& page) const;
+	bool IsLoading(int tex, const textile::Page& page) const;
+
+	// false if it is loading already or the loader is full
+	bool Request(int tex, const textile::Page& page);
+
+	void Clear(int tex);
+	void Clear();
+
+	// resizes the atlas and moves the resident pages to it, copied by
+	// the backend from the old atlas, the policy evicts the ones that do
+	// not fit. The page tables keep pointing at resident pages, nothing
+	// is read from the sources. If the backend can not copy the atlas,
+	// see RenderBackend::Copy(), the pages come from the loader's
+	// workers instead.
+	void ResizeAtlas(size_t atlas_size);
+
+	void LoadComplete(uint64_t key, const textile::Page& page, const uint8_t* data);
+
+	// page tables of all textures
+	void UpdateTables();
+
+	const TextureStats& GetTextureStats(int tex) const { return m_textures[tex].stats; }
+
+	int GetResidentCount() const { return static_cast<int>(m_lookup.Size()); }
+	int GetSlotCount() const { return static_cast<int>(m_slots.size()); }
+	// registered textures, which compete for the slots
+	int GetTextureCount() const { return m_texture_n; }
 
-	virtual void LoadComplete(const ur::Device& dev, const textile::Page& page, const uint8_t* data) override;
+	uint64_t MakeKey(int tex, const textile::Page& page) const;
+
+	static int KeyTexture(uint64_t key) { return static_cast<int>(key >> 32); }
+	static int KeyPage(uint64_t key) { return static_cast<int>(key & 0xffffffff); }
+
+private:
+	struct Texture
+	{
+		PageTable* table = nullptr;
+		const textile::PageIndexer* indexer = nullptr;
+		PageSource* src = nullptr;
+		int max_mip = 0;
+
+		TextureStats stats;
+	};
+
+	// one per atlas slot
+	struct Slot
+	{
+		textile::Page page;
+		int tex = -1;
+		uint64_t key = 0;
+
+		// parents are only evicted once they have no resident child
+		int resident_children = 0;
+	};
+
+private:
+	bool IsEvictable(int slot) const;
+
+	// all slots free, page_n * page_n of them per atlas layer
+	void ResetSlots(int page_n);
+	// slots fill a layer row by row before the next layer
+	void GetSlotPos(int slot, int& x, int& y, int& layer) const {
+		const int r = slot % (m_page_n * m_page_n);
+		x = r % m_page_n;
+		y = r / m_page_n;
+		layer = slot / (m_page_n * m_page_n);
+	}
+
+	void Evict(int slot);
+
+	// the right neighbour of the last allocated slot if free, so a
+	// frame's pages form runs the atlas uploads together, else the
+	// lowest free slot
+	int AllocSlot();
+	// a free slot
+	void TakeSlot(int slot);
+	void FreeSlot(int slot);
+	bool IsFree(int slot) const {
+		return (m_free_bits[slot >> 6] >> (slot & 63)) & 1;
+	}
+
+	int FindSlot(int tex, int x, int y, int mip) const;
+	void AddResidentChild(int tex, const textile::Page& page, int delta);
 
 private:
 	TextureAtlas& m_atlas;
-	PageTable&    m_table;
+	AsyncPageLoader& m_loader;
+
+	std::vector<Texture> m_textures;
+	int m_texture_n = 0;
+
+	std::unique_ptr<ReplacementPolicy> m_policy;
+
+	std::vector<Slot> m_slots;
+	// slots per atlas row
+	int m_page_n = 0;
+
+	// one bit per free slot
+	std::vector<uint64_t> m_free_bits;
+	int m_free_n = 0;
+	int m_last_slot = -1;
+
+	int m_pinned_levels = 0;
+
+	// key to slot, sized for every slot up front
+	FlatHashMap<uint64_t, int> m_lookup;
 
 }; // PageCache
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "vtex/PageFormat.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vtex
+{
+
+// Page sizes and conversions between page formats.
+class PageCodec
+{
+public:
+	static bool IsCompressed(PageFormat fmt);
+
+	static size_t GetPageBytes(PageFormat fmt, size_t page_size);
+
+	// raw format with this many channels, 3 channels become RGBA8
+	static PageFormat FromChannels(int channels);
+
+	// tmp holds one RGBA8 page, used when neither side is RGBA8
+	static bool Transcode(const uint8_t* src, PageFormat src_fmt,
+		uint8_t* dst, PageFormat dst_fmt, size_t page_size, uint8_t* tmp);
+
+	static bool ToRGBA(const uint8_t* src, PageFormat fmt, size_t page_size, uint8_t* dst);
+	static bool FromRGBA(const uint8_t* rgba, size_t page_size, PageFormat fmt, uint8_t* dst);
+
+	// src may alias the tail of dst
+	static void ExpandToRGBA(const uint8_t* src, int channels, size_t texel_n, uint8_t* dst);
+
+}; // PageCodec
+
+}
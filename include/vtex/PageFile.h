@@ -0,0 +1,81 @@
+#pragma once
+
+#include "vtex/PageSource.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace textile { class PageIndexer; struct VTexInfo; }
+
+namespace vtex
+{
+
+// Layout, little endian:
+//   Header
+//   uint64_t offsets[page_count + 1]   by PageIndexer::CalcPageIdx()
+//   page data, page i is [offsets[i], offsets[i + 1])
+// Pages are tile_size + 2 * border_size texels wide and stored in
+// `format`, RGB8 pages are expanded to RGBA8 on read. Version 1 files
+// have no format field, their pages are raw with `channels` bytes per
+// texel. Files of textile::PageLoader have no header, TextilePageSource
+// reads them.
+class PageFile : public PageSource, private boost::noncopyable
+{
+public:
+	struct Header
+	{
+		char     magic[4];
+		uint32_t version;
+		uint32_t vtex_width, vtex_height;
+		uint32_t tile_size, border_size;
+		uint32_t channels;
+		uint32_t page_count;
+		// PageFormat, since version 2
+		uint32_t format;
+		// keeps the offset table 8 byte aligned
+		uint32_t reserved;
+	};
+
+	static const uint32_t VERSION = 2;
+
+public:
+	PageFile(const std::string& filepath, const textile::PageIndexer& indexer);
+
+	virtual PageFormat GetPageFormat() const override;
+	virtual size_t GetPageBytes() const override;
+
+	virtual bool ReadPage(const textile::Page& page, uint8_t* dst) override;
+
+	virtual bool IsValid() const override { return m_valid; }
+
+	const Header& GetHeader() const { return m_header; }
+
+	// data holds at least sizeof(Header) bytes, the offset table
+	// starts at header_bytes
+	static bool ParseHeader(const uint8_t* data, Header& header, size_t& header_bytes);
+
+	// the texture a file describes, without opening it for reading pages
+	static bool ReadInfo(const std::string& filepath, textile::VTexInfo& info);
+
+	// format and size of one page as stored in the file
+	static PageFormat GetStoredFormat(const Header& header);
+	static size_t GetStoredBytes(const Header& header);
+
+private:
+	const textile::PageIndexer& m_indexer;
+
+	Header m_header = Header();
+	std::vector<uint64_t> m_offsets;
+
+	bool m_valid = false;
+
+	std::mutex    m_fin_mtx;
+	std::ifstream m_fin;
+
+}; // PageFile
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "vtex/PageFile.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vtex
+{
+
+// Writes the PageFile layout. All pages have the same size, so each
+// one has a fixed place in the file and they may arrive in any order
+// and from any thread.
+class PageFileWriter : private boost::noncopyable
+{
+public:
+	// header.version and header.magic are filled in
+	PageFileWriter(const std::string& filepath, const PageFile::Header& header);
+
+	// data is one page in the header's format, idx by PageIndexer
+	bool WritePage(int idx, const uint8_t* data);
+
+	// false if a page is missing or a write failed
+	bool Finish();
+
+	bool IsValid() const { return m_valid; }
+
+	size_t GetPageBytes() const { return m_page_bytes; }
+
+private:
+	PageFile::Header m_header;
+
+	size_t m_page_bytes;
+	uint64_t m_data_offset;
+
+	std::mutex    m_fout_mtx;
+	std::ofstream m_fout;
+
+	std::vector<bool> m_written;
+
+	bool m_valid = false;
+
+}; // PageFileWriter
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+namespace vtex
+{
+
+// Texel layout of a page on disk, in the loader and in the atlas.
+// Block compressed pages are stored as 4x4 blocks, row by row, so their
+// page size has to be a multiple of 4.
+enum class PageFormat
+{
+	R8,
+	RG8,
+	// on disk only, expanded to RGBA8 on load
+	RGB8,
+	RGBA8,
+
+	// rgb, 8 bytes per block
+	BC1,
+	// rgba, 16 bytes per block
+	BC3,
+	// rgba, 16 bytes per block
+	BC7,
+};
+
+}
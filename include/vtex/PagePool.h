@@ -0,0 +1,78 @@
+#pragma once
+
+#include "vtex/TextureAtlas.h"
+#include "vtex/AsyncPageLoader.h"
+#include "vtex/UploadScheduler.h"
+#include "vtex/PageCache.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <memory>
+
+namespace vtex
+{
+
+// Physical pages shared by several virtual textures: one atlas, one
+// loader, one cache with a global replacement policy and one upload
+// budget. All textures sharing a pool need the same page size.
+class PagePool : private boost::noncopyable
+{
+public:
+	struct Config
+	{
+		// in texels, at most 256 pages a side
+		size_t atlas_size = 4096;
+		// more than 1 makes the atlas a texture array, every layer
+		// atlas_size a side
+		int atlas_layers = 1;
+
+		// per frame budget of the finished pages' uploads
+		UploadScheduler::Config upload;
+
+		int loader_threads       = 2;
+		int loader_max_in_flight = 32;
+
+		// coarsest mips that are never evicted
+		int pinned_levels = 2;
+	};
+
+public:
+	// block compressed formats need a page size that is a multiple of 4
+	PagePool(const std::shared_ptr<RenderBackend>& backend, size_t page_size,
+        PageFormat fmt, const Config& cfg);
+
+	// once per frame after all textures' feedback, uploads finished
+	// pages within the budget and updates every page table
+	void Update();
+
+	// between frames, the resident pages that fit are moved to the new
+	// atlas, see PageCache::ResizeAtlas(), the textures' shaders pick
+	// up the new size on their next draw. The pages are copied only if
+	// the backend can, a UrBackend needs the context of a Draw() for
+	// that and copies 2D atlases without block compression only, else
+	// they are loaded again from their sources
+	void ResizeAtlas(size_t atlas_size);
+
+	const std::shared_ptr<RenderBackend>& GetBackend() const { return m_backend; }
+
+	size_t GetPageSize() const { return m_page_size; }
+	PageFormat GetPageFormat() const { return m_atlas.GetFormat(); }
+
+	TextureAtlas&    GetAtlas()           { return m_atlas; }
+	AsyncPageLoader& GetPageLoader()      { return m_loader; }
+	UploadScheduler& GetUploadScheduler() { return m_scheduler; }
+	PageCache&       GetCache()           { return m_cache; }
+
+private:
+	std::shared_ptr<RenderBackend> m_backend;
+
+	size_t m_page_size;
+
+	TextureAtlas    m_atlas;
+	AsyncPageLoader m_loader;
+	UploadScheduler m_scheduler;
+	PageCache       m_cache;
+
+}; // PagePool
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "vtex/FlatHashMap.h"
+#include "vtex/RequestSet.h"
+
+#include <textile/Page.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace textile { class PageIndexer; }
+
+namespace vtex
+{
+
+// Guesses pages the next frames will ask for: visible pages moved along
+// the estimated camera motion, and finer children of visible resident
+// pages while the view zooms in. Its candidates are loaded after demand
+// loads, and are scored once feedback asks for them or they expire.
+class PagePrefetcher : private boost::noncopyable
+{
+public:
+	struct Config
+	{
+		// frames of feedback used to estimate motion
+		int history = 8;
+		// how many frames ahead the motion is extrapolated
+		float lookahead = 4.0f;
+
+		int max_candidates = 64;
+
+		// prefetched pages not requested within this many frames are misses
+		int expire_frames = 30;
+
+		// also prefetch children of resident pages when not zooming
+		bool always_finer = false;
+	};
+
+	struct Stats
+	{
+		int issued = 0;
+		int hits = 0;
+		int misses = 0;
+
+		float HitRate() const {
+			return hits + misses > 0 ? static_cast<float>(hits) / (hits + misses) : 0.0f;
+		}
+	};
+
+public:
+	PagePrefetcher(const textile::PageIndexer& indexer, int page_table_w,
+		int page_table_h, const Config& cfg);
+
+	// used instead of the estimate for the next EndFrame()
+	// du, dv: motion in virtual texture uv per frame
+	// zoom: mips per frame the view gets finer by, > 0 when moving closer
+	void SetMotionHint(float du, float dv, float zoom);
+
+	void BeginFrame(uint64_t frame);
+	void AddVisible(const textile::Page& page, int page_idx, int count, bool resident);
+	void EndFrame();
+
+	const std::vector<textile::Page>& GetCandidates() const { return m_candidates; }
+
+	// a candidate was handed to the loader
+	void OnIssued(int page_idx);
+	bool IsPending(int page_idx) const;
+
+	const Stats& GetStats() const { return m_stats; }
+
+	void Clear();
+
+private:
+	struct Visible
+	{
+		textile::Page page;
+		int count;
+		bool resident;
+	};
+
+	struct Footprint
+	{
+		// weighted center in level 0 pages, and mean mip
+		float x, y, mip;
+	};
+
+private:
+	void EstimateMotion(float& vx, float& vy, float& zoom) const;
+
+	void AddCandidate(int x, int y, int mip);
+
+private:
+	const textile::PageIndexer& m_indexer;
+
+	int m_page_table_w, m_page_table_h;
+	int m_max_mip;
+
+	Config m_cfg;
+
+	bool  m_has_hint = false;
+	float m_hint_du = 0, m_hint_dv = 0, m_hint_zoom = 0;
+
+	uint64_t m_frame = 0;
+
+	std::vector<Visible> m_visible;
+	RequestSet m_visible_set;
+
+	// oldest first, at most cfg.history
+	std::vector<Footprint> m_history;
+
+	std::vector<textile::Page> m_candidates;
+	RequestSet m_candidate_set;
+
+	// page idx to frame it was issued in
+	FlatHashMap<int, uint64_t> m_pending;
+
+	Stats m_stats;
+
+}; // PagePrefetcher
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "vtex/PageFormat.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace textile { struct Page; }
+
+namespace vtex
+{
+
+// Where page pixels come from. ReadPage() is called from loader threads
+// and must be safe to call concurrently.
+class PageSource
+{
+public:
+	virtual ~PageSource() {}
+
+	// format of the pages ReadPage() and MapPage() return, the loader
+	// transcodes them if the atlas uses another one
+	virtual PageFormat GetPageFormat() const { return PageFormat::RGBA8; }
+
+	// bytes of one page in GetPageFormat()
+	virtual size_t GetPageBytes() const = 0;
+
+	virtual bool ReadPage(const textile::Page& page, uint8_t* dst) = 0;
+
+	// zero copy access for sources that keep pages in memory in
+	// GetPageFormat(), valid for the source's lifetime
+	virtual const uint8_t* MapPage(const textile::Page&) { return nullptr; }
+
+	// the page will be read soon
+	virtual void Prefetch(const textile::Page&) {}
+
+	// false if the source could not open its file, every read fails
+	virtual bool IsValid() const { return true; }
+
+}; // PageSource
+
+}
@@ -1,14 +1,13 @@
 #pragma once
 
-#include <unirender/typedef.h>
+#include "vtex/RenderBackend.h"
 
 #include <boost/noncopyable.hpp>
 
-#include <memory>
+#include <cstdint>
 #include <vector>
 
 namespace textile { struct Page; }
-namespace ur { class Device; }
 
 namespace vtex
 {
@@ -16,71 +15,106 @@ namespace vtex
 class PageTable : private boost::noncopyable
 {
 public:
-	PageTable(const ur::Device& dev, int width, int height);
+	PageTable(RenderBackend& backend, int width, int height);
+	~PageTable();
 
-	void AddPage(const textile::Page& page, int mapping_x, int mapping_y);
+	void AddPage(const textile::Page& page, int mapping_x, int mapping_y, int layer = 0);
+	// resident descendants stay mapped
 	void RemovePage(const textile::Page& page);
 
+	// rewrites and uploads the dirty regions only
 	void Update();
 
     auto GetTexture() const { return m_tex; }
 
+	int GetMaxLevel() const { return m_max_level; }
+
+	// CPU copy of a level as uploaded by the last Update(), RGBA8 with
+	// (width >> level) texels per row: the page's atlas slot, its level
+	// and its atlas layer
+	const uint8_t* GetLevelData(int level) const { return m_data[level].data; }
+
+	struct UpdateStats
+	{
+		size_t texels_written = 0;
+		size_t bytes_uploaded = 0;
+		int    upload_calls   = 0;
+		float  update_ms      = 0;
+	};
+
+	// counters of the last Update()
+	const UpdateStats& GetUpdateStats() const { return m_stats; }
+
 private:
 	struct Image
 	{
-		~Image() {
-			delete[] data;
-		}
-
 		int w = 0, h = 0;
 		uint8_t* data = nullptr;
 	};
 
+	// one per page of every mip, an implicit quadtree: the parent of
+	// (x, y, mip) is (x / 2, y / 2, mip + 1)
+	struct Entry
+	{
+		uint8_t mapping_x = 0;
+		uint8_t mapping_y = 0;
+		uint8_t layer = 0;
+		bool resident = false;
+	};
+
 	struct Rect
 	{
 		Rect(int x, int y, int w, int h)
 			: x(x), y(y), w(w), h(h) {}
 
-		bool Contain(int px, int py) const {
-			return px >= x && px < x + w
-				&& py >= y && py < y + h;
+		// overlapping or adjacent
+		bool Touch(const Rect& r) const {
+			return r.x <= x + w && x <= r.x + r.w
+				&& r.y <= y + h && y <= r.y + r.h;
 		}
 
+		void Combine(const Rect& r);
+
 		int x, y;
 		int w, h;
 	};
 
-	struct QuadNode : private boost::noncopyable
-	{
-		QuadNode(int level, const Rect& rect);
+private:
+	Entry& GetEntry(int x, int y, int mip) {
+		return m_entries[m_offsets[mip] + y * m_data[mip].w + x];
+	}
 
-		Rect CalcChildRect(int idx) const;
+	// rect in pages of level 0, marks it on every level from 0 to mip
+	void MarkDirty(int x, int y, int size, int mip);
+	void AddDirtyRect(std::vector<Rect>& rects, const Rect& r);
 
-		void Write(int w, int h, uint8_t* data, int mip_level);
+	void WriteRect(int level, const Rect& r);
+	void UploadRect(int level, const Rect& r);
 
-		int level;
-		Rect rect;
+	size_t CalcMaxLevel() const;
 
-		int mapping_x, mapping_y;
+private:
+	RenderBackend& m_backend;
 
-		std::unique_ptr<QuadNode> children[4];
+	int m_width, m_height;
 
-	}; // QuadNode
+	int m_max_level;
 
-private:
-	QuadNode* FindPage(const textile::Page& page, int& index) const;
+	// all levels in one block, finest first
+	std::vector<Entry>  m_entries;
+	std::vector<size_t> m_offsets;
 
-    size_t CalcMaxLevel() const;
+	std::vector<Image> m_data;
 
-private:
-	int m_width, m_height;
+	std::vector<std::vector<Rect>> m_dirty;
 
-	std::unique_ptr<QuadNode> m_root;
+	// packs sub rects that don't span whole rows
+	std::vector<uint8_t> m_upload_buf;
 
-	std::vector<Image> m_data;
+	UpdateStats m_stats;
 
-    ur::TexturePtr m_tex = nullptr;
+    RenderBackend::TexturePtr m_tex = nullptr;
 
 }; // PageTable
 
-}
\ No newline at end of file
+}
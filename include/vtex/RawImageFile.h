@@ -0,0 +1,34 @@
+#pragma once
+
+#include "vtex/ImageSource.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <fstream>
+#include <string>
+
+namespace vtex
+{
+
+// Headerless image, rows top to bottom, `channels` bytes per texel.
+class RawImageFile : public ImageSource, private boost::noncopyable
+{
+public:
+	RawImageFile(const std::string& filepath, int width, int height, int channels);
+
+	virtual int GetWidth() const override { return m_width; }
+	virtual int GetHeight() const override { return m_height; }
+
+	virtual bool ReadRows(int y, int n, uint8_t* dst) override;
+
+	bool IsValid() const { return !!m_fin; }
+
+private:
+	int m_width, m_height;
+	int m_channels;
+
+	std::ifstream m_fin;
+
+}; // RawImageFile
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace vtex
+{
+
+// Bookkeeping for N feedback render targets. Frame N renders into one
+// slot and is read back at frame N + latency, when the GPU is done with
+// it, so the readback no longer waits for the current frame. Knows
+// nothing about devices, only slots and frame numbers.
+class ReadbackRing : private boost::noncopyable
+{
+public:
+	ReadbackRing(int slot_n, int latency);
+
+	// slot the feedback pass of this frame renders into, an unread
+	// slot is dropped if the ring is full
+	int Write(uint64_t frame);
+
+	// oldest written slot at least `latency` frames old, or -1
+	int Read(uint64_t frame, uint64_t& src_frame);
+
+	int GetSlotCount() const { return static_cast<int>(m_slots.size()); }
+	int GetLatency() const { return m_latency; }
+
+	// written slots overwritten before they were read
+	int GetDropCount() const { return m_dropped; }
+
+private:
+	struct Slot
+	{
+		uint64_t frame = 0;
+		bool written = false;
+	};
+
+private:
+	int m_latency;
+
+	std::vector<Slot> m_slots;
+
+	int m_next = 0;
+
+	int m_dropped = 0;
+
+}; // ReadbackRing
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "vtex/RenderBackend.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace vtex
+{
+
+// RenderBackend without a device. Textures and targets live in memory,
+// every call is counted, so a frame of the streaming core can be timed
+// and its upload and readback traffic checked without the GPU side.
+class RecordingBackend : public RenderBackend
+{
+public:
+	struct Stats
+	{
+		int    textures_created = 0;
+		size_t texture_bytes    = 0;
+
+		int    upload_calls = 0;
+		size_t upload_bytes = 0;
+
+		int    copy_calls = 0;
+		size_t copy_bytes = 0;
+
+		int    target_binds   = 0;
+		int    readback_calls = 0;
+		size_t readback_bytes = 0;
+	};
+
+public:
+	// without keep_pixels nothing is copied, only counted
+	RecordingBackend(bool keep_pixels = true);
+
+	virtual TexturePtr CreateTexture(int width, int height,
+		PageFormat fmt, const uint8_t* pixels) override;
+	virtual TexturePtr CreateTextureArray(int width, int height,
+		int layers, PageFormat fmt) override;
+	virtual void Upload(Texture& tex, const uint8_t* pixels,
+		int x, int y, int w, int h, int level = 0, int layer = 0) override;
+	virtual bool Copy(const Texture& src, int sx, int sy,
+		Texture& dst, int dx, int dy, int w, int h,
+		int src_layer = 0, int dst_layer = 0) override;
+
+	virtual RenderTargetPtr CreateRenderTarget(int width, int height) override;
+	virtual void BindRenderTarget(const RenderTarget& rt) override;
+	virtual void UnbindRenderTarget() override;
+	virtual void ReadPixels(const RenderTarget* rt, uint8_t* dst, int w, int h) override;
+
+	// stands in for the draw: RGBA8 pixels written to the bound target,
+	// or to the default target if none is bound
+	void DrawPixels(const uint8_t* rgba, int w, int h);
+
+	// level 0 of the layer in the texture's format, nullptr unless
+	// pixels are kept
+	const uint8_t* GetPixels(const Texture& tex, int layer = 0) const;
+
+	const Stats& GetStats() const { return m_stats; }
+	void ResetStats() { m_stats = Stats(); }
+
+private:
+	class MemTexture : public Texture
+	{
+	public:
+		MemTexture(int width, int height, PageFormat fmt, int layers = 1)
+			: Texture(width, height, fmt, layers) {}
+
+		// layer after layer
+		std::vector<uint8_t> pixels;
+	};
+
+private:
+	bool m_keep_pixels;
+
+	// the current target when none is bound, sized by its first draw
+	RenderTargetPtr m_default_rt = nullptr;
+
+	const RenderTarget* m_bound = nullptr;
+
+	Stats m_stats;
+
+}; // RecordingBackend
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "vtex/PageFormat.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <memory>
+
+namespace vtex
+{
+
+// The few device calls the streaming core makes: texture creation,
+// sub rect uploads, atlas copies and feedback readback. UrBackend forwards them to
+// unirender, RecordingBackend keeps them in memory and counts them, so
+// the core runs and is profiled without a device.
+class RenderBackend : private boost::noncopyable
+{
+public:
+	class Texture
+	{
+	public:
+		Texture(int width, int height, PageFormat fmt, int layers = 1)
+			: width(width), height(height), format(fmt), layers(layers) {}
+		virtual ~Texture() {}
+
+		int width, height;
+		PageFormat format;
+		// more than 1 for array textures
+		int layers;
+	};
+	typedef std::shared_ptr<Texture> TexturePtr;
+
+	// RGBA8 color with a depth attachment
+	class RenderTarget
+	{
+	public:
+		RenderTarget(int width, int height)
+			: width(width), height(height) {}
+		virtual ~RenderTarget() {}
+
+		int width, height;
+
+		// the color attachment, for DebugDraw()
+		TexturePtr color = nullptr;
+	};
+	typedef std::shared_ptr<RenderTarget> RenderTargetPtr;
+
+public:
+	virtual ~RenderBackend() {}
+
+	// pixels in fmt or nullptr, RGB8 is not a texture format
+	virtual TexturePtr CreateTexture(int width, int height,
+		PageFormat fmt, const uint8_t* pixels) = 0;
+	// layers of width x height, the contents are undefined until uploaded
+	virtual TexturePtr CreateTextureArray(int width, int height,
+		int layers, PageFormat fmt) = 0;
+
+	// tightly packed pixels in the texture's format, block compressed
+	// rects are aligned to blocks, layer of an array texture
+	virtual void Upload(Texture& tex, const uint8_t* pixels,
+		int x, int y, int w, int h, int level = 0, int layer = 0) = 0;
+
+	// rect of src to dst, both in one format, block compressed rects are
+	// aligned to blocks, false if the backend can not copy them, nothing
+	// is copied then. Whether the pixels stay on the device depends on
+	// the backend, see its Copy()
+	virtual bool Copy(const Texture& src, int sx, int sy,
+		Texture& dst, int dx, int dy, int w, int h,
+		int src_layer = 0, int dst_layer = 0) = 0;
+
+	virtual RenderTargetPtr CreateRenderTarget(int width, int height) = 0;
+
+	// until UnbindRenderTarget() draws go to rt instead of the current
+	// target, not nested
+	virtual void BindRenderTarget(const RenderTarget& rt) = 0;
+	virtual void UnbindRenderTarget() = 0;
+
+	// RGBA8, rt nullptr reads the current target
+	virtual void ReadPixels(const RenderTarget* rt, uint8_t* dst, int w, int h) = 0;
+
+	// overlay of the texture for debugging, slot picks the screen spot
+	virtual void DebugDraw(const Texture&, int) {}
+
+}; // RenderBackend
+
+}
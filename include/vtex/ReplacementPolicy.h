@@ -0,0 +1,42 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+namespace vtex
+{
+
+enum class ReplacementPolicyType
+{
+	LRU,
+	CLOCK,
+	LFU,
+};
+
+// Chooses which atlas slot PageCache evicts. Slots are 0..slot_n-1.
+class ReplacementPolicy
+{
+public:
+	virtual ~ReplacementPolicy() {}
+
+	virtual void Reset(int slot_n) = 0;
+
+	virtual void OnInsert(int slot) = 0;
+	virtual void OnRemove(int slot) = 0;
+
+	// requested `count` times by the current feedback frame
+	virtual void OnTouch(int slot, int count) = 0;
+
+	// called once per feedback frame, before its touches
+	virtual void OnFrame() {}
+
+	// resident slot to evict or -1, evictable may be empty
+	virtual int SelectVictim(const std::function<bool(int slot)>& evictable) = 0;
+
+	virtual const char* GetName() const = 0;
+
+	static std::unique_ptr<ReplacementPolicy> Create(ReplacementPolicyType type);
+
+}; // ReplacementPolicy
+
+}
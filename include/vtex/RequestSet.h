@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vtex
+{
+
+struct PageRequest
+{
+	int page_idx;
+	int count;
+};
+
+// one feedback frame of unique pages with their request counts
+typedef std::vector<PageRequest> RequestFrame;
+
+// Request counts of one feedback frame keyed by page idx. Open
+// addressing over the requested pages only, entries of older frames
+// are told apart by a generation, so adding, iterating and clearing
+// cost the visible pages, not the page count of the virtual texture.
+class RequestSet
+{
+public:
+	RequestSet();
+
+	void Add(int page_idx, int count);
+
+	// 0 if not requested
+	int Get(int page_idx) const;
+
+	void Clear();
+
+	// room for n pages without growing
+	void Reserve(size_t n);
+
+	// in the order they were first added
+	const RequestFrame& GetFrame() const { return m_frame; }
+	size_t GetCount() const { return m_frame.size(); }
+	bool IsEmpty() const { return m_frame.empty(); }
+
+	RequestFrame::const_iterator begin() const { return m_frame.begin(); }
+	RequestFrame::const_iterator end() const { return m_frame.end(); }
+
+private:
+	int Find(int page_idx) const;
+
+	void Grow();
+
+private:
+	struct Entry
+	{
+		uint32_t gen = 0;
+		// into m_frame
+		int pos = 0;
+	};
+
+private:
+	std::vector<Entry> m_table;
+	uint32_t m_gen = 1;
+
+	RequestFrame m_frame;
+
+}; // RequestSet
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "vtex/RequestSet.h"
+
+#include <textile/VTexInfo.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vtex
+{
+
+// Per frame feedback requests of one virtual texture, recorded with
+// RequestTraceWriter for reproducible offline runs.
+//
+// Layout, little endian:
+//   Header
+//   per frame: varint n, then n pairs of varint (page idx delta,
+//   request count), page idx ascending, the first delta from 0
+class RequestTrace
+{
+public:
+	struct Header
+	{
+		char     magic[4];
+		uint32_t version;
+		uint32_t vtex_width, vtex_height;
+		uint32_t tile_size, border_size;
+		uint32_t frame_count;
+		uint32_t reserved;
+	};
+
+	static const uint32_t VERSION = 1;
+
+public:
+	RequestTrace(const std::string& filepath);
+
+	bool IsValid() const { return m_valid; }
+
+	const textile::VTexInfo& GetInfo() const { return m_info; }
+
+	// frames can feed CacheSimulator directly
+	const std::vector<RequestFrame>& GetFrames() const { return m_frames; }
+
+private:
+	textile::VTexInfo m_info;
+
+	std::vector<RequestFrame> m_frames;
+
+	bool m_valid = false;
+
+}; // RequestTrace
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "vtex/RequestTrace.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace vtex
+{
+
+// Appends frames in the RequestTrace layout, the frame count in the
+// header is written by Finish().
+class RequestTraceWriter : private boost::noncopyable
+{
+public:
+	RequestTraceWriter(const std::string& filepath, const textile::VTexInfo& info);
+	~RequestTraceWriter();
+
+	void AddFrame(const RequestSet& requests) { AddFrame(requests.GetFrame()); }
+	void AddFrame(const RequestFrame& frame);
+
+	bool Finish();
+
+	bool IsValid() const { return m_valid; }
+
+	int GetFrameCount() const { return m_header.frame_count; }
+	// bytes written so far
+	size_t GetSize() const { return m_size; }
+
+private:
+	void WriteVarint(uint32_t v);
+
+private:
+	RequestTrace::Header m_header;
+
+	std::ofstream m_fout;
+	size_t m_size = 0;
+
+	// one encoded frame
+	std::vector<uint8_t> m_buf;
+	RequestFrame m_sorted;
+
+	bool m_valid = false;
+
+}; // RequestTraceWriter
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace textile { struct VTexInfo; }
+
+namespace vtex
+{
+
+class PageTable;
+
+// Texture coordinates of a rasterized frame, what the vertex shader
+// passes to both fragment shaders as v_texcoord.
+struct UvBuffer
+{
+	int width = 0, height = 0;
+
+	// two floats per pixel
+	std::vector<float>   uv;
+	std::vector<uint8_t> covered;
+
+	void Resize(int w, int h);
+	void Clear();
+
+	void Set(int x, int y, float u, float v);
+
+	// ground plane seen from a camera at (cam_u, cam_v) in texture
+	// space, cam_h above it and pitched down by `pitch` radians,
+	// texcoords outside [0, 1) are not covered
+	void FillPlane(float cam_u, float cam_v, float cam_h, float pitch, float fov_y);
+
+}; // UvBuffer
+
+// CPU version of feedback.frag and final.frag, for running the
+// streaming loop without a GPU. Derivatives are taken per 2x2 quad
+// like the hardware's coarse dFdx/dFdy. Rows are split over threads.
+class SoftRenderer : private boost::noncopyable
+{
+public:
+	// the shaders' uniforms
+	struct Params
+	{
+		float page_table_size = 0;
+		float virt_tex_size[2] = { 0, 0 };
+		float mip_sample_bias = 0;
+
+		float atlas_scale = 0;
+		float border_scale = 1;
+		float border_offset = 0;
+
+		int atlas_size = 0;
+
+		// feedback subsampling, one pixel of every subsample^2 block,
+		// the one at jitter, see FeedbackBuffer
+		int subsample = 1;
+		int jitter[2] = { 0, 0 };
+	};
+
+	static Params MakeParams(const textile::VTexInfo& info, int atlas_size, float mip_sample_bias);
+
+public:
+	// 0 for one thread per hardware thread
+	explicit SoftRenderer(int thread_n = 0);
+	~SoftRenderer();
+
+	// dst is (width / subsample) * (height / subsample) RGBA8, the
+	// layout FeedbackBuffer reads back
+	void RenderFeedback(const UvBuffer& uv, const Params& params, uint8_t* dst);
+
+	// atlas is the RGBA8 copy of TextureAtlas::GetShadow(), all layers
+	void RenderFinal(const UvBuffer& uv, const Params& params,
+		const PageTable& table, const uint8_t* atlas, uint8_t* dst);
+
+	int GetThreadCount() const { return static_cast<int>(m_threads.size()) + 1; }
+
+private:
+	// fn(y0, y1) over rows in pairs, the caller thread helps
+	void ParallelRows(int height, const std::function<void(int y0, int y1)>& fn);
+
+	void WorkerLoop();
+	void RunChunks();
+
+private:
+	std::vector<std::thread> m_threads;
+
+	std::mutex              m_mtx;
+	std::condition_variable m_start_cv;
+	std::condition_variable m_done_cv;
+	uint64_t m_generation = 0;
+	int      m_running = 0;
+	bool     m_stop = false;
+
+	const std::function<void(int, int)>* m_job = nullptr;
+	int m_job_height = 0;
+	std::atomic<int> m_next_row;
+
+}; // SoftRenderer
+
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <boost/noncopyable.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Timers cost two clock reads each. Building with VTEX_DISABLE_TIMERS
+// compiles them out, the *_ms fields then stay 0.
+#ifdef VTEX_DISABLE_TIMERS
+#define VTEX_SCOPED_TIMER(ms)
+#else
+#define VTEX_TIMER_CONCAT_(a, b) a##b
+#define VTEX_TIMER_CONCAT(a, b) VTEX_TIMER_CONCAT_(a, b)
+#define VTEX_SCOPED_TIMER(ms) vtex::ScopedTimer VTEX_TIMER_CONCAT(vtex_timer_, __LINE__)(ms)
+#endif
+
+namespace vtex
+{
+
+// Adds the milliseconds spent in its scope to a float.
+class ScopedTimer : private boost::noncopyable
+{
+public:
+	ScopedTimer(float& ms)
+		: m_ms(ms), m_start(std::chrono::steady_clock::now()) {}
+	~ScopedTimer() {
+		m_ms += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+	}
+
+private:
+	float& m_ms;
+	std::chrono::steady_clock::time_point m_start;
+
+}; // ScopedTimer
+
+// What one virtual texture did in one frame.
+struct FrameStats
+{
+	uint64_t frame = 0;
+
+	float download_ms = 0;   // feedback readback, and analysis if not async
+	float analyze_ms  = 0;   // analysis of the requests used, maybe on a worker
+	float update_ms   = 0;   // cache touches, sorting and requests
+	float pool_ms     = 0;   // PagePool::Update(), only with an own pool
+	float table_ms    = 0;   // PageTable::Update()
+
+	int feedback = 0;        // feedback frames read back, 0 or 1
+	size_t readback_bytes = 0;  // of the feedback
+
+	int requested  = 0;      // unique pages in the feedback
+	int hits       = 0;      // of them resident
+	int misses     = 0;
+	int issued     = 0;      // demand loads submitted
+	int deferred   = 0;      // misses neither issued nor loading already
+	int prefetched = 0;
+
+	int loaded  = 0;         // pages uploaded into the atlas
+	int evicted = 0;         // pages of this texture replaced by others
+	int dropped = 0;         // finished loads without a slot
+
+	int    table_texels  = 0;
+	int    table_uploads = 0;
+	size_t table_bytes   = 0;
+
+	int mip_bias = 0;
+	int mip_bias_changes = 0;
+	// the controller's inputs, smoothed, set on feedback frames
+	float atlas_pressure = 0;  // requested pages per atlas slot
+	float thrash_rate    = 0;  // evicted and dropped per requested page
+};
+
+// Per frame counters of a virtual texture plus rolling histograms over
+// the last `window` frames. Recording a frame is a copy and a few
+// bucket updates, queries and dumps walk the window.
+class Telemetry : private boost::noncopyable
+{
+public:
+	enum class Metric
+	{
+		DownloadMs,
+		AnalyzeMs,
+		UpdateMs,
+		PoolMs,
+		TableMs,
+		Requested,
+		Misses,
+		Loaded,
+		Evicted,
+		TableBytes,
+
+		MaxNum
+	};
+
+	// power of two buckets, [2^(i - 7), 2^(i - 6)) with everything
+	// below 2^-6 in the first one
+	class Histogram
+	{
+	public:
+		static const int BUCKET_NUM = 40;
+
+		void Add(double v) { ++m_buckets[Bucket(v)]; ++m_count; }
+		void Remove(double v) { --m_buckets[Bucket(v)]; --m_count; }
+
+		int GetCount() const { return m_count; }
+		int GetBucket(int i) const { return m_buckets[i]; }
+
+		// upper bound of the bucket holding the p quantile, p in [0, 1]
+		double Percentile(double p) const;
+
+		static double BucketMax(int i);
+
+	private:
+		static int Bucket(double v);
+
+	private:
+		int m_buckets[BUCKET_NUM] = {};
+		int m_count = 0;
+
+	}; // Histogram
+
+public:
+	Telemetry(int window = 240);
+
+	void Record(const FrameStats& stats);
+
+	const FrameStats& GetLast() const;
+	// oldest first, at most `window` frames
+	void GetFrames(std::vector<FrameStats>& frames) const;
+	int GetFrameCount() const { return m_count; }
+
+	const Histogram& GetHistogram(Metric m) const { return m_hists[static_cast<int>(m)]; }
+	double GetMean(Metric m) const;
+	double GetMax(Metric m) const;
+
+	// totals since construction or the last Reset()
+	const FrameStats& GetTotals() const { return m_totals; }
+
+	void Reset();
+
+	// one row per frame in the window
+	bool DumpCSV(const std::string& filepath) const;
+	// totals, per metric summaries and the frames
+	bool DumpJSON(const std::string& filepath) const;
+
+	static const char* MetricName(Metric m);
+	static double MetricValue(const FrameStats& stats, Metric m);
+
+private:
+	std::vector<FrameStats> m_frames;
+	int m_next = 0;
+	int m_count = 0;
+
+	Histogram m_hists[static_cast<int>(Metric::MaxNum)];
+
+	FrameStats m_totals;
+
+}; // Telemetry
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "vtex/PageSource.h"
+
+#include <textile/PageCache.h>
+#include <textile/PageLoader.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ur { class Device; }
+namespace textile { class PageIndexer; }
+
+namespace vtex
+{
+
+// Pages of a file in the format textile::PageLoader reads, the one
+// before PageFile. The loader needs a device, so a ReadPage() waits on
+// its worker thread until the render thread calls Update(), which
+// requests the waiting pages and hands back the ones the loader
+// finished. Pages are raw with `channels` bytes per texel, 3 channel
+// pages are expanded to RGBA8, page_size includes the borders.
+class TextilePageSource : public PageSource, private boost::noncopyable
+{
+public:
+	TextilePageSource(const std::string& filepath, const textile::PageIndexer& indexer,
+		size_t page_size, int channels);
+	~TextilePageSource();
+
+	virtual PageFormat GetPageFormat() const override;
+	virtual size_t GetPageBytes() const override;
+	virtual bool ReadPage(const textile::Page& page, uint8_t* dst) override;
+
+	// the file can be opened, there is no header to check
+	virtual bool IsValid() const override { return m_valid; }
+
+	// render thread, once a frame
+	void Update(const ur::Device& dev);
+
+	// fails the reads waiting and the ones after, so the loader's
+	// workers can finish while nobody calls Update() any more
+	void Close();
+
+private:
+	class Sink : public textile::PageCache
+	{
+	public:
+		Sink(TextilePageSource& owner, textile::PageLoader& loader, const textile::PageIndexer& indexer)
+			: textile::PageCache(loader, indexer), m_owner(owner) {}
+
+		virtual void LoadComplete(const ur::Device& dev, const textile::Page& page, const uint8_t* data) override;
+
+	private:
+		TextilePageSource& m_owner;
+
+	}; // Sink
+
+	struct Read
+	{
+		textile::Page page;
+		int page_idx;
+		uint8_t* dst;
+		bool requested;
+		bool done;
+	};
+
+private:
+	void OnLoaded(const textile::Page& page, const uint8_t* data);
+
+private:
+	const textile::PageIndexer& m_indexer;
+
+	int m_channels;
+	size_t m_texel_n;
+	bool m_valid = false;
+
+	textile::PageLoader m_loader;
+	Sink m_sink;
+
+	// one per worker at most, guarded by m_mtx
+	std::vector<Read*> m_reads;
+	bool m_closed = false;
+
+	std::mutex              m_mtx;
+	std::condition_variable m_cv;
+
+}; // TextilePageSource
+
+}
@@ -1,40 +1,108 @@
 #pragma once
 
-#include <unirender/typedef.h>
+#include "vtex/PageFormat.h"
+#include "vtex/RenderBackend.h"
 
 #include <boost/noncopyable.hpp>
 
 #include <cstdint>
-
-namespace ur { class Device; }
+#include <vector>
 
 namespace vtex
 {
 
+// Pages are not uploaded one by one: UploadPage() copies them into a
+// staging arena that is kept between frames, Flush() writes them to the
+// texture, one call per run of pages next to each other in an atlas row.
+// With several layers the texture is an array, each layer an atlas of
+// the same size.
 class TextureAtlas : private boost::noncopyable
 {
 public:
-	TextureAtlas(const ur::Device& dev, size_t atlas_size,
-        size_t page_size, int tex_channel);
+	// of the last Flush()
+	struct FlushStats
+	{
+		int    pages        = 0;
+		int    upload_calls = 0;
+		size_t upload_bytes = 0;
+	};
+
+public:
+	TextureAtlas(RenderBackend& backend, size_t atlas_size,
+        size_t page_size, PageFormat fmt, int layers = 1);
+
+	// a page kept by Resize(), in slots
+	struct PageMove
+	{
+		int src_x, src_y, src_layer;
+		int dst_x, dst_y, dst_layer;
+	};
 
 	int GetSize() const { return m_atlas_size; }
+	// a new white texture, staged pages go to the old one first, moves
+	// are copied from it on the device, in runs like Flush(), false if
+	// the backend can not copy, the new texture then holds none of them
+	bool Resize(size_t atlas_size, std::vector<PageMove>& moves);
 
+	PageFormat GetFormat() const { return m_format; }
+
+	size_t GetPageSize() const { return m_page_size; }
+	// a side of one layer
 	size_t GetPageCount() const { return m_page_count; }
+	int GetLayerCount() const { return m_layers; }
+
+	// pixels in the atlas' format, staged until the next Flush(), a
+	// slot staged twice keeps the later page
+	void UploadPage(const uint8_t* pixels, int x, int y, int layer = 0);
+	void Flush();
 
-	void Bind();
+	// the arena grows on demand, this avoids it for up to `pages` a frame
+	void ReserveStaging(int pages);
 
-	void UploadPage(const uint8_t* pixels, int x, int y);
+	int GetStagedCount() const { return static_cast<int>(m_staged.size()); }
+	const FlushStats& GetFlushStats() const { return m_flush_stats; }
+
+	// keeps an RGBA8 copy of everything uploaded from now on, for
+	// SoftRenderer, layer after layer, nullptr while disabled
+	void EnableShadow();
+	const uint8_t* GetShadow() const { return m_shadow.empty() ? nullptr : m_shadow.data(); }
 
     auto GetTexture() const { return m_tex; }
 
 private:
+	struct Staged
+	{
+		int x, y, layer;
+		// in pages, into m_staging
+		int pos;
+	};
+
+private:
+	void CreateTexture();
+
+private:
+	RenderBackend& m_backend;
+
 	size_t m_atlas_size;
 	size_t m_page_size;
 	size_t m_page_count;
+	int    m_layers;
+
+	PageFormat m_format;
+
+    RenderBackend::TexturePtr m_tex = nullptr;
+
+	size_t m_page_bytes;
+
+	std::vector<uint8_t> m_staging;
+	std::vector<Staged>  m_staged;
+	// rows of several pages interleaved for one upload
+	std::vector<uint8_t> m_run;
 
-	int m_tex_channel;
+	FlushStats m_flush_stats;
 
-    ur::TexturePtr m_tex = nullptr;
+	std::vector<uint8_t> m_shadow;
+	std::vector<uint8_t> m_shadow_page;
 
 }; // TextureAtlas
 
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "vtex/PageFormat.h"
+
+#include <textile/VTexInfo.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace textile { class PageIndexer; }
+
+namespace vtex
+{
+
+class ImageSource;
+class PageFileWriter;
+
+// Bakes a page file from a source image in one top to bottom pass.
+// Every mip level keeps only the rows of one band of pages, finer
+// levels feed the next one with box filtered rows, and finished bands
+// are cut into bordered pages and encoded on a thread pool. The rows
+// of a read are filtered on the pool too, split into column ranges,
+// level after level. Memory is about two bands of the finest level,
+// independent of the height.
+// The output is a PageFile, not the format textile::PageLoader reads,
+// only vtex reads it. Textile's files are still read through
+// TextilePageSource, but they can't be written.
+class Tiler : private boost::noncopyable
+{
+public:
+	struct Config
+	{
+		int tile_size   = 128;
+		int border_size = 4;
+
+		PageFormat format = PageFormat::BC1;
+
+		// 0 for one per hardware thread
+		int thread_n = 0;
+
+		// source rows per ImageSource::ReadRows(), and the rows filtered
+		// at once
+		int read_rows = 64;
+	};
+
+	struct Stats
+	{
+		int levels = 0;
+		int pages  = 0;
+		uint64_t bytes = 0;
+	};
+
+public:
+	explicit Tiler(const Config& cfg);
+
+	// the source has to be square, its width a power of 2 times the
+	// tile size
+	bool Run(ImageSource& src, const std::string& filepath);
+
+	const Stats& GetStats() const { return m_stats; }
+
+	static textile::VTexInfo MakeInfo(int width, int height, int tile_size, int border_size);
+
+private:
+	struct Level
+	{
+		int width = 0, height = 0;
+		int tiles = 0;
+
+		// rows [first_row, first_row + rows.size()) of this level
+		std::deque<std::vector<uint8_t>> rows;
+		int first_row = 0;
+		int next_band = 0;
+
+		// even row waiting for its pair before going to the next level
+		std::vector<uint8_t> half;
+	};
+
+	typedef std::shared_ptr<const std::vector<uint8_t>> BandPtr;
+
+private:
+	// moves the rows out
+	void AddRows(int mip, std::vector<std::vector<uint8_t>>& rows);
+	void EmitBand(int mip);
+
+	// runs on the pool, w is the level's width
+	void WritePage(int mip, int w, int tx, int ty, const BandPtr& band);
+
+	void PushJob(std::function<void()> job);
+	// fn(0) to fn(n - 1) on the pool and the calling thread, returns
+	// when all are done
+	void ParallelFor(int n, const std::function<void(int)>& fn);
+	void WaitJobs();
+	void WorkerLoop();
+
+private:
+	Config m_cfg;
+	int m_page_size;
+
+	const textile::PageIndexer* m_indexer = nullptr;
+	PageFileWriter* m_writer = nullptr;
+
+	std::vector<Level> m_levels;
+
+	std::mutex                        m_jobs_mtx;
+	std::condition_variable           m_jobs_cv;
+	std::condition_variable           m_done_cv;
+	std::deque<std::function<void()>> m_jobs;
+	int                               m_busy = 0;
+	bool                              m_stop = false;
+
+	std::vector<std::thread> m_threads;
+
+	std::atomic<bool> m_failed;
+	std::atomic<int>  m_page_n;
+
+	Stats m_stats;
+
+}; // Tiler
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "vtex/PageFormat.h"
+#include "vtex/ReplacementPolicy.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vtex
+{
+
+class RequestTrace;
+
+// Feeds a recorded request trace through a headless VirtualTexture on
+// a RecordingBackend, with real loads from the page file, and reports
+// how the cache and loader kept up.
+class TraceReplayer
+{
+public:
+	struct Config
+	{
+		int atlas_size = 4096;
+		int atlas_layers = 1;
+
+		// atlas in the page file's format, or in `format`
+		bool file_format = true;
+		PageFormat format = PageFormat::RGBA8;
+
+		ReplacementPolicyType policy = ReplacementPolicyType::LRU;
+		int pinned_levels = 2;
+
+		// finish every load issued in a frame before the next one,
+		// makes runs repeatable, otherwise loads complete as they do
+		bool wait_loads = true;
+		// fixed upload count per frame instead of the time budget,
+		// 0 keeps the budget
+		int uploads_per_frame = 0;
+	};
+
+	struct Result
+	{
+		std::string policy;
+
+		int    frames  = 0;
+		double seconds = 0;
+
+		int64_t requests  = 0;
+		int64_t hits      = 0;
+		int64_t misses    = 0;
+		int64_t loads     = 0;
+		int64_t evictions = 0;
+
+		// frames with at least one requested page drawn from a coarser
+		// mip, and the sum of such pages over all frames
+		int     fallback_frames = 0;
+		int64_t fallback_pages  = 0;
+
+		// frames from a page's first miss to its frame of residency,
+		// latency_hist[i] pages took i frames, the last bucket holds
+		// everything slower
+		std::vector<int> latency_hist;
+		// went out of view before they were loaded
+		int abandoned = 0;
+
+		// mean time of VirtualTexture::Update() per frame
+		float update_ms = 0;
+
+		float HitRate() const {
+			return requests > 0 ? static_cast<float>(hits) / requests : 0.0f;
+		}
+		double FramesPerSecond() const {
+			return seconds > 0 ? frames / seconds : 0;
+		}
+		// frames within which the p quantile of loads completed
+		int LatencyPercentile(float p) const;
+	};
+
+public:
+	TraceReplayer(const Config& cfg);
+
+	bool Run(const RequestTrace& trace, const std::string& vtex_path, Result& result) const;
+
+private:
+	Config m_cfg;
+
+}; // TraceReplayer
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <functional>
+
+namespace vtex
+{
+
+// Decides how many finished pages are uploaded per frame. Spends a
+// millisecond and/or byte budget, predicting the cost of the next page
+// from a moving average of measured ones.
+class UploadScheduler : private boost::noncopyable
+{
+public:
+	struct Config
+	{
+		// 0 disables the limit
+		float  budget_ms    = 2.0f;
+		size_t budget_bytes = 0;
+
+		// uploaded even if over budget, so loading never stalls
+		int min_pages = 1;
+		int max_pages = 256;
+
+		// weight of the newest sample in the moving averages
+		float smoothing = 0.2f;
+	};
+
+	// current time in milliseconds
+	typedef std::function<double()> Clock;
+
+public:
+	UploadScheduler(const Config& cfg, const Clock& clock = nullptr);
+
+	void BeginFrame();
+	// ready: finished pages left waiting for a later frame
+	void EndFrame(int ready);
+
+	bool CanUpload(size_t bytes) const;
+
+	void BeginUpload();
+	void EndUpload(size_t bytes);
+
+	// measured on loader threads, only tracked for reporting
+	void RecordDecode(float ms);
+
+	// pages are staged by the uploads and written to the texture by
+	// a flush after the frame's last one, its cost per byte is added
+	// to the predicted cost of every page of the frame
+	void RecordFlush(size_t bytes, float ms);
+
+	const Config& GetConfig() const { return m_cfg; }
+	void SetConfig(const Config& cfg) { m_cfg = cfg; }
+
+	int    GetFramePages() const { return m_frame_pages; }
+	size_t GetFrameBytes() const { return m_frame_bytes; }
+	float  GetFrameMs() const { return m_frame_ms; }
+
+	int GetDeferredCount() const { return m_deferred; }
+
+	float GetAvgUploadMs() const { return m_avg_upload_ms; }
+	float GetAvgDecodeMs() const { return m_avg_decode_ms; }
+
+private:
+	double Now() const;
+
+private:
+	Config m_cfg;
+	Clock  m_clock;
+
+	double m_frame_start = 0;
+	double m_upload_start = 0;
+
+	int    m_frame_pages = 0;
+	size_t m_frame_bytes = 0;
+	float  m_frame_ms = 0;
+
+	int m_deferred = 0;
+
+	// per byte, so pages of different formats share one estimate
+	double m_ms_per_byte = 0;
+	double m_flush_ms_per_byte = 0;
+
+	float m_avg_upload_ms = 0;
+	float m_avg_decode_ms = 0;
+
+}; // UploadScheduler
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "vtex/RenderBackend.h"
+
+#include <unirender/typedef.h>
+
+#include <memory>
+#include <vector>
+
+namespace ur { class Device; class Context; class Framebuffer; }
+
+namespace vtex
+{
+
+// RenderBackend on a unirender device.
+class UrBackend : public RenderBackend
+{
+public:
+	UrBackend(const ur::Device& dev);
+
+	// context of the frame being drawn, used by the render target
+	// switches, readbacks and debug draws
+	void SetContext(ur::Context& ctx) { m_ctx = &ctx; }
+
+	virtual TexturePtr CreateTexture(int width, int height,
+		PageFormat fmt, const uint8_t* pixels) override;
+	virtual TexturePtr CreateTextureArray(int width, int height,
+		int layers, PageFormat fmt) override;
+	virtual void Upload(Texture& tex, const uint8_t* pixels,
+		int x, int y, int w, int h, int level = 0, int layer = 0) override;
+	// not on the device: src is attached to a framebuffer, read back to
+	// memory and uploaded to dst. So false for block compressed formats
+	// and array sources, which can not be attached, and while no context
+	// is set, that is before the first VirtualTexture::Draw()
+	virtual bool Copy(const Texture& src, int sx, int sy,
+		Texture& dst, int dx, int dy, int w, int h,
+		int src_layer = 0, int dst_layer = 0) override;
+
+	virtual RenderTargetPtr CreateRenderTarget(int width, int height) override;
+	virtual void BindRenderTarget(const RenderTarget& rt) override;
+	virtual void UnbindRenderTarget() override;
+	virtual void ReadPixels(const RenderTarget* rt, uint8_t* dst, int w, int h) override;
+
+	virtual void DebugDraw(const Texture& tex, int slot) override;
+
+	// nullptr if tex was not created by a UrBackend
+	static ur::TexturePtr GetTexture(const Texture& tex);
+
+private:
+	class UrTexture : public Texture
+	{
+	public:
+		UrTexture(int width, int height, PageFormat fmt, const ur::TexturePtr& tex, int layers = 1)
+			: Texture(width, height, fmt, layers), tex(tex) {}
+
+		ur::TexturePtr tex = nullptr;
+	};
+
+	class UrRenderTarget : public RenderTarget
+	{
+	public:
+		UrRenderTarget(int width, int height)
+			: RenderTarget(width, height) {}
+
+		ur::TexturePtr depth_tex = nullptr;
+		std::shared_ptr<ur::Framebuffer> fbo = nullptr;
+	};
+
+private:
+	const ur::Device& m_dev;
+
+	ur::Context* m_ctx = nullptr;
+
+	std::shared_ptr<ur::Framebuffer> m_prev_fbo = nullptr;
+
+	// Copy()
+	std::shared_ptr<ur::Framebuffer> m_copy_fbo = nullptr;
+	std::vector<uint8_t> m_copy_buf;
+
+}; // UrBackend
+
+}
@@ -1,15 +1,20 @@
 #pragma once
 
 #include "vtex/FeedbackBuffer.h"
-#include "vtex/TextureAtlas.h"
-#include "vtex/PageCache.h"
+#include "vtex/PagePool.h"
 #include "vtex/PageTable.h"
+#include "vtex/PageSource.h"
+#include "vtex/PagePrefetcher.h"
+#include "vtex/LoadQueue.h"
+#include "vtex/MipBiasController.h"
+#include "vtex/Telemetry.h"
+#include "vtex/RequestTraceWriter.h"
 
 #include <textile/Page.h>
 #include <textile/VTexInfo.h>
 #include <textile/PageIndexer.h>
-#include <textile/PageLoader.h>
 
+#include <memory>
 #include <vector>
 #include <functional>
 
@@ -18,38 +23,148 @@ namespace ur { class Device; class Context; class ShaderProgram; }
 namespace vtex
 {
 
+class TextilePageSource;
+
+// Construction settings, defaults are the former built in values.
+struct VirtualTextureConfig
+{
+	// the pool created by a texture that does not share one
+	PagePool::Config pool;
+	// of that pool's atlas, block compressed formats keep pages
+	// compressed on the device, pages are transcoded to it on load
+	PageFormat atlas_format = PageFormat::RGBA8;
+
+	// square feedback target, in pixels
+	int feedback_size = 128;
+	// frames between rendering the feedback and reading it back
+	int feedback_latency = 2;
+	// analyze the feedback on a worker thread
+	bool feedback_async = true;
+	// 1, 2 or 4, renders and reads back one jittered pixel of every
+	// n x n block of the feedback a frame, see FeedbackBuffer, a
+	// changed view is complete after n * n feedback frames
+	int feedback_subsample = 1;
+
+	// texels of a file without the PageFile header, the format
+	// textile::PageLoader reads, see TextilePageSource
+	int textile_channels = 4;
+
+	// subtracted from the feedback's mip, makes up for the feedback
+	// target being smaller than the screen, higher requests finer pages,
+	// the starting value of the controller
+	int mip_bias = 3;
+	MipBiasController::Config mip_bias_control;
+
+	LoadQueue::Config      load_priority;
+	PagePrefetcher::Config prefetch;
+
+}; // VirtualTextureConfig
+
 class VirtualTexture : private boost::noncopyable
 {
 public:
 	VirtualTexture(const ur::Device& dev, const std::string& filepath,
         const textile::VTexInfo& info, int atlas_channel, int feedback_size);
+	VirtualTexture(const ur::Device& dev, const std::string& filepath,
+        const textile::VTexInfo& info, const VirtualTextureConfig& cfg);
+	// shares the atlas and cache with other textures, the owner calls
+	// PagePool::Update() once per frame after drawing all of them, the
+	// pool needs a UrBackend on dev, cfg.pool is not used
+	VirtualTexture(const ur::Device& dev, const std::string& filepath,
+        const textile::VTexInfo& info, const std::shared_ptr<PagePool>& pool, const VirtualTextureConfig& cfg);
+	// without shaders, on any backend, only Stream() and Replay() can
+	// be used, files in the textile format need Draw() and fail
+	VirtualTexture(const std::string& filepath, const textile::VTexInfo& info,
+		const std::shared_ptr<PagePool>& pool, const VirtualTextureConfig& cfg);
+	~VirtualTexture();
 
-	void Draw(const ur::Device& dev, ur::Context& ctx,
-        std::function<void()> draw_cb);
-
-	void ClearCache() { m_cache.Clear(); }
-	textile::PageLoader& GetPageLoader() { return m_loader; }
+	// false if the file could not be opened or is in the textile format
+	// without a device, nothing streams
+	bool IsValid() const { return m_source->IsValid(); }
 
-	void DecreaseMipBias();
+	void Draw(const ur::Device& dev, ur::Context& ctx,
+        const std::function<void()>& draw_cb);
+
+	// the feedback pass and streaming part of Draw(), draw_cb renders
+	// the feedback, on a RecordingBackend with DrawPixels()
+	void Stream(const std::function<void()>& draw_cb);
+
+	// a frame of Stream() with recorded requests instead of feedback
+	void Replay(const RequestSet& requests);
+
+	// feedback analysis on a worker thread, on by default, Stream()
+	// then uses the newest finished analysis instead of waiting for it
+	void SetAsyncFeedback(bool async) { m_feedback.SetAsync(async); }
+	// blocks until the worker analyzed every feedback read back
+	void WaitFeedback() { m_feedback.WaitAnalysis(); }
+
+	// target size and jitter of the current feedback pass, for drawing
+	// it without the feedback shader
+	const FeedbackBuffer& GetFeedbackBuffer() const { return m_feedback; }
+	// the controller's bias plus the subsampling's, what the feedback
+	// shader subtracts
+	float GetFeedbackMipBias() const;
+
+	// every feedback frame read back is added to it, nullptr stops
+	void SetTraceWriter(RequestTraceWriter* writer) { m_trace_writer = writer; }
+
+	void ClearCache() { m_pool->GetCache().Clear(m_tex_id); }
+	// global for all textures of the pool
+	void SetCachePolicy(ReplacementPolicyType type) {
+		m_pool->GetCache().SetPolicy(ReplacementPolicy::Create(type));
+	}
+	const std::shared_ptr<PagePool>& GetPagePool() const { return m_pool; }
+	// for every texture of the pool, see PagePool::ResizeAtlas()
+	void ResizeAtlas(size_t atlas_size) { m_pool->ResizeAtlas(atlas_size); }
+	AsyncPageLoader& GetPageLoader() { return m_pool->GetPageLoader(); }
+	UploadScheduler& GetUploadScheduler() { return m_pool->GetUploadScheduler(); }
+
+	// overrides the controller's bias, it goes on from there, a config
+	// with min_bias == max_bias fixes the bias
+	void SetMipBias(int bias);
+	int GetMipBias() const { return m_mip_bias.GetBias(); }
+	void SetMipBiasControl(const MipBiasController::Config& cfg);
+	const MipBiasController& GetMipBiasController() const { return m_mip_bias; }
+
+	// optional, see PagePrefetcher::SetMotionHint()
+	void SetMotionHint(float du, float dv, float zoom) {
+		m_prefetcher.SetMotionHint(du, dv, zoom);
+	}
+	const PagePrefetcher::Stats& GetPrefetchStats() const {
+		return m_prefetcher.GetStats();
+	}
+
+	// weights of the misses' load priority
+	void SetLoadPriority(const LoadQueue::Config& cfg) { m_load_queue.SetConfig(cfg); }
+	const LoadQueue& GetLoadQueue() const { return m_load_queue; }
+
+	// a frame is recorded by every Draw(), Stream() or Replay()
+	const Telemetry& GetTelemetry() const { return m_telemetry; }
+	Telemetry& GetTelemetry() { return m_telemetry; }
+
+	// id of the texture in the pool's cache
+	int GetTexID() const { return m_tex_id; }
+	// what the final shader samples, see SoftRenderer::RenderFinal()
+	const PageTable& GetPageTable() const { return m_table; }
 
     auto Width() const { return m_vtex_w; }
     auto Height() const { return m_vtex_h; }
 
 private:
+	// dev is null without shaders
+	VirtualTexture(const ur::Device* dev, const std::string& filepath, const textile::VTexInfo& info,
+		const std::shared_ptr<PagePool>& pool, const VirtualTextureConfig& cfg);
+
 	void InitShaders(const ur::Device& dev);
+	void UpdateAtlasScale();
+	void UpdateFeedbackJitter();
 
-	void Update(const ur::Device& dev,
-        const std::vector<int>& requests);
+	void Update(const RequestSet& requests, uint64_t feedback_frame);
 
-private:
-	struct PageWithCount
-	{
-		PageWithCount(const textile::Page& page, int count)
-			: page(page), count(count) {}
+	void EndFrame();
 
-		textile::Page page;
-		int count = 0;
-	};
+	// to the feedback shader, feedback of later frames is used
+	void ApplyMipBias();
 
 private:
 	int m_feedback_size;
@@ -59,20 +174,40 @@ private:
 
 	std::shared_ptr<ur::ShaderProgram> m_feedback_shader = nullptr;
 	std::shared_ptr<ur::ShaderProgram> m_final_shader = nullptr;
+	// the atlas size u_atlas_scale was set for
+	int m_atlas_size = 0;
 
-	TextureAtlas m_atlas;
+	std::shared_ptr<PagePool> m_pool;
+	bool m_own_pool;
 
 	textile::PageIndexer m_indexer;
-	textile::PageLoader  m_loader;
+
+	std::unique_ptr<PageSource> m_source;
+	// m_source if it is one, Draw() pumps its loader
+	TextilePageSource* m_textile = nullptr;
 
 	PageTable m_table;
-	PageCache m_cache;
+	int m_tex_id;
 
 	FeedbackBuffer m_feedback;
 
-	std::vector<PageWithCount> m_toload;
+	PagePrefetcher m_prefetcher;
+
+	LoadQueue m_load_queue;
+
+	MipBiasController m_mip_bias;
+	// feedback rendered before this frame used an older bias
+	uint64_t m_mip_bias_frame = 0;
+	// frame of the feedback the last Update() used
+	uint64_t m_feedback_frame = 0;
+
+	uint64_t m_frame = 0;
+
+	Telemetry  m_telemetry;
+	FrameStats m_frame_stats;
+	PageCache::TextureStats m_cache_stats;
 
-	int m_mip_bias;
+	RequestTraceWriter* m_trace_writer = nullptr;
 
 }; // VirtualTexture
 
@@ -1,7 +1,12 @@
 static const char* final_frag = R"(
 
 uniform sampler2D u_page_table_tex;
+#ifdef ATLAS_ARRAY
+#extension GL_EXT_texture_array : enable
+uniform sampler2DArray u_texture_atlas_tex;
+#else
 uniform sampler2D u_texture_atlas_tex;
+#endif
 
 uniform vec2 u_page_table_size;
 uniform vec2 u_virt_tex_size;
@@ -29,15 +34,15 @@ float tex_mip_level(vec2 coord, vec2 tex_size)
 }
 
 // This function samples the page table and returns the page's
-// position and mip level.
-vec3 sample_table(vec2 uv, float mip)
+// position, mip level and atlas layer.
+vec4 sample_table(vec2 uv, float mip)
 {
 	vec2 offset = fract(uv * u_page_table_size) / u_page_table_size;
-	return texture2D(u_page_table_tex, uv - offset, mip).xyz;
+	return texture2D(u_page_table_tex, uv - offset, mip);
 }
 
 // This functions samples from the texture atlas and returns the final color
-vec4 sample_atlas(vec3 page, vec2 uv)
+vec4 sample_atlas(vec4 page, vec2 uv)
 {
 	float mipsize = exp2(floor(page.z * 255.0 + 0.5));
 
@@ -47,7 +52,12 @@ vec4 sample_atlas(vec3 page, vec2 uv)
 	uv += u_border_offset;
 	vec2 offset = floor(page.xy * 255 + 0.5);
 
+#ifdef ATLAS_ARRAY
+	float layer = floor(page.w * 255.0 + 0.5);
+	return texture2DArray(u_texture_atlas_tex, vec3((offset + uv) * u_atlas_scale, layer));
+#else
 	return texture2D(u_texture_atlas_tex, (offset + uv) * u_atlas_scale);
+#endif
 }
 
 vec4 bilinear_sample()
@@ -55,7 +65,7 @@ vec4 bilinear_sample()
 	float mip = floor(tex_mip_level(v_texcoord, u_virt_tex_size));
 	mip = clamp(mip, 0, log2(u_page_table_size.x));
 
-	vec3 page = sample_table(v_texcoord, mip);
+	vec4 page = sample_table(v_texcoord, mip);
 	return sample_atlas(page, v_texcoord);
 }
 
@@ -68,8 +78,8 @@ vec4 trilinear_sample()
 	float mip2	  = mip1 + 1;
 	float mipfrac = miplevel - mip1;
 
-	vec3 page1 = sample_table(v_texcoord, mip1);
-	vec3 page2 = sample_table(v_texcoord, mip2);
+	vec4 page1 = sample_table(v_texcoord, mip1);
+	vec4 page2 = sample_table(v_texcoord, mip2);
 
 	vec4 sample1 = sample_atlas(page1, v_texcoord);
 	vec4 sample2 = sample_atlas(page2, v_texcoord);
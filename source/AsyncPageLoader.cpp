@@ -0,0 +1,326 @@
+#include "vtex/AsyncPageLoader.h"
+#include "vtex/PageSource.h"
+#include "vtex/PageCodec.h"
+#include "vtex/UploadScheduler.h"
+
+#include <chrono>
+
+#include <assert.h>
+
+namespace
+{
+
+// the page in fmt, the source's memory if it can be used as it is, else
+// written to dst, nullptr if reading failed
+const uint8_t* read_page(vtex::PageSource& src, const textile::Page& page, vtex::PageFormat fmt,
+                         size_t page_size, uint8_t* dst, std::vector<uint8_t>& read_buf, std::vector<uint8_t>& tmp_buf)
+{
+	auto src_fmt = src.GetPageFormat();
+	if (src_fmt == fmt)
+	{
+		const uint8_t* mapped = src.MapPage(page);
+		if (mapped) {
+			return mapped;
+		}
+		return src.ReadPage(page, dst) ? dst : nullptr;
+	}
+
+	// no source format is larger than RGBA8
+	if (read_buf.empty()) {
+		read_buf.resize(page_size * page_size * 4);
+		tmp_buf.resize(page_size * page_size * 4);
+	}
+	const uint8_t* pixels = src.MapPage(page);
+	if (!pixels && src.ReadPage(page, read_buf.data())) {
+		pixels = read_buf.data();
+	}
+	if (!pixels || !vtex::PageCodec::Transcode(pixels, src_fmt, dst, fmt, page_size, tmp_buf.data())) {
+		return nullptr;
+	}
+	return dst;
+}
+
+}
+
+namespace vtex
+{
+
+AsyncPageLoader::AsyncPageLoader(PageFormat fmt, size_t page_size, int thread_n, int max_in_flight)
+	: m_format(fmt)
+	, m_page_size(page_size)
+	, m_page_bytes(PageCodec::GetPageBytes(fmt, page_size))
+	, m_slots(max_in_flight)
+	, m_done(max_in_flight)
+{
+	assert(thread_n > 0 && max_in_flight > 0);
+
+	// one block for all slot buffers, reused for the loader's lifetime
+	m_buf = new uint8_t[m_page_bytes * max_in_flight];
+
+	m_in_flight.Reserve(max_in_flight);
+	m_pending.resize(max_in_flight);
+
+	m_free_slots.reserve(max_in_flight);
+	for (int i = max_in_flight - 1; i >= 0; --i)
+	{
+		m_slots[i].data = m_buf + m_page_bytes * i;
+		m_slots[i].cancelled = false;
+		m_free_slots.push_back(i);
+	}
+
+	m_threads.reserve(thread_n);
+	for (int i = 0; i < thread_n; ++i) {
+		m_threads.emplace_back(&AsyncPageLoader::WorkerLoop, this);
+	}
+}
+
+AsyncPageLoader::~AsyncPageLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_pending_mtx);
+		m_stop = true;
+	}
+	m_pending_cv.notify_all();
+	for (auto& t : m_threads) {
+		t.join();
+	}
+
+	delete[] m_buf;
+}
+
+bool AsyncPageLoader::Submit(PageSource& src, const textile::Page& page, uint64_t key)
+{
+	if (m_free_slots.empty() || m_in_flight.Contains(key)) {
+		return false;
+	}
+	assert(src.GetPageBytes() == PageCodec::GetPageBytes(src.GetPageFormat(), m_page_size));
+
+	int slot = m_free_slots.back();
+	m_free_slots.pop_back();
+
+	auto& s = m_slots[slot];
+	s.src      = &src;
+	s.page     = page;
+	s.key      = key;
+	s.mapped   = nullptr;
+	s.succeed  = false;
+	s.cancelled.store(false, std::memory_order_relaxed);
+
+	src.Prefetch(page);
+
+	m_in_flight.Insert(key, slot);
+
+	{
+		std::lock_guard<std::mutex> lock(m_pending_mtx);
+		m_pending[(m_pending_head + m_pending_n++) % m_pending.size()] = slot;
+	}
+	m_pending_cv.notify_one();
+
+	return true;
+}
+
+void AsyncPageLoader::Cancel(uint64_t key)
+{
+	if (auto slot = m_in_flight.Find(key)) {
+		m_slots[*slot].cancelled.store(true, std::memory_order_relaxed);
+	}
+}
+
+void AsyncPageLoader::CancelIf(const std::function<bool(uint64_t key)>& pred)
+{
+	m_in_flight.ForEach([&](uint64_t key, int slot) {
+		if (pred(key)) {
+			m_slots[slot].cancelled.store(true, std::memory_order_relaxed);
+		}
+	});
+}
+
+bool AsyncPageLoader::IsLoading(uint64_t key) const
+{
+	return m_in_flight.Contains(key);
+}
+
+int AsyncPageLoader::Drain(const std::function<void(uint64_t key, const textile::Page& page, const uint8_t* data)>& cb,
+	                       UploadScheduler& sched)
+{
+	sched.BeginFrame();
+
+	int drained = 0;
+
+	int slot;
+	while (sched.CanUpload(m_page_bytes) && m_done.Pop(slot))
+	{
+		auto& s = m_slots[slot];
+		if (s.succeed && !s.cancelled.load(std::memory_order_relaxed))
+		{
+			sched.RecordDecode(s.decode_ms);
+
+			sched.BeginUpload();
+			cb(s.key, s.page, s.mapped);
+			sched.EndUpload(m_page_bytes);
+
+			++drained;
+		}
+		FreeSlot(slot);
+	}
+
+	sched.EndFrame(static_cast<int>(m_done.Size()));
+
+	return drained;
+}
+
+void AsyncPageLoader::WorkerLoop()
+{
+	// pages that need transcoding are read here first
+	std::vector<uint8_t> read_buf, tmp_buf;
+
+	while (true)
+	{
+		int slot;
+		{
+			std::unique_lock<std::mutex> lock(m_pending_mtx);
+			m_pending_cv.wait(lock, [this] { return m_stop || m_pending_n > 0; });
+			if (m_stop) {
+				return;
+			}
+			slot = m_pending[m_pending_head];
+			m_pending_head = (m_pending_head + 1) % m_pending.size();
+			--m_pending_n;
+			++m_busy;
+
+			// decided under the lock, a cancel before WaitReads() is
+			// seen here or waited for there
+			m_slots[slot].reading = !m_slots[slot].cancelled.load(std::memory_order_relaxed);
+		}
+
+		auto& s = m_slots[slot];
+		if (s.reading)
+		{
+			auto start = std::chrono::steady_clock::now();
+			s.mapped = read_page(*s.src, s.page, m_format, m_page_size, s.data, read_buf, tmp_buf);
+			s.succeed = s.mapped != nullptr;
+			std::chrono::duration<float, std::milli> dt = std::chrono::steady_clock::now() - start;
+			s.decode_ms = dt.count();
+
+			// before the slot can be drained and reused
+			std::lock_guard<std::mutex> lock(m_pending_mtx);
+			s.reading = false;
+		}
+
+		bool pushed = m_done.Push(slot);
+		assert(pushed);
+		(void)pushed;
+
+		{
+			std::lock_guard<std::mutex> lock(m_pending_mtx);
+			--m_busy;
+		}
+		m_idle_cv.notify_all();
+	}
+}
+
+void AsyncPageLoader::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_pending_mtx);
+	m_idle_cv.wait(lock, [this] { return m_pending_n == 0 && m_busy == 0; });
+}
+
+void AsyncPageLoader::WaitReads(const PageSource& src)
+{
+	std::unique_lock<std::mutex> lock(m_pending_mtx);
+	m_idle_cv.wait(lock, [&] {
+		for (auto& s : m_slots) {
+			if (s.reading && s.src == &src) {
+				return false;
+			}
+		}
+		return true;
+	});
+}
+
+void AsyncPageLoader::FreeSlot(int slot)
+{
+	m_in_flight.Erase(m_slots[slot].key);
+	m_slots[slot].src = nullptr;
+	m_free_slots.push_back(slot);
+}
+
+/************************************************************************/
+/* class AsyncPageLoader::CompletionQueue                               */
+/************************************************************************/
+
+AsyncPageLoader::CompletionQueue::CompletionQueue(size_t capacity)
+{
+	size_t size = 1;
+	while (size < capacity) {
+		size <<= 1;
+	}
+
+	m_cells.reset(new Cell[size]);
+	for (size_t i = 0; i < size; ++i) {
+		m_cells[i].seq.store(i, std::memory_order_relaxed);
+	}
+	m_mask = size - 1;
+
+	m_enqueue_pos.store(0, std::memory_order_relaxed);
+	m_dequeue_pos.store(0, std::memory_order_relaxed);
+}
+
+bool AsyncPageLoader::CompletionQueue::Push(int val)
+{
+	Cell* cell;
+	size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		cell = &m_cells[pos & m_mask];
+		size_t seq = cell->seq.load(std::memory_order_acquire);
+		intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+		if (dif == 0) {
+			if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (dif < 0) {
+			return false;
+		} else {
+			pos = m_enqueue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->val = val;
+	cell->seq.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+bool AsyncPageLoader::CompletionQueue::Pop(int& val)
+{
+	Cell* cell;
+	size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		cell = &m_cells[pos & m_mask];
+		size_t seq = cell->seq.load(std::memory_order_acquire);
+		intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+		if (dif == 0) {
+			if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (dif < 0) {
+			return false;
+		} else {
+			pos = m_dequeue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	val = cell->val;
+	cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+	return true;
+}
+
+size_t AsyncPageLoader::CompletionQueue::Size() const
+{
+	size_t enqueue = m_enqueue_pos.load(std::memory_order_relaxed);
+	size_t dequeue = m_dequeue_pos.load(std::memory_order_relaxed);
+	return enqueue > dequeue ? enqueue - dequeue : 0;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,451 @@
+#include "vtex/BlockCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+
+const int TEXEL_N = 16;
+
+const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// least significant bit first, the order of all bc fields
+class BitWriter
+{
+public:
+	BitWriter(uint8_t* dst, int bytes) : m_dst(dst) { memset(dst, 0, bytes); }
+
+	void Write(uint32_t val, int bits) {
+		for (int i = 0; i < bits; ++i, ++m_pos) {
+			if (val & (1u << i)) {
+				m_dst[m_pos >> 3] |= 1 << (m_pos & 7);
+			}
+		}
+	}
+
+private:
+	uint8_t* m_dst;
+	int m_pos = 0;
+
+}; // BitWriter
+
+class BitReader
+{
+public:
+	BitReader(const uint8_t* src) : m_src(src) {}
+
+	uint32_t Read(int bits) {
+		uint32_t val = 0;
+		for (int i = 0; i < bits; ++i, ++m_pos) {
+			val |= ((m_src[m_pos >> 3] >> (m_pos & 7)) & 1) << i;
+		}
+		return val;
+	}
+
+private:
+	const uint8_t* m_src;
+	int m_pos = 0;
+
+}; // BitReader
+
+int dist_sq(const uint8_t* a, const uint8_t* b, int channels)
+{
+	int d = 0;
+	for (int i = 0; i < channels; ++i) {
+		int v = a[i] - b[i];
+		d += v * v;
+	}
+	return d;
+}
+
+// texels with the lowest and highest projection on the principal axis
+void find_endpoints(const uint8_t* rgba, int channels, uint8_t* lo, uint8_t* hi)
+{
+	float mean[4] = { 0, 0, 0, 0 };
+	for (int i = 0; i < TEXEL_N; ++i) {
+		for (int c = 0; c < channels; ++c) {
+			mean[c] += rgba[i * 4 + c];
+		}
+	}
+	for (int c = 0; c < channels; ++c) {
+		mean[c] /= TEXEL_N;
+	}
+
+	float cov[4][4] = {};
+	for (int i = 0; i < TEXEL_N; ++i)
+	{
+		float d[4];
+		for (int c = 0; c < channels; ++c) {
+			d[c] = rgba[i * 4 + c] - mean[c];
+		}
+		for (int r = 0; r < channels; ++r) {
+			for (int c = 0; c < channels; ++c) {
+				cov[r][c] += d[r] * d[c];
+			}
+		}
+	}
+
+	// power iteration, a few steps are plenty for 16 texels
+	float axis[4] = { 1, 1, 1, 1 };
+	for (int step = 0; step < 8; ++step)
+	{
+		float next[4] = { 0, 0, 0, 0 };
+		float len = 0;
+		for (int r = 0; r < channels; ++r)
+		{
+			for (int c = 0; c < channels; ++c) {
+				next[r] += cov[r][c] * axis[c];
+			}
+			len = std::max(len, std::abs(next[r]));
+		}
+		if (len == 0) {
+			break;
+		}
+		for (int c = 0; c < channels; ++c) {
+			axis[c] = next[c] / len;
+		}
+	}
+
+	int min_i = 0, max_i = 0;
+	float min_p = 0, max_p = 0;
+	for (int i = 0; i < TEXEL_N; ++i)
+	{
+		float p = 0;
+		for (int c = 0; c < channels; ++c) {
+			p += (rgba[i * 4 + c] - mean[c]) * axis[c];
+		}
+		if (i == 0 || p < min_p) {
+			min_p = p;
+			min_i = i;
+		}
+		if (i == 0 || p > max_p) {
+			max_p = p;
+			max_i = i;
+		}
+	}
+
+	memcpy(lo, rgba + min_i * 4, 4);
+	memcpy(hi, rgba + max_i * 4, 4);
+}
+
+uint16_t pack_565(const uint8_t* c)
+{
+	int r = (c[0] * 31 + 127) / 255;
+	int g = (c[1] * 63 + 127) / 255;
+	int b = (c[2] * 31 + 127) / 255;
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpack_565(uint16_t v, uint8_t* c)
+{
+	int r = (v >> 11) & 0x1f;
+	int g = (v >> 5) & 0x3f;
+	int b = v & 0x1f;
+	c[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+	c[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+	c[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+	c[3] = 255;
+}
+
+void color_palette(uint16_t c0, uint16_t c1, bool four_colors, uint8_t palette[4][4])
+{
+	unpack_565(c0, palette[0]);
+	unpack_565(c1, palette[1]);
+	for (int c = 0; c < 3; ++c)
+	{
+		if (four_colors) {
+			palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+			palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+		} else {
+			palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+			palette[3][c] = 0;
+		}
+	}
+	palette[2][3] = 255;
+	palette[3][3] = four_colors ? 255 : 0;
+}
+
+// 8 bytes, always in four color mode
+void encode_color(const uint8_t* rgba, uint8_t* dst)
+{
+	uint8_t lo[4], hi[4];
+	find_endpoints(rgba, 3, lo, hi);
+
+	// inset by 1/16 of the range, the extremes are rarely hit exactly
+	for (int c = 0; c < 3; ++c)
+	{
+		int inset = (hi[c] - lo[c]) / 16;
+		hi[c] = static_cast<uint8_t>(hi[c] - inset);
+		lo[c] = static_cast<uint8_t>(lo[c] + inset);
+	}
+
+	uint16_t c0 = pack_565(hi);
+	uint16_t c1 = pack_565(lo);
+	if (c0 < c1) {
+		std::swap(c0, c1);
+	}
+
+	uint32_t indices = 0;
+	if (c0 != c1)
+	{
+		uint8_t palette[4][4];
+		color_palette(c0, c1, true, palette);
+		for (int i = 0; i < TEXEL_N; ++i)
+		{
+			int best = 0;
+			int best_d = dist_sq(rgba + i * 4, palette[0], 3);
+			for (int j = 1; j < 4; ++j)
+			{
+				int d = dist_sq(rgba + i * 4, palette[j], 3);
+				if (d < best_d) {
+					best_d = d;
+					best = j;
+				}
+			}
+			indices |= best << (i * 2);
+		}
+	}
+
+	dst[0] = c0 & 0xff;
+	dst[1] = c0 >> 8;
+	dst[2] = c1 & 0xff;
+	dst[3] = c1 >> 8;
+	for (int i = 0; i < 4; ++i) {
+		dst[4 + i] = (indices >> (i * 8)) & 0xff;
+	}
+}
+
+void decode_color(const uint8_t* src, uint8_t* rgba, bool bc1)
+{
+	uint16_t c0 = src[0] | (src[1] << 8);
+	uint16_t c1 = src[2] | (src[3] << 8);
+
+	uint8_t palette[4][4];
+	color_palette(c0, c1, !bc1 || c0 > c1, palette);
+
+	uint32_t indices = src[4] | (src[5] << 8) | (src[6] << 16) | (static_cast<uint32_t>(src[7]) << 24);
+	for (int i = 0; i < TEXEL_N; ++i) {
+		memcpy(rgba + i * 4, palette[(indices >> (i * 2)) & 3], 4);
+	}
+}
+
+void alpha_palette(uint8_t a0, uint8_t a1, uint8_t palette[8])
+{
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1)
+	{
+		for (int i = 1; i < 7; ++i) {
+			palette[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1) / 7);
+		}
+	}
+	else
+	{
+		for (int i = 1; i < 5; ++i) {
+			palette[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1) / 5);
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+// 8 bytes, always in eight alpha mode
+void encode_alpha(const uint8_t* rgba, uint8_t* dst)
+{
+	uint8_t a0 = 0, a1 = 255;
+	for (int i = 0; i < TEXEL_N; ++i)
+	{
+		a0 = std::max(a0, rgba[i * 4 + 3]);
+		a1 = std::min(a1, rgba[i * 4 + 3]);
+	}
+
+	BitWriter writer(dst, 8);
+	writer.Write(a0, 8);
+	writer.Write(a1, 8);
+
+	uint8_t palette[8];
+	alpha_palette(a0, a1, palette);
+	for (int i = 0; i < TEXEL_N; ++i)
+	{
+		int best = 0;
+		if (a0 != a1)
+		{
+			int best_d = 256;
+			for (int j = 0; j < 8; ++j)
+			{
+				int d = std::abs(rgba[i * 4 + 3] - palette[j]);
+				if (d < best_d) {
+					best_d = d;
+					best = j;
+				}
+			}
+		}
+		writer.Write(best, 3);
+	}
+}
+
+void decode_alpha(const uint8_t* src, uint8_t* rgba)
+{
+	uint8_t palette[8];
+	alpha_palette(src[0], src[1], palette);
+
+	BitReader reader(src + 2);
+	for (int i = 0; i < TEXEL_N; ++i) {
+		rgba[i * 4 + 3] = palette[reader.Read(3)];
+	}
+}
+
+// 7 bit value with a p bit, shared by all channels of the endpoint
+void quantize_bc7_endpoint(const uint8_t* c, uint8_t* q, int& pbit)
+{
+	int best_err = -1;
+	for (int p = 0; p < 2; ++p)
+	{
+		uint8_t val[4];
+		int err = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			int v = std::min(std::max((c[i] - p + 1) >> 1, 0), 127);
+			int d = ((v << 1) | p) - c[i];
+			err += d * d;
+			val[i] = static_cast<uint8_t>(v);
+		}
+		if (best_err < 0 || err < best_err)
+		{
+			best_err = err;
+			pbit = p;
+			memcpy(q, val, 4);
+		}
+	}
+}
+
+void bc7_palette(const uint8_t* e0, const uint8_t* e1, uint8_t palette[16][4])
+{
+	for (int i = 0; i < 16; ++i) {
+		for (int c = 0; c < 4; ++c) {
+			palette[i][c] = static_cast<uint8_t>(((64 - BC7_WEIGHTS4[i]) * e0[c] + BC7_WEIGHTS4[i] * e1[c] + 32) >> 6);
+		}
+	}
+}
+
+}
+
+namespace vtex
+{
+
+void BlockCodec::EncodeBC1(const uint8_t* rgba, uint8_t* dst)
+{
+	encode_color(rgba, dst);
+}
+
+void BlockCodec::EncodeBC3(const uint8_t* rgba, uint8_t* dst)
+{
+	encode_alpha(rgba, dst);
+	encode_color(rgba, dst + 8);
+}
+
+void BlockCodec::EncodeBC7(const uint8_t* rgba, uint8_t* dst)
+{
+	uint8_t lo[4], hi[4];
+	find_endpoints(rgba, 4, lo, hi);
+
+	uint8_t q[2][4];
+	int pbits[2];
+	quantize_bc7_endpoint(lo, q[0], pbits[0]);
+	quantize_bc7_endpoint(hi, q[1], pbits[1]);
+
+	uint8_t e[2][4];
+	for (int i = 0; i < 2; ++i) {
+		for (int c = 0; c < 4; ++c) {
+			e[i][c] = static_cast<uint8_t>((q[i][c] << 1) | pbits[i]);
+		}
+	}
+
+	uint8_t palette[16][4];
+	bc7_palette(e[0], e[1], palette);
+
+	int indices[TEXEL_N];
+	for (int i = 0; i < TEXEL_N; ++i)
+	{
+		int best = 0;
+		int best_d = dist_sq(rgba + i * 4, palette[0], 4);
+		for (int j = 1; j < 16; ++j)
+		{
+			int d = dist_sq(rgba + i * 4, palette[j], 4);
+			if (d < best_d) {
+				best_d = d;
+				best = j;
+			}
+		}
+		indices[i] = best;
+	}
+
+	// the first index is stored without its high bit
+	if (indices[0] & 8)
+	{
+		std::swap(q[0], q[1]);
+		std::swap(pbits[0], pbits[1]);
+		for (auto& idx : indices) {
+			idx = 15 - idx;
+		}
+	}
+
+	BitWriter writer(dst, 16);
+	writer.Write(1 << 6, 7);
+	for (int c = 0; c < 4; ++c) {
+		writer.Write(q[0][c], 7);
+		writer.Write(q[1][c], 7);
+	}
+	writer.Write(pbits[0], 1);
+	writer.Write(pbits[1], 1);
+	writer.Write(indices[0], 3);
+	for (int i = 1; i < TEXEL_N; ++i) {
+		writer.Write(indices[i], 4);
+	}
+}
+
+void BlockCodec::DecodeBC1(const uint8_t* src, uint8_t* rgba)
+{
+	decode_color(src, rgba, true);
+}
+
+void BlockCodec::DecodeBC3(const uint8_t* src, uint8_t* rgba)
+{
+	decode_color(src + 8, rgba, false);
+	decode_alpha(src, rgba);
+}
+
+bool BlockCodec::DecodeBC7(const uint8_t* src, uint8_t* rgba)
+{
+	BitReader reader(src);
+	if (reader.Read(7) != (1 << 6)) {
+		return false;
+	}
+
+	uint8_t e[2][4];
+	for (int c = 0; c < 4; ++c) {
+		e[0][c] = static_cast<uint8_t>(reader.Read(7) << 1);
+		e[1][c] = static_cast<uint8_t>(reader.Read(7) << 1);
+	}
+	for (int i = 0; i < 2; ++i)
+	{
+		uint32_t p = reader.Read(1);
+		for (int c = 0; c < 4; ++c) {
+			e[i][c] |= p;
+		}
+	}
+
+	uint8_t palette[16][4];
+	bc7_palette(e[0], e[1], palette);
+
+	for (int i = 0; i < TEXEL_N; ++i) {
+		memcpy(rgba + i * 4, palette[reader.Read(i == 0 ? 3 : 4)], 4);
+	}
+
+	return true;
+}
+
+}
@@ -0,0 +1,106 @@
+#include "vtex/CacheSimulator.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace vtex
+{
+
+CacheSimulator::CacheSimulator(int capacity, int loads_per_frame)
+	: m_capacity(capacity)
+	, m_loads_per_frame(loads_per_frame)
+{
+}
+
+CacheSimulator::Result
+CacheSimulator::Run(ReplacementPolicy& policy, const std::vector<RequestFrame>& frames) const
+{
+	Result ret;
+	ret.policy = policy.GetName();
+
+	policy.Reset(m_capacity);
+
+	std::unordered_map<int, int> lookup;
+	std::vector<int> slot2page(m_capacity, -1);
+	int used = 0;
+
+	std::vector<PageRequest> misses;
+	for (auto& frame : frames)
+	{
+		policy.OnFrame();
+
+		misses.clear();
+		for (auto& req : frame)
+		{
+			++ret.requests;
+			auto itr = lookup.find(req.page_idx);
+			if (itr != lookup.end())
+			{
+				++ret.hits;
+				policy.OnTouch(itr->second, req.count);
+			}
+			else
+			{
+				++ret.misses;
+				misses.push_back(req);
+			}
+		}
+
+		// most requested first, see the class comment for how this
+		// differs from the real cache
+		std::sort(misses.begin(), misses.end(), [](const PageRequest& a, const PageRequest& b) {
+			return a.count > b.count;
+		});
+
+		int load_n = static_cast<int>(misses.size());
+		if (m_loads_per_frame > 0) {
+			load_n = std::min(load_n, m_loads_per_frame);
+		}
+		for (int i = 0; i < load_n; ++i)
+		{
+			int slot;
+			if (used < m_capacity)
+			{
+				slot = used++;
+			}
+			else
+			{
+				slot = policy.SelectVictim(nullptr);
+				if (slot < 0) {
+					break;
+				}
+				lookup.erase(slot2page[slot]);
+				policy.OnRemove(slot);
+				++ret.evictions;
+			}
+
+			slot2page[slot] = misses[i].page_idx;
+			lookup.insert({ misses[i].page_idx, slot });
+			policy.OnInsert(slot);
+			++ret.loads;
+		}
+	}
+
+	return ret;
+}
+
+std::vector<CacheSimulator::Result>
+CacheSimulator::RunAll(const std::vector<RequestFrame>& frames) const
+{
+	std::vector<Result> ret;
+
+	const ReplacementPolicyType types[] = {
+		ReplacementPolicyType::LRU,
+		ReplacementPolicyType::CLOCK,
+		ReplacementPolicyType::LFU,
+	};
+	for (auto type : types)
+	{
+		auto policy = ReplacementPolicy::Create(type);
+		ret.push_back(Run(*policy, frames));
+	}
+
+	return ret;
+}
+
+}
@@ -0,0 +1,55 @@
+#include "vtex/ClockPolicy.h"
+
+namespace vtex
+{
+
+void ClockPolicy::Reset(int slot_n)
+{
+	m_resident.assign(slot_n, 0);
+	m_referenced.assign(slot_n, 0);
+	m_hand = 0;
+}
+
+void ClockPolicy::OnInsert(int slot)
+{
+	m_resident[slot] = 1;
+	m_referenced[slot] = 1;
+}
+
+void ClockPolicy::OnRemove(int slot)
+{
+	m_resident[slot] = 0;
+	m_referenced[slot] = 0;
+}
+
+void ClockPolicy::OnTouch(int slot, int)
+{
+	m_referenced[slot] = 1;
+}
+
+int ClockPolicy::SelectVictim(const std::function<bool(int slot)>& evictable)
+{
+	const int n = static_cast<int>(m_resident.size());
+	if (n == 0) {
+		return -1;
+	}
+
+	// two sweeps, the first one may only clear reference bits
+	for (int i = 0; i < n * 2; ++i)
+	{
+		int slot = m_hand;
+		m_hand = (m_hand + 1) % n;
+
+		if (!m_resident[slot] || (evictable && !evictable(slot))) {
+			continue;
+		}
+		if (m_referenced[slot]) {
+			m_referenced[slot] = 0;
+			continue;
+		}
+		return slot;
+	}
+	return -1;
+}
+
+}
@@ -0,0 +1,267 @@
+#include "vtex/FeedbackAnalyzer.h"
+
+#include <textile/Page.h>
+#include <textile/PageIndexer.h>
+
+#include <cstring>
+
+#if defined(__AVX2__)
+#define VTEX_FEEDBACK_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VTEX_FEEDBACK_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+const uint32_t ALPHA_MASK = 0xff000000;
+
+const size_t MIN_TABLE_SIZE = 1024;
+
+// pixels are read as little endian words: r | g << 8 | b << 16 | a << 24
+inline bool is_valid_key(uint32_t key)
+{
+	return (key & ALPHA_MASK) == ALPHA_MASK;
+}
+
+inline uint32_t make_key(int x, int y, int mip)
+{
+	return ALPHA_MASK | (mip << 16) | (y << 8) | x;
+}
+
+inline uint32_t hash_key(uint32_t key)
+{
+	key *= 0x9e3779b1;
+	return key ^ (key >> 16);
+}
+
+inline uint32_t load_key(const uint8_t* pixel)
+{
+	uint32_t key;
+	memcpy(&key, pixel, sizeof(key));
+	return key;
+}
+
+}
+
+namespace vtex
+{
+
+FeedbackAnalyzer::FeedbackAnalyzer(const textile::PageIndexer& indexer, int max_mip)
+	: m_indexer(indexer)
+	, m_max_mip(max_mip)
+{
+	m_table.resize(MIN_TABLE_SIZE, Item{ 0, 0 });
+	m_levels.resize(max_mip + 1);
+}
+
+void FeedbackAnalyzer::Analyze(const uint8_t* pixels, size_t pixel_n, RequestSet& requests)
+{
+	CollectKeys(pixels, pixel_n);
+	if (!m_history.empty()) {
+		MergeHistory();
+	}
+	ExpandKeys(requests);
+}
+
+void FeedbackAnalyzer::SetHistory(int frames)
+{
+	m_history.clear();
+	m_history_next = 0;
+	if (frames > 1) {
+		m_history.resize(frames);
+	}
+}
+
+void FeedbackAnalyzer::CollectKeys(const uint8_t* pixels, size_t pixel_n)
+{
+	ResetTable();
+
+	// neighbouring pixels mostly hold the same page, so merge runs
+	// before touching the hash table
+	uint32_t run_key = 0;
+	uint32_t run_n = 0;
+
+	auto flush = [&]() {
+		if (run_n > 0 && is_valid_key(run_key)) {
+			InsertKey(run_key, run_n);
+		}
+	};
+	auto step = [&](uint32_t key) {
+		if (key == run_key) {
+			++run_n;
+		} else {
+			flush();
+			run_key = key;
+			run_n = 1;
+		}
+	};
+
+	size_t i = 0;
+
+#if defined(VTEX_FEEDBACK_AVX2)
+	const __m256i alpha = _mm256_set1_epi32(static_cast<int>(ALPHA_MASK));
+	for (; i + 8 <= pixel_n; i += 8)
+	{
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + i * 4));
+		const __m256i run = _mm256_set1_epi32(static_cast<int>(run_key));
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(v, run)) == -1) {
+			run_n += 8;
+			continue;
+		}
+		const __m256i valid = _mm256_cmpeq_epi32(_mm256_and_si256(v, alpha), alpha);
+		if (_mm256_movemask_epi8(valid) == 0) {
+			flush();
+			run_key = 0;
+			run_n = 0;
+			continue;
+		}
+		for (size_t j = 0; j < 8; ++j) {
+			step(load_key(pixels + (i + j) * 4));
+		}
+	}
+#elif defined(VTEX_FEEDBACK_SSE2)
+	const __m128i alpha = _mm_set1_epi32(static_cast<int>(ALPHA_MASK));
+	for (; i + 4 <= pixel_n; i += 4)
+	{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i * 4));
+		const __m128i run = _mm_set1_epi32(static_cast<int>(run_key));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(v, run)) == 0xffff) {
+			run_n += 4;
+			continue;
+		}
+		const __m128i valid = _mm_cmpeq_epi32(_mm_and_si128(v, alpha), alpha);
+		if (_mm_movemask_epi8(valid) == 0) {
+			flush();
+			run_key = 0;
+			run_n = 0;
+			continue;
+		}
+		for (size_t j = 0; j < 4; ++j) {
+			step(load_key(pixels + (i + j) * 4));
+		}
+	}
+#endif
+
+	for (; i < pixel_n; ++i) {
+		step(load_key(pixels + i * 4));
+	}
+	flush();
+}
+
+void FeedbackAnalyzer::MergeHistory()
+{
+	// this frame's keys replace the oldest frame's
+	auto& frame = m_history[m_history_next];
+	m_history_next = (m_history_next + 1) % m_history.size();
+
+	frame.clear();
+	for (auto pos : m_used) {
+		frame.push_back(m_table[pos]);
+	}
+
+	for (auto& prev : m_history) {
+		if (&prev != &frame) {
+			for (auto& item : prev) {
+				InsertKey(item.key, item.count);
+			}
+		}
+	}
+}
+
+void FeedbackAnalyzer::ExpandKeys(RequestSet& requests)
+{
+	m_unique_n = m_used.size();
+	for (auto pos : m_used)
+	{
+		auto& item = m_table[pos];
+		int mip = (item.key >> 16) & 0xff;
+		if (mip <= m_max_mip) {
+			m_levels[mip].push_back(item);
+		}
+	}
+
+	// walk from fine to coarse, parents shared by several keys are
+	// merged before the indexer sees them
+	for (int mip = 0; mip <= m_max_mip; ++mip)
+	{
+		auto& items = m_levels[mip];
+		if (items.empty()) {
+			continue;
+		}
+
+		ResetTable();
+		for (auto& item : items) {
+			InsertKey(item.key, item.count);
+		}
+		items.clear();
+
+		for (auto pos : m_used)
+		{
+			auto& item = m_table[pos];
+			int x = item.key & 0xff;
+			int y = (item.key >> 8) & 0xff;
+
+			int idx = m_indexer.CalcPageIdx(textile::Page(x, y, mip));
+			requests.Add(idx, item.count);
+
+			if (mip < m_max_mip) {
+				m_levels[mip + 1].push_back(Item{ make_key(x >> 1, y >> 1, mip + 1), item.count });
+			}
+		}
+	}
+}
+
+void FeedbackAnalyzer::InsertKey(uint32_t key, uint32_t count)
+{
+	if ((m_used.size() + 1) * 2 > m_table.size()) {
+		Grow();
+	}
+
+	const uint32_t mask = static_cast<uint32_t>(m_table.size() - 1);
+	uint32_t pos = hash_key(key) & mask;
+	while (true)
+	{
+		auto& item = m_table[pos];
+		if (item.key == key)
+		{
+			item.count += count;
+			return;
+		}
+		if (item.key == 0)
+		{
+			item.key = key;
+			item.count = count;
+			m_used.push_back(pos);
+			return;
+		}
+		pos = (pos + 1) & mask;
+	}
+}
+
+void FeedbackAnalyzer::ResetTable()
+{
+	for (auto pos : m_used) {
+		m_table[pos] = Item{ 0, 0 };
+	}
+	m_used.clear();
+}
+
+void FeedbackAnalyzer::Grow()
+{
+	std::vector<Item> items;
+	items.reserve(m_used.size());
+	for (auto pos : m_used) {
+		items.push_back(m_table[pos]);
+	}
+
+	m_table.assign(m_table.size() * 2, Item{ 0, 0 });
+	m_used.clear();
+	for (auto& item : items) {
+		InsertKey(item.key, item.count);
+	}
+}
+
+}
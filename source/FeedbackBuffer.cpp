@@ -1,39 +1,56 @@
 #include "vtex/FeedbackBuffer.h"
+#include "vtex/Telemetry.h"
 
-#include <unirender/Device.h>
-#include <unirender/Framebuffer.h>
-#include <unirender/TextureDescription.h>
-#include <painting2/RenderTarget.h>
 #include <textile/PageIndexer.h>
 
 #include <algorithm>
+#include <cmath>
+
+#include <assert.h>
+
+namespace
+{
+
+uint32_t xorshift32(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+}
 
 namespace vtex
 {
 
-FeedbackBuffer::FeedbackBuffer(const ur::Device& dev, int size, int page_table_w,
-                               int page_table_h, const textile::PageIndexer& indexer)
-	: m_size(size)
+FeedbackBuffer::FeedbackBuffer(RenderBackend& backend, int size, int page_table_w,
+                               int page_table_h, const textile::PageIndexer& indexer, int latency,
+                               int subsample)
+	: m_backend(backend)
+	, m_size(size)
 	, m_page_table_w(page_table_w)
     , m_page_table_h(page_table_h)
+	, m_subsample(subsample)
+	, m_target_size(size / subsample)
 	, m_indexer(indexer)
+	, m_ring(latency + 1, latency)
+	, m_analyzer(indexer, static_cast<int>(std::log2(std::min(page_table_w, page_table_h))))
 {
-    ur::TextureDescription desc;
-    desc.target = ur::TextureTarget::Texture2D;
-    desc.width  = m_size;
-    desc.height = m_size;
-    desc.format = ur::TextureFormat::RGBA8;
-    m_fbo_col_tex = dev.CreateTexture(desc, nullptr);
-    desc.format = ur::TextureFormat::DEPTH;
-    m_fbo_depth_tex = dev.CreateTexture(desc, nullptr);
-
-    m_fbo = dev.CreateFramebuffer();
-    m_fbo->SetAttachment(ur::AttachmentType::Color0, ur::TextureTarget::Texture2D, m_fbo_col_tex, nullptr);
-    m_fbo->SetAttachment(ur::AttachmentType::Depth, ur::TextureTarget::Texture2D, m_fbo_depth_tex, nullptr);
-
-	m_data = new uint8_t[m_size * m_size * 4];
-
-	m_requests.resize(indexer.GetPageCount(), 0);
+	assert(subsample > 0 && size % subsample == 0);
+
+	m_slots.resize(m_ring.GetSlotCount());
+	for (auto& slot : m_slots) {
+		slot = m_backend.CreateRenderTarget(m_target_size, m_target_size);
+	}
+
+	m_data = new uint8_t[m_target_size * m_target_size * 4];
+
+	m_pattern.resize(m_subsample * m_subsample);
+	for (int i = 0, n = m_pattern.size(); i < n; ++i) {
+		m_pattern[i] = i;
+	}
+	m_analyzer.SetHistory(m_subsample * m_subsample);
 }
 
 FeedbackBuffer::~FeedbackBuffer()
@@ -41,46 +58,101 @@ FeedbackBuffer::~FeedbackBuffer()
 	delete[] m_data;
 }
 
-void FeedbackBuffer::BindRT()
+void FeedbackBuffer::BindRT(uint64_t frame)
 {
-//    m_fbo->Bind();
+	m_write_slot = m_ring.Write(frame);
+
+	const int n = static_cast<int>(m_pattern.size());
+	if (n > 1)
+	{
+		const int k = static_cast<int>(frame % n);
+		// a new order each round, every position is still visited
+		// once per round
+		if (k == 0) {
+			for (int i = n - 1; i > 0; --i) {
+				std::swap(m_pattern[i], m_pattern[xorshift32(m_rng_state) % (i + 1)]);
+			}
+		}
+		m_jitter_x = m_pattern[k] % m_subsample;
+		m_jitter_y = m_pattern[k] / m_subsample;
+	}
+
+	// without latency the pass is read straight from the current target
+	if (m_ring.GetLatency() > 0) {
+		m_backend.BindRenderTarget(*m_slots[m_write_slot]);
+	}
 }
 
 void FeedbackBuffer::UnbindRT()
 {
+	if (m_ring.GetLatency() > 0) {
+		m_backend.UnbindRenderTarget();
+	}
 }
 
-void FeedbackBuffer::Download(const ur::Device& dev)
+bool FeedbackBuffer::Download(uint64_t frame)
 {
-    dev.ReadPixels(m_data, ur::TextureFormat::RGBA8, 0, 0, m_size, m_size);
+	m_readback_bytes = 0;
 
-    int page_table_size_log2 = static_cast<int>(std::log2(std::min(m_page_table_w, m_page_table_h)));
-	for (int i = 0, n = m_size * m_size; i < n; ++i)
+	uint64_t src_frame;
+	int slot = m_ring.Read(frame, src_frame);
+	if (slot < 0) {
+		return false;
+	}
+
+	const size_t pixel_n = static_cast<size_t>(m_target_size) * m_target_size;
+	m_readback_bytes = pixel_n * 4;
+
+	// the slot was rendered frames ago and is finished on the gpu,
+	// so this does not wait for the pass that was just issued
+	auto rt = m_ring.GetLatency() > 0 ? m_slots[slot].get() : nullptr;
+	if (m_worker)
 	{
-		if (m_data[i * 4 + 3] == 255)
-		{
-			int x = static_cast<int>(m_data[i * 4]);
-			int y = static_cast<int>(m_data[i * 4 + 1]);
-			int mip = static_cast<int>(m_data[i * 4 + 2]);
-			int count = page_table_size_log2 - mip + 1;
-			for (int j = 0; j < count; ++j)
-			{
-				int _x = x >> j;
-				int _y = y >> j;
-				int _mip = mip + j;
-				int idx = m_indexer.CalcPageIdx(textile::Page(_x, _y, _mip));
-				++m_requests[idx];
-			}
+		m_backend.ReadPixels(rt, m_worker->GetPixels(), m_target_size, m_target_size);
+		m_worker->Submit(src_frame);
+		return m_worker->Poll();
+	}
 
-			// todo cache
+	m_backend.ReadPixels(rt, m_data, m_target_size, m_target_size);
 
-		}
+	m_analyze_ms = 0;
+	{
+		VTEX_SCOPED_TIMER(m_analyze_ms);
+		m_analyzer.Analyze(m_data, pixel_n, m_requests);
+	}
+	m_requests_frame = src_frame;
+
+	return true;
+}
+
+void FeedbackBuffer::SetAsync(bool async)
+{
+	if (async == IsAsync()) {
+		return;
+	}
+
+	if (async) {
+		m_worker = std::make_unique<FeedbackWorker>(m_indexer, m_analyzer.GetMaxMip(),
+			static_cast<size_t>(m_target_size) * m_target_size, m_analyzer.GetHistory());
+	} else {
+		m_worker.reset();
+	}
+}
+
+void FeedbackBuffer::WaitAnalysis()
+{
+	if (m_worker) {
+		m_worker->WaitIdle();
 	}
 }
 
 void FeedbackBuffer::Clear()
 {
-	std::fill(m_requests.begin(), m_requests.end(), 0);
+	if (m_worker) {
+		m_worker->ClearResult();
+	} else {
+		m_requests.Clear();
+	}
 }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,130 @@
+#include "vtex/FeedbackWorker.h"
+#include "vtex/Telemetry.h"
+
+#include <algorithm>
+
+namespace vtex
+{
+
+FeedbackWorker::FeedbackWorker(const textile::PageIndexer& indexer, int max_mip, size_t pixel_n, int history)
+	: m_analyzer(indexer, max_mip)
+	, m_pixel_n(pixel_n)
+{
+	m_analyzer.SetHistory(history);
+
+	const int queue_n = std::max(history, 1);
+	m_pixels.resize(queue_n + 2);
+	for (auto& buf : m_pixels) {
+		buf.reset(new uint8_t[pixel_n * 4]);
+	}
+	m_free.reserve(queue_n);
+	for (int i = queue_n + 1; i > m_work; --i) {
+		m_free.push_back(i);
+	}
+	m_pending.resize(queue_n);
+
+	m_ready = 2;
+
+	m_thread = std::thread(&FeedbackWorker::WorkerLoop, this);
+}
+
+FeedbackWorker::~FeedbackWorker()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_stop = true;
+	}
+	m_work_cv.notify_all();
+	m_thread.join();
+}
+
+void FeedbackWorker::Submit(uint64_t frame)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+
+		int next;
+		if (m_pending_n == m_pending.size())
+		{
+			// the worker is a whole history behind
+			next = m_pending[m_pending_head].buf;
+			m_pending_head = (m_pending_head + 1) % m_pending.size();
+			--m_pending_n;
+			++m_dropped;
+		}
+		else
+		{
+			next = m_free.back();
+			m_free.pop_back();
+		}
+
+		auto& p = m_pending[(m_pending_head + m_pending_n++) % m_pending.size()];
+		p.buf   = m_fill;
+		p.frame = frame;
+		m_fill = next;
+	}
+	m_work_cv.notify_one();
+}
+
+bool FeedbackWorker::Poll()
+{
+	if ((m_ready.load(std::memory_order_acquire) & FRESH) == 0) {
+		return false;
+	}
+	// only this thread clears FRESH, so the exchange takes a fresh one
+	m_front = m_ready.exchange(m_front, std::memory_order_acq_rel) & ~FRESH;
+	return true;
+}
+
+void FeedbackWorker::ClearResult()
+{
+	m_results[m_front].requests.Clear();
+}
+
+void FeedbackWorker::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mtx);
+	m_idle_cv.wait(lock, [this] { return m_pending_n == 0 && !m_busy; });
+}
+
+void FeedbackWorker::WorkerLoop()
+{
+	while (true)
+	{
+		uint64_t frame;
+		{
+			std::unique_lock<std::mutex> lock(m_mtx);
+			m_work_cv.wait(lock, [this] { return m_stop || m_pending_n > 0; });
+			if (m_stop) {
+				return;
+			}
+			auto& p = m_pending[m_pending_head];
+			m_pending_head = (m_pending_head + 1) % m_pending.size();
+			--m_pending_n;
+
+			m_free.push_back(m_work);
+			m_work = p.buf;
+			frame  = p.frame;
+			m_busy = true;
+		}
+
+		auto& result = m_results[m_back];
+		result.frame = frame;
+		result.analyze_ms = 0;
+		{
+			VTEX_SCOPED_TIMER(result.analyze_ms);
+			result.requests.Clear();
+			m_analyzer.Analyze(m_pixels[m_work].get(), m_pixel_n, result.requests);
+		}
+
+		m_back = m_ready.exchange(m_back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_busy = false;
+		}
+		m_idle_cv.notify_all();
+	}
+}
+
+}
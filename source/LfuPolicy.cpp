@@ -0,0 +1,78 @@
+#include "vtex/LfuPolicy.h"
+
+#include <cmath>
+
+namespace vtex
+{
+
+LfuPolicy::LfuPolicy(float half_life)
+	: m_half_life(half_life)
+{
+}
+
+void LfuPolicy::Reset(int slot_n)
+{
+	m_entries.assign(slot_n, Entry());
+	m_frame = 0;
+}
+
+void LfuPolicy::OnInsert(int slot)
+{
+	auto& e = m_entries[slot];
+	e.freq = 1.0f;
+	e.frame = m_frame;
+	e.insert_frame = m_frame;
+	e.resident = true;
+}
+
+void LfuPolicy::OnRemove(int slot)
+{
+	m_entries[slot] = Entry();
+}
+
+void LfuPolicy::OnTouch(int slot, int count)
+{
+	auto& e = m_entries[slot];
+	e.freq = CalcFreq(slot) + static_cast<float>(count);
+	e.frame = m_frame;
+}
+
+int LfuPolicy::SelectVictim(const std::function<bool(int slot)>& evictable)
+{
+	// pages loaded this frame haven't had a chance to be touched yet,
+	// they are only taken when nothing else is left
+	int victim = -1, fresh_victim = -1;
+	float min_freq = 0, fresh_min_freq = 0;
+	for (int i = 0, n = m_entries.size(); i < n; ++i)
+	{
+		auto& e = m_entries[i];
+		if (!e.resident || (evictable && !evictable(i))) {
+			continue;
+		}
+
+		float freq = CalcFreq(i);
+		if (e.insert_frame == m_frame)
+		{
+			if (fresh_victim < 0 || freq < fresh_min_freq)
+			{
+				fresh_victim = i;
+				fresh_min_freq = freq;
+			}
+		}
+		else if (victim < 0 || freq < min_freq)
+		{
+			victim = i;
+			min_freq = freq;
+		}
+	}
+	return victim >= 0 ? victim : fresh_victim;
+}
+
+float LfuPolicy::CalcFreq(int slot) const
+{
+	// decayed lazily, only slots that are compared pay for it
+	auto& e = m_entries[slot];
+	return e.freq * std::exp2(-static_cast<float>(m_frame - e.frame) / m_half_life);
+}
+
+}
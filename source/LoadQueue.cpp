@@ -0,0 +1,135 @@
+#include "vtex/LoadQueue.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vtex
+{
+
+LoadQueue::LoadQueue(const Config& cfg)
+	: m_cfg(cfg)
+{
+}
+
+void LoadQueue::BeginFrame(uint64_t frame)
+{
+	m_frame = frame;
+}
+
+void LoadQueue::Push(const textile::Page& page, int page_idx, int count)
+{
+	auto pos = m_lookup.Find(page_idx);
+	if (pos)
+	{
+		auto& item = m_items[*pos];
+		item.count = count;
+		item.last_frame = m_frame;
+		return;
+	}
+
+	m_lookup.Insert(page_idx, static_cast<int>(m_items.size()));
+	m_items.push_back({ page, page_idx, count, m_frame, m_frame, 0.0f });
+	// grow with the items, not later in Select()
+	if (m_order.capacity() < m_items.capacity()) {
+		m_order.reserve(m_items.capacity());
+		m_selected.reserve(m_items.capacity());
+	}
+}
+
+void LoadQueue::EndFrame()
+{
+	for (int i = 0; i < static_cast<int>(m_items.size()); )
+	{
+		if (m_items[i].last_frame != m_frame) {
+			RemoveAt(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+const std::vector<textile::Page>& LoadQueue::Select(int k)
+{
+	m_selected.clear();
+
+	const int n = static_cast<int>(m_items.size());
+	k = std::min(k, n);
+	if (k <= 0) {
+		return m_selected;
+	}
+
+	m_order.resize(n);
+	for (int i = 0; i < n; ++i)
+	{
+		auto& item = m_items[i];
+		item.priority = m_cfg.count_weight * std::log2(static_cast<float>(std::max(item.count, 1)))
+			          + m_cfg.age_weight * static_cast<float>(m_frame - item.first_frame)
+			          - m_cfg.mip_weight * item.page.mip;
+		m_order[i] = i;
+	}
+
+	// ties by page idx, so the choice does not depend on the
+	// order the pages were pushed in
+	auto better = [&](int i0, int i1)->bool {
+		auto& a = m_items[i0];
+		auto& b = m_items[i1];
+		if (a.priority != b.priority) {
+			return a.priority > b.priority;
+		} else {
+			return a.page_idx < b.page_idx;
+		}
+	};
+	if (k < n) {
+		std::nth_element(m_order.begin(), m_order.begin() + k, m_order.end(), better);
+	}
+	std::sort(m_order.begin(), m_order.begin() + k, better);
+
+	for (int i = 0; i < k; ++i) {
+		m_selected.push_back(m_items[m_order[i]].page);
+	}
+	return m_selected;
+}
+
+void LoadQueue::Remove(int page_idx)
+{
+	auto pos = m_lookup.Find(page_idx);
+	if (pos) {
+		RemoveAt(*pos);
+	}
+}
+
+int LoadQueue::GetAge(int page_idx) const
+{
+	auto pos = m_lookup.Find(page_idx);
+	if (!pos) {
+		return -1;
+	}
+	return static_cast<int>(m_frame - m_items[*pos].first_frame);
+}
+
+void LoadQueue::Clear()
+{
+	m_items.clear();
+	m_lookup.Clear();
+}
+
+void LoadQueue::Reserve(int n)
+{
+	m_items.reserve(n);
+	m_lookup.Reserve(n);
+	m_order.reserve(m_items.capacity());
+	m_selected.reserve(m_items.capacity());
+}
+
+void LoadQueue::RemoveAt(int pos)
+{
+	m_lookup.Erase(m_items[pos].page_idx);
+	if (pos + 1 != static_cast<int>(m_items.size()))
+	{
+		m_items[pos] = m_items.back();
+		*m_lookup.Find(m_items[pos].page_idx) = pos;
+	}
+	m_items.pop_back();
+}
+
+}
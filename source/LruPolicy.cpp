@@ -0,0 +1,68 @@
+#include "vtex/LruPolicy.h"
+
+namespace vtex
+{
+
+void LruPolicy::Reset(int slot_n)
+{
+	m_nodes.assign(slot_n, Node());
+	m_head = m_tail = -1;
+}
+
+void LruPolicy::OnInsert(int slot)
+{
+	PushFront(slot);
+}
+
+void LruPolicy::OnRemove(int slot)
+{
+	Unlink(slot);
+}
+
+void LruPolicy::OnTouch(int slot, int)
+{
+	Unlink(slot);
+	PushFront(slot);
+}
+
+int LruPolicy::SelectVictim(const std::function<bool(int slot)>& evictable)
+{
+	for (int slot = m_tail; slot >= 0; slot = m_nodes[slot].prev) {
+		if (!evictable || evictable(slot)) {
+			return slot;
+		}
+	}
+	return -1;
+}
+
+void LruPolicy::Unlink(int slot)
+{
+	auto& node = m_nodes[slot];
+	if (node.prev >= 0) {
+		m_nodes[node.prev].next = node.next;
+	} else if (m_head == slot) {
+		m_head = node.next;
+	}
+	if (node.next >= 0) {
+		m_nodes[node.next].prev = node.prev;
+	} else if (m_tail == slot) {
+		m_tail = node.prev;
+	}
+	node.prev = node.next = -1;
+}
+
+void LruPolicy::PushFront(int slot)
+{
+	auto& node = m_nodes[slot];
+	node.prev = -1;
+	node.next = m_head;
+	if (m_head >= 0) {
+		m_nodes[m_head].prev = slot;
+	}
+	m_head = slot;
+	if (m_tail < 0) {
+		m_tail = slot;
+	}
+}
+
+}
@@ -0,0 +1,232 @@
+#include "vtex/MappedPageFile.h"
+#include "vtex/PageCodec.h"
+
+#include <textile/Page.h>
+#include <textile/PageIndexer.h>
+
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // NOMINMAX
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif // WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace
+{
+
+const size_t OS_PAGE_SIZE = 4096;
+
+}
+
+namespace vtex
+{
+
+MappedPageFile::MappedPageFile(const std::string& filepath, const textile::PageIndexer& indexer)
+	: m_indexer(indexer)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	m_file = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		Close();
+		return;
+	}
+	m_size = static_cast<size_t>(size.QuadPart);
+
+	m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mapping) {
+		Close();
+		return;
+	}
+	m_base = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+	m_fd = open(filepath.c_str(), O_RDONLY);
+	if (m_fd < 0) {
+		return;
+	}
+
+	struct stat st;
+	if (fstat(m_fd, &st) != 0) {
+		Close();
+		return;
+	}
+	m_size = static_cast<size_t>(st.st_size);
+
+	void* base = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+	if (base == MAP_FAILED) {
+		Close();
+		return;
+	}
+	m_base = static_cast<const uint8_t*>(base);
+
+	// access follows the camera, not the file order
+	madvise(base, m_size, MADV_RANDOM);
+#endif // _WIN32
+
+	if (!m_base || m_size < sizeof(PageFile::Header)) {
+		Close();
+		return;
+	}
+
+	size_t header_bytes;
+	if (!PageFile::ParseHeader(m_base, m_header, header_bytes)
+	 || m_size < header_bytes + (m_header.page_count + 1) * sizeof(uint64_t)) {
+		Close();
+		return;
+	}
+
+	m_offsets = reinterpret_cast<const uint64_t*>(m_base + header_bytes);
+}
+
+MappedPageFile::~MappedPageFile()
+{
+	Close();
+}
+
+PageFormat MappedPageFile::GetPageFormat() const
+{
+	auto fmt = PageFile::GetStoredFormat(m_header);
+	return fmt == PageFormat::RGB8 ? PageFormat::RGBA8 : fmt;
+}
+
+size_t MappedPageFile::GetPageBytes() const
+{
+	if (!m_offsets) {
+		return 0;
+	}
+	return PageCodec::GetPageBytes(GetPageFormat(), m_header.tile_size + m_header.border_size * 2);
+}
+
+bool MappedPageFile::ReadPage(const textile::Page& page, uint8_t* dst)
+{
+	size_t size;
+	auto src = FindPage(page, size);
+	if (!src) {
+		return false;
+	}
+
+	if (PageFile::GetStoredFormat(m_header) == PageFormat::RGB8) {
+		PageCodec::ExpandToRGBA(src, 3, GetPageBytes() / 4, dst);
+	} else {
+		memcpy(dst, src, size);
+	}
+
+	return true;
+}
+
+const uint8_t* MappedPageFile::MapPage(const textile::Page& page)
+{
+	if (!m_offsets || PageFile::GetStoredFormat(m_header) == PageFormat::RGB8) {
+		return nullptr;
+	}
+
+	size_t size;
+	auto src = FindPage(page, size);
+	if (!src) {
+		return nullptr;
+	}
+
+	// fault the page in here, on the loader thread, instead of
+	// during the upload on the render thread
+	volatile uint8_t sink = 0;
+	for (size_t i = 0; i < size; i += OS_PAGE_SIZE) {
+		sink += src[i];
+	}
+	(void)sink;
+
+	return src;
+}
+
+void MappedPageFile::Prefetch(const textile::Page& page)
+{
+	size_t size;
+	auto src = FindPage(page, size);
+	if (!src) {
+		return;
+	}
+
+	// round down to the os page the data starts in
+	size_t offset = static_cast<size_t>(src - m_base);
+	size_t begin = offset & ~(OS_PAGE_SIZE - 1);
+	size_t len = offset + size - begin;
+
+#ifdef _WIN32
+#if _WIN32_WINNT >= 0x0602
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<uint8_t*>(m_base + begin);
+	range.NumberOfBytes = len;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif // _WIN32_WINNT
+#else
+	madvise(const_cast<uint8_t*>(m_base + begin), len, MADV_WILLNEED);
+#endif // _WIN32
+}
+
+const uint8_t* MappedPageFile::FindPage(const textile::Page& page, size_t& size) const
+{
+	if (!m_offsets) {
+		return nullptr;
+	}
+
+	int idx = m_indexer.CalcPageIdx(page);
+	if (idx < 0 || idx >= static_cast<int>(m_header.page_count)) {
+		return nullptr;
+	}
+
+	uint64_t begin = m_offsets[idx];
+	uint64_t end = m_offsets[idx + 1];
+	if (end > m_size || end < begin || end - begin != PageFile::GetStoredBytes(m_header)) {
+		return nullptr;
+	}
+
+	size = static_cast<size_t>(end - begin);
+	return m_base + begin;
+}
+
+void MappedPageFile::Close()
+{
+	m_offsets = nullptr;
+
+#ifdef _WIN32
+	if (m_base) {
+		UnmapViewOfFile(m_base);
+	}
+	if (m_mapping) {
+		CloseHandle(m_mapping);
+	}
+	if (m_file) {
+		CloseHandle(m_file);
+	}
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	if (m_base) {
+		munmap(const_cast<uint8_t*>(m_base), m_size);
+	}
+	if (m_fd >= 0) {
+		close(m_fd);
+	}
+	m_fd = -1;
+#endif // _WIN32
+
+	m_base = nullptr;
+	m_size = 0;
+}
+
+}
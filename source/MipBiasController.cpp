@@ -0,0 +1,71 @@
+#include "vtex/MipBiasController.h"
+
+#include <algorithm>
+
+namespace vtex
+{
+
+MipBiasController::MipBiasController(const Config& cfg, int bias)
+	: m_cfg(cfg)
+{
+	SetBias(bias);
+}
+
+int MipBiasController::Update(int requested, int thrashed, int slot_n)
+{
+	const float pressure = static_cast<float>(requested) / std::max(slot_n, 1);
+	const float thrash = static_cast<float>(thrashed) / std::max(requested, 1);
+	if (m_frames == 0)
+	{
+		m_pressure = pressure;
+		m_thrash   = thrash;
+	}
+	else
+	{
+		m_pressure += m_cfg.smoothing * (pressure - m_pressure);
+		m_thrash   += m_cfg.smoothing * (thrash - m_thrash);
+	}
+	++m_frames;
+
+	int want = 0;
+	if (m_pressure > m_cfg.lower_pressure || m_thrash > m_cfg.lower_thrash) {
+		want = -1;
+	} else if (m_pressure < m_cfg.raise_pressure && m_thrash < m_cfg.raise_thrash) {
+		want = 1;
+	}
+
+	if (want != m_want)
+	{
+		m_want = want;
+		m_held = 0;
+	}
+	if (want == 0 || ++m_held < m_cfg.hold_frames) {
+		return 0;
+	}
+
+	const int bias = std::min(std::max(m_bias + want, m_cfg.min_bias), m_cfg.max_bias);
+	if (bias == m_bias) {
+		return 0;
+	}
+
+	// the averages measured the old bias
+	SetBias(bias);
+	return want;
+}
+
+void MipBiasController::SetBias(int bias)
+{
+	m_bias = std::min(std::max(bias, m_cfg.min_bias), m_cfg.max_bias);
+
+	m_frames = 0;
+	m_want = 0;
+	m_held = 0;
+}
+
+void MipBiasController::SetConfig(const Config& cfg)
+{
+	m_cfg = cfg;
+	SetBias(m_bias);
+}
+
+}
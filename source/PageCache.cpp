@@ -1,46 +1,399 @@
 #include "vtex/PageCache.h"
 #include "vtex/TextureAtlas.h"
 #include "vtex/PageTable.h"
+#include "vtex/AsyncPageLoader.h"
+#include "vtex/PageSource.h"
+
+#include <textile/PageIndexer.h>
+
+#include <algorithm>
 
 #include <assert.h>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+int lowest_bit(uint64_t v)
+{
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward64(&idx, v);
+	return static_cast<int>(idx);
+#else
+	return __builtin_ctzll(v);
+#endif
+}
+
+}
+
 namespace vtex
 {
 
-PageCache::PageCache(TextureAtlas& atlas, textile::PageLoader& loader,
-	                 PageTable& table, const textile::PageIndexer& indexer)
-	: textile::PageCache(loader, indexer)
-    , m_atlas(atlas)
-	, m_table(table)
+PageCache::PageCache(TextureAtlas& atlas, AsyncPageLoader& loader)
+	: m_atlas(atlas)
+	, m_loader(loader)
+{
+	ResetSlots(m_atlas.GetPageCount());
+
+	SetPolicy(ReplacementPolicy::Create(ReplacementPolicyType::LRU));
+}
+
+int PageCache::Register(PageTable& table, const textile::PageIndexer& indexer, PageSource& src)
+{
+	Texture tex;
+	tex.table   = &table;
+	tex.indexer = &indexer;
+	tex.src     = &src;
+	tex.max_mip = table.GetMaxLevel();
+
+	++m_texture_n;
+	for (int i = 0, n = m_textures.size(); i < n; ++i)
+	{
+		if (!m_textures[i].table) {
+			m_textures[i] = tex;
+			return i;
+		}
+	}
+	m_textures.push_back(tex);
+	return static_cast<int>(m_textures.size()) - 1;
+}
+
+void PageCache::Unregister(int tex)
+{
+	Clear(tex);
+
+	m_loader.CancelIf([tex](uint64_t key) {
+		return KeyTexture(key) == tex;
+	});
+	m_loader.WaitReads(*m_textures[tex].src);
+
+	m_textures[tex] = Texture();
+	--m_texture_n;
+}
+
+void PageCache::SetPolicy(std::unique_ptr<ReplacementPolicy> policy)
+{
+	assert(policy);
+	m_policy = std::move(policy);
+
+	m_policy->Reset(static_cast<int>(m_slots.size()));
+	m_lookup.ForEach([this](uint64_t, int slot) {
+		m_policy->OnInsert(slot);
+	});
+}
+
+bool PageCache::Touch(int tex, const textile::Page& page, int count)
+{
+	auto slot = m_lookup.Find(MakeKey(tex, page));
+	if (!slot) {
+		return false;
+	}
+
+	m_policy->OnTouch(*slot, count);
+	return true;
+}
+
+bool PageCache::IsResident(int tex, const textile::Page& page) const
+{
+	return m_lookup.Contains(MakeKey(tex, page));
+}
+
+bool PageCache::IsLoading(int tex, const textile::Page& page) const
+{
+	return m_loader.IsLoading(MakeKey(tex, page));
+}
+
+bool PageCache::Request(int tex, const textile::Page& page)
+{
+	uint64_t key = MakeKey(tex, page);
+	if (m_lookup.Contains(key)) {
+		return false;
+	}
+	return m_loader.Submit(*m_textures[tex].src, page, key);
+}
+
+void PageCache::Clear(int tex)
+{
+	for (int i = 0, n = m_slots.size(); i < n; ++i) {
+		if (m_slots[i].tex == tex) {
+			Evict(i);
+		}
+	}
+}
+
+void PageCache::Clear()
+{
+	for (int i = 0, n = m_slots.size(); i < n; ++i) {
+		if (m_slots[i].tex >= 0) {
+			Evict(i);
+		}
+	}
+}
+
+void PageCache::ResizeAtlas(size_t atlas_size)
 {
+	const int old_n = m_page_n;
+	const int page_n = static_cast<int>(atlas_size / m_atlas.GetPageSize());
+	const int slot_n = page_n * page_n * m_atlas.GetLayerCount();
+
+	while (GetResidentCount() > slot_n)
+	{
+		int victim = m_policy->SelectVictim([this](int slot) {
+			return IsEvictable(slot);
+		});
+		// pinned pages that do not fit, finest first, which never
+		// has resident children
+		if (victim < 0)
+		{
+			for (int i = 0, n = m_slots.size(); i < n; ++i) {
+				if (m_slots[i].tex >= 0 && (victim < 0 || m_slots[i].page.mip < m_slots[victim].page.mip)) {
+					victim = i;
+				}
+			}
+		}
+		++m_textures[m_slots[victim].tex].stats.evicted;
+		Evict(victim);
+	}
+
+	std::vector<Slot> resident;
+	std::vector<int> old_slots;
+	resident.reserve(GetResidentCount());
+	old_slots.reserve(GetResidentCount());
+	for (int i = 0, n = m_slots.size(); i < n; ++i) {
+		if (m_slots[i].tex >= 0) {
+			resident.push_back(m_slots[i]);
+			old_slots.push_back(i);
+		}
+	}
+
+	ResetSlots(page_n);
+	// the policy's history is lost, the next frames' touches
+	// rebuild it
+	m_policy->Reset(slot_n);
+
+	// pages inside the new size keep their place, a grow copies the
+	// old atlas in one run per row, the others take free slots
+	std::vector<TextureAtlas::PageMove> moves;
+	moves.reserve(resident.size());
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (int i = 0, n = resident.size(); i < n; ++i)
+		{
+			const int x = old_slots[i] % old_n;
+			const int y = old_slots[i] / old_n % old_n;
+			const int layer = old_slots[i] / (old_n * old_n);
+			const bool in_place = x < page_n && y < page_n;
+			if (in_place != (pass == 0)) {
+				continue;
+			}
+
+			int slot;
+			if (in_place) {
+				slot = (layer * page_n + y) * page_n + x;
+				TakeSlot(slot);
+			} else {
+				slot = AllocSlot();
+			}
+			m_slots[slot] = resident[i];
+			m_lookup.Insert(resident[i].key, slot);
+			m_policy->OnInsert(slot);
+
+			int dst_x, dst_y, dst_layer;
+			GetSlotPos(slot, dst_x, dst_y, dst_layer);
+			moves.push_back({ x, y, layer, dst_x, dst_y, dst_layer });
+		}
+	}
+
+	if (m_atlas.Resize(atlas_size, moves))
+	{
+		for (int i = 0; i < slot_n; ++i) {
+			if (m_slots[i].tex >= 0) {
+				int x, y, layer;
+				GetSlotPos(i, x, y, layer);
+				m_textures[m_slots[i].tex].table->AddPage(m_slots[i].page, x, y, layer);
+			}
+		}
+		return;
+	}
+
+	// the backend can not copy, the pages load again on the workers,
+	// coarsest first, what does not fit in flight feedback asks for
+	std::sort(resident.begin(), resident.end(), [](const Slot& a, const Slot& b) {
+		return a.page.mip > b.page.mip;
+	});
+	for (int i = 0; i < slot_n; ++i) {
+		if (m_slots[i].tex >= 0) {
+			Evict(i);
+		}
+	}
+	for (auto& s : resident) {
+		Request(s.tex, s.page);
+	}
 }
 
-void PageCache::LoadComplete(const ur::Device& dev, const textile::Page& page, const uint8_t* data)
+void PageCache::LoadComplete(uint64_t key, const textile::Page& page, const uint8_t* data)
 {
-	int x, y;
+	int tex = KeyTexture(key);
+	if (tex >= static_cast<int>(m_textures.size()) || !m_textures[tex].table) {
+		return;
+	}
+	if (m_lookup.Contains(key)) {
+		return;
+	}
+
+	if (m_free_n == 0)
+	{
+		int victim = m_policy->SelectVictim([this](int slot) {
+			return IsEvictable(slot);
+		});
+		// everything is pinned or a parent, keep what we have
+		if (victim < 0) {
+			++m_textures[tex].stats.dropped;
+			return;
+		}
+		++m_textures[m_slots[victim].tex].stats.evicted;
+		Evict(victim);
+	}
+
+	int slot = AllocSlot();
 
-	int page_n = m_atlas.GetPageCount();
-	if (m_lru.Size() == page_n * page_n)
+	auto& s = m_slots[slot];
+	s.page = page;
+	s.tex  = tex;
+	s.key  = key;
+	s.resident_children = 0;
+	if (page.mip > 0)
 	{
-		auto end = m_lru.GetListEnd();
-		assert(end);
+		for (int i = 0; i < 4; ++i) {
+			if (FindSlot(tex, page.x * 2 + (i & 1), page.y * 2 + (i >> 1), page.mip - 1) >= 0) {
+				++s.resident_children;
+			}
+		}
+	}
+	m_lookup.Insert(key, slot);
+	AddResidentChild(tex, page, 1);
+
+	m_policy->OnInsert(slot);
+
+	int x, y, layer;
+	GetSlotPos(slot, x, y, layer);
+
+	m_atlas.UploadPage(data, x, y, layer);
+
+	m_textures[tex].table->AddPage(page, x, y, layer);
+	++m_textures[tex].stats.loaded;
+}
+
+void PageCache::UpdateTables()
+{
+	for (auto& tex : m_textures) {
+		if (tex.table) {
+			tex.table->Update();
+		}
+	}
+}
+
+uint64_t PageCache::MakeKey(int tex, const textile::Page& page) const
+{
+	int idx = m_textures[tex].indexer->CalcPageIdx(page);
+	return (static_cast<uint64_t>(tex) << 32) | static_cast<uint32_t>(idx);
+}
+
+bool PageCache::IsEvictable(int slot) const
+{
+	auto& s = m_slots[slot];
+	if (s.tex < 0 || s.resident_children > 0) {
+		return false;
+	}
+	return s.page.mip <= m_textures[s.tex].max_mip - m_pinned_levels;
+}
+
+void PageCache::ResetSlots(int page_n)
+{
+	const int slot_n = page_n * page_n * m_atlas.GetLayerCount();
 
-		m_table.RemovePage(end->page);
+	m_page_n = page_n;
+	m_slots.assign(slot_n, Slot());
+	m_lookup.Clear();
+	m_lookup.Reserve(slot_n);
 
-		x = end->x;
-		y = end->y;
-		m_lru.RemoveBack();
+	m_free_bits.assign((slot_n + 63) / 64, 0);
+	m_free_n = 0;
+	for (int i = 0; i < slot_n; ++i) {
+		FreeSlot(i);
 	}
-	else
+	m_last_slot = -1;
+}
+
+void PageCache::Evict(int slot)
+{
+	auto& s = m_slots[slot];
+	assert(s.tex >= 0);
+
+	m_textures[s.tex].table->RemovePage(s.page);
+	m_lookup.Erase(s.key);
+	AddResidentChild(s.tex, s.page, -1);
+
+	m_policy->OnRemove(slot);
+
+	s = Slot();
+	FreeSlot(slot);
+}
+
+int PageCache::AllocSlot()
+{
+	assert(m_free_n > 0);
+
+	int slot = m_last_slot + 1;
+	if (m_last_slot < 0 || slot % m_page_n == 0 || slot >= static_cast<int>(m_slots.size()) || !IsFree(slot))
 	{
-		x = m_lru.Size() % page_n;
-		y = m_lru.Size() / page_n;
+		slot = -1;
+		for (int i = 0, n = static_cast<int>(m_free_bits.size()); i < n && slot < 0; ++i) {
+			if (m_free_bits[i] != 0) {
+				slot = i * 64 + lowest_bit(m_free_bits[i]);
+			}
+		}
 	}
-	m_lru.AddFront(page, x, y);
 
-	m_atlas.UploadPage(data, x, y);
+	TakeSlot(slot);
+
+	m_last_slot = slot;
+	return slot;
+}
+
+void PageCache::TakeSlot(int slot)
+{
+	assert(IsFree(slot));
+	m_free_bits[slot >> 6] &= ~(1ull << (slot & 63));
+	--m_free_n;
+}
 
-	m_table.AddPage(page, x, y);
+void PageCache::FreeSlot(int slot)
+{
+	m_free_bits[slot >> 6] |= 1ull << (slot & 63);
+	++m_free_n;
+}
+
+int PageCache::FindSlot(int tex, int x, int y, int mip) const
+{
+	auto slot = m_lookup.Find(MakeKey(tex, textile::Page(x, y, mip)));
+	return slot ? *slot : -1;
 }
 
-}
\ No newline at end of file
+void PageCache::AddResidentChild(int tex, const textile::Page& page, int delta)
+{
+	if (page.mip >= m_textures[tex].max_mip) {
+		return;
+	}
+
+	int parent = FindSlot(tex, page.x / 2, page.y / 2, page.mip + 1);
+	if (parent >= 0) {
+		m_slots[parent].resident_children += delta;
+	}
+}
+
+}
@@ -0,0 +1,198 @@
+#include "vtex/PageCodec.h"
+#include "vtex/BlockCodec.h"
+
+#include <cstring>
+
+#include <assert.h>
+
+namespace
+{
+
+const size_t BLOCK_SIZE = 4;
+
+size_t block_bytes(vtex::PageFormat fmt)
+{
+	return fmt == vtex::PageFormat::BC1 ? 8 : 16;
+}
+
+}
+
+namespace vtex
+{
+
+bool PageCodec::IsCompressed(PageFormat fmt)
+{
+	return fmt == PageFormat::BC1
+		|| fmt == PageFormat::BC3
+		|| fmt == PageFormat::BC7;
+}
+
+size_t PageCodec::GetPageBytes(PageFormat fmt, size_t page_size)
+{
+	switch (fmt)
+	{
+	case PageFormat::R8:
+		return page_size * page_size;
+	case PageFormat::RG8:
+		return page_size * page_size * 2;
+	case PageFormat::RGB8:
+		return page_size * page_size * 3;
+	case PageFormat::RGBA8:
+		return page_size * page_size * 4;
+	default:
+		assert(page_size % BLOCK_SIZE == 0);
+		return (page_size / BLOCK_SIZE) * (page_size / BLOCK_SIZE) * block_bytes(fmt);
+	}
+}
+
+PageFormat PageCodec::FromChannels(int channels)
+{
+	switch (channels)
+	{
+	case 1:
+		return PageFormat::R8;
+	case 2:
+		return PageFormat::RG8;
+	default:
+		return PageFormat::RGBA8;
+	}
+}
+
+bool PageCodec::Transcode(const uint8_t* src, PageFormat src_fmt,
+	                      uint8_t* dst, PageFormat dst_fmt, size_t page_size, uint8_t* tmp)
+{
+	if (src_fmt == dst_fmt)
+	{
+		memcpy(dst, src, GetPageBytes(src_fmt, page_size));
+		return true;
+	}
+	if (dst_fmt == PageFormat::RGBA8) {
+		return ToRGBA(src, src_fmt, page_size, dst);
+	}
+	if (src_fmt == PageFormat::RGBA8) {
+		return FromRGBA(src, page_size, dst_fmt, dst);
+	}
+	return ToRGBA(src, src_fmt, page_size, tmp)
+		&& FromRGBA(tmp, page_size, dst_fmt, dst);
+}
+
+bool PageCodec::ToRGBA(const uint8_t* src, PageFormat fmt, size_t page_size, uint8_t* dst)
+{
+	switch (fmt)
+	{
+	case PageFormat::R8:
+		ExpandToRGBA(src, 1, page_size * page_size, dst);
+		return true;
+	case PageFormat::RG8:
+		ExpandToRGBA(src, 2, page_size * page_size, dst);
+		return true;
+	case PageFormat::RGB8:
+		ExpandToRGBA(src, 3, page_size * page_size, dst);
+		return true;
+	case PageFormat::RGBA8:
+		memcpy(dst, src, page_size * page_size * 4);
+		return true;
+	default:
+		break;
+	}
+
+	const size_t block_n = page_size / BLOCK_SIZE;
+	const size_t stride = block_bytes(fmt);
+	for (size_t by = 0; by < block_n; ++by)
+	{
+		for (size_t bx = 0; bx < block_n; ++bx)
+		{
+			const uint8_t* block = src + (by * block_n + bx) * stride;
+
+			uint8_t texels[BLOCK_SIZE * BLOCK_SIZE * 4];
+			if (fmt == PageFormat::BC1) {
+				BlockCodec::DecodeBC1(block, texels);
+			} else if (fmt == PageFormat::BC3) {
+				BlockCodec::DecodeBC3(block, texels);
+			} else if (!BlockCodec::DecodeBC7(block, texels)) {
+				return false;
+			}
+
+			for (size_t y = 0; y < BLOCK_SIZE; ++y) {
+				memcpy(dst + ((by * BLOCK_SIZE + y) * page_size + bx * BLOCK_SIZE) * 4,
+					texels + y * BLOCK_SIZE * 4, BLOCK_SIZE * 4);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool PageCodec::FromRGBA(const uint8_t* rgba, size_t page_size, PageFormat fmt, uint8_t* dst)
+{
+	const size_t texel_n = page_size * page_size;
+	switch (fmt)
+	{
+	case PageFormat::R8:
+	case PageFormat::RG8:
+	case PageFormat::RGB8:
+	{
+		const size_t channels = GetPageBytes(fmt, 1);
+		for (size_t i = 0; i < texel_n; ++i) {
+			memcpy(dst + i * channels, rgba + i * 4, channels);
+		}
+		return true;
+	}
+	case PageFormat::RGBA8:
+		memcpy(dst, rgba, texel_n * 4);
+		return true;
+	default:
+		break;
+	}
+
+	const size_t block_n = page_size / BLOCK_SIZE;
+	const size_t stride = block_bytes(fmt);
+	for (size_t by = 0; by < block_n; ++by)
+	{
+		for (size_t bx = 0; bx < block_n; ++bx)
+		{
+			uint8_t texels[BLOCK_SIZE * BLOCK_SIZE * 4];
+			for (size_t y = 0; y < BLOCK_SIZE; ++y) {
+				memcpy(texels + y * BLOCK_SIZE * 4,
+					rgba + ((by * BLOCK_SIZE + y) * page_size + bx * BLOCK_SIZE) * 4, BLOCK_SIZE * 4);
+			}
+
+			uint8_t* block = dst + (by * block_n + bx) * stride;
+			if (fmt == PageFormat::BC1) {
+				BlockCodec::EncodeBC1(texels, block);
+			} else if (fmt == PageFormat::BC3) {
+				BlockCodec::EncodeBC3(texels, block);
+			} else {
+				BlockCodec::EncodeBC7(texels, block);
+			}
+		}
+	}
+
+	return true;
+}
+
+void PageCodec::ExpandToRGBA(const uint8_t* src, int channels, size_t texel_n, uint8_t* dst)
+{
+	if (channels == 4)
+	{
+		if (src != dst) {
+			memmove(dst, src, texel_n * 4);
+		}
+		return;
+	}
+
+	// front to back, each texel is read before its destination is written
+	for (size_t i = 0; i < texel_n; ++i)
+	{
+		uint8_t texel[4] = { 0, 0, 0, 255 };
+		for (int j = 0; j < channels; ++j) {
+			texel[j] = src[i * channels + j];
+		}
+		if (channels == 1) {
+			texel[1] = texel[2] = texel[0];
+		}
+		memcpy(dst + i * 4, texel, 4);
+	}
+}
+
+}
@@ -0,0 +1,145 @@
+#include "vtex/PageFile.h"
+#include "vtex/PageCodec.h"
+
+#include <textile/Page.h>
+#include <textile/PageIndexer.h>
+#include <textile/VTexInfo.h>
+
+#include <cstddef>
+#include <cstring>
+
+namespace vtex
+{
+
+PageFile::PageFile(const std::string& filepath, const textile::PageIndexer& indexer)
+	: m_indexer(indexer)
+{
+	m_fin.open(filepath.c_str(), std::ios::in | std::ios::binary);
+	if (!m_fin) {
+		return;
+	}
+
+	uint8_t data[sizeof(Header)];
+	size_t header_bytes;
+	m_fin.read(reinterpret_cast<char*>(data), sizeof(data));
+	if (!m_fin || !ParseHeader(data, m_header, header_bytes)) {
+		return;
+	}
+
+	m_offsets.resize(m_header.page_count + 1);
+	m_fin.seekg(header_bytes);
+	m_fin.read(reinterpret_cast<char*>(m_offsets.data()), m_offsets.size() * sizeof(uint64_t));
+	m_valid = !!m_fin;
+}
+
+PageFormat PageFile::GetPageFormat() const
+{
+	auto fmt = GetStoredFormat(m_header);
+	return fmt == PageFormat::RGB8 ? PageFormat::RGBA8 : fmt;
+}
+
+size_t PageFile::GetPageBytes() const
+{
+	if (!m_valid) {
+		return 0;
+	}
+	return PageCodec::GetPageBytes(GetPageFormat(), m_header.tile_size + m_header.border_size * 2);
+}
+
+bool PageFile::ReadPage(const textile::Page& page, uint8_t* dst)
+{
+	if (!m_valid) {
+		return false;
+	}
+
+	int idx = m_indexer.CalcPageIdx(page);
+	if (idx < 0 || idx >= static_cast<int>(m_header.page_count)) {
+		return false;
+	}
+
+	const size_t dst_bytes = GetPageBytes();
+	const size_t src_bytes = GetStoredBytes(m_header);
+	if (m_offsets[idx + 1] - m_offsets[idx] != src_bytes) {
+		return false;
+	}
+
+	// read into the tail of dst and expand in place, front to back
+	uint8_t* src = dst + (dst_bytes - src_bytes);
+	{
+		std::lock_guard<std::mutex> lock(m_fin_mtx);
+		m_fin.seekg(m_offsets[idx]);
+		m_fin.read(reinterpret_cast<char*>(src), src_bytes);
+		if (!m_fin)
+		{
+			m_fin.clear();
+			return false;
+		}
+	}
+
+	if (src != dst) {
+		PageCodec::ExpandToRGBA(src, 3, dst_bytes / 4, dst);
+	}
+
+	return true;
+}
+
+bool PageFile::ParseHeader(const uint8_t* data, Header& header, size_t& header_bytes)
+{
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, "VTEX", 4) != 0
+	 || header.channels < 1 || header.channels > 4) {
+		return false;
+	}
+
+	switch (header.version)
+	{
+	case 1:
+		header_bytes = offsetof(Header, format);
+		header.format = static_cast<uint32_t>(header.channels == 3
+			? PageFormat::RGB8 : PageCodec::FromChannels(header.channels));
+		return true;
+	case VERSION:
+		header_bytes = sizeof(Header);
+		if (header.format > static_cast<uint32_t>(PageFormat::BC7)) {
+			return false;
+		}
+		// blocks never straddle a page
+		return !PageCodec::IsCompressed(GetStoredFormat(header))
+			|| (header.tile_size + header.border_size * 2) % 4 == 0;
+	default:
+		return false;
+	}
+}
+
+bool PageFile::ReadInfo(const std::string& filepath, textile::VTexInfo& info)
+{
+	std::ifstream fin(filepath.c_str(), std::ios::in | std::ios::binary);
+
+	uint8_t data[sizeof(Header)];
+	fin.read(reinterpret_cast<char*>(data), sizeof(data));
+
+	Header header;
+	size_t header_bytes;
+	if (!fin || !ParseHeader(data, header, header_bytes)) {
+		return false;
+	}
+
+	info.vtex_width  = header.vtex_width;
+	info.vtex_height = header.vtex_height;
+	info.tile_size   = header.tile_size;
+	info.border_size = header.border_size;
+
+	return true;
+}
+
+PageFormat PageFile::GetStoredFormat(const Header& header)
+{
+	return static_cast<PageFormat>(header.format);
+}
+
+size_t PageFile::GetStoredBytes(const Header& header)
+{
+	return PageCodec::GetPageBytes(GetStoredFormat(header), header.tile_size + header.border_size * 2);
+}
+
+}
@@ -0,0 +1,72 @@
+#include "vtex/PageFileWriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vtex
+{
+
+PageFileWriter::PageFileWriter(const std::string& filepath, const PageFile::Header& header)
+	: m_header(header)
+{
+	memcpy(m_header.magic, "VTEX", 4);
+	m_header.version = PageFile::VERSION;
+	m_header.reserved = 0;
+
+	PageFile::Header parsed;
+	size_t header_bytes;
+	if (!PageFile::ParseHeader(reinterpret_cast<const uint8_t*>(&m_header), parsed, header_bytes)) {
+		return;
+	}
+
+	m_page_bytes = PageFile::GetStoredBytes(m_header);
+	m_data_offset = header_bytes + (m_header.page_count + 1) * sizeof(uint64_t);
+	m_written.resize(m_header.page_count, false);
+
+	m_fout.open(filepath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!m_fout) {
+		return;
+	}
+
+	m_fout.write(reinterpret_cast<const char*>(&m_header), header_bytes);
+
+	std::vector<uint64_t> offsets(m_header.page_count + 1);
+	for (size_t i = 0; i < offsets.size(); ++i) {
+		offsets[i] = m_data_offset + i * m_page_bytes;
+	}
+	m_fout.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+
+	m_valid = !!m_fout;
+}
+
+bool PageFileWriter::WritePage(int idx, const uint8_t* data)
+{
+	if (!m_valid || idx < 0 || idx >= static_cast<int>(m_header.page_count)) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_fout_mtx);
+	m_fout.seekp(m_data_offset + static_cast<uint64_t>(idx) * m_page_bytes);
+	m_fout.write(reinterpret_cast<const char*>(data), m_page_bytes);
+	m_written[idx] = true;
+
+	return !!m_fout;
+}
+
+bool PageFileWriter::Finish()
+{
+	std::lock_guard<std::mutex> lock(m_fout_mtx);
+	if (!m_valid) {
+		return false;
+	}
+
+	m_fout.flush();
+	bool succeed = !!m_fout
+		&& std::find(m_written.begin(), m_written.end(), false) == m_written.end();
+	m_fout.close();
+	m_valid = false;
+
+	return succeed;
+}
+
+}
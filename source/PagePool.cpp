@@ -0,0 +1,51 @@
+#include "vtex/PagePool.h"
+
+#include <chrono>
+
+namespace vtex
+{
+
+PagePool::PagePool(const std::shared_ptr<RenderBackend>& backend, size_t page_size,
+                   PageFormat fmt, const Config& cfg)
+	: m_backend(backend)
+	, m_page_size(page_size)
+	, m_atlas(*backend, cfg.atlas_size, page_size, fmt, cfg.atlas_layers)
+	, m_loader(m_atlas.GetFormat(), page_size, cfg.loader_threads, cfg.loader_max_in_flight)
+	, m_scheduler(cfg.upload)
+	, m_cache(m_atlas, m_loader)
+{
+	m_cache.SetPinnedLevels(cfg.pinned_levels);
+
+	// a frame drains at most every page in flight
+	m_atlas.ReserveStaging(cfg.loader_max_in_flight);
+}
+
+void PagePool::Update()
+{
+	// only finished pages are touched here, reading and decoding
+	// happen on the loader threads
+	m_loader.Drain([&](uint64_t key, const textile::Page& page, const uint8_t* data) {
+		m_cache.LoadComplete(key, page, data);
+	}, m_scheduler);
+
+	// the staged pages in as few calls as their slots allow, the
+	// scheduler adds this to its estimate of the next frames' pages
+	auto start = std::chrono::steady_clock::now();
+	m_atlas.Flush();
+	float flush_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	m_scheduler.RecordFlush(m_atlas.GetFlushStats().upload_bytes, flush_ms);
+
+	m_cache.UpdateTables();
+
+	// ages the policy once per frame, not once per texture
+	m_cache.BeginFrame();
+}
+
+void PagePool::ResizeAtlas(size_t atlas_size)
+{
+	if (atlas_size != static_cast<size_t>(m_atlas.GetSize())) {
+		m_cache.ResizeAtlas(atlas_size);
+	}
+}
+
+}
@@ -0,0 +1,209 @@
+#include "vtex/PagePrefetcher.h"
+
+#include <textile/PageIndexer.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// mips per frame the view has to get finer by to count as zooming in
+const float ZOOM_THRESHOLD = 0.01f;
+
+}
+
+namespace vtex
+{
+
+PagePrefetcher::PagePrefetcher(const textile::PageIndexer& indexer, int page_table_w,
+	                           int page_table_h, const Config& cfg)
+	: m_indexer(indexer)
+	, m_page_table_w(page_table_w)
+	, m_page_table_h(page_table_h)
+	, m_cfg(cfg)
+{
+	m_max_mip = static_cast<int>(std::log2(std::min(page_table_w, page_table_h)));
+
+	m_history.reserve(m_cfg.history + 1);
+	m_candidates.reserve(m_cfg.max_candidates);
+	m_candidate_set.Reserve(m_cfg.max_candidates);
+	m_pending.Reserve(m_cfg.max_candidates);
+}
+
+void PagePrefetcher::SetMotionHint(float du, float dv, float zoom)
+{
+	m_has_hint = true;
+	m_hint_du = du;
+	m_hint_dv = dv;
+	m_hint_zoom = zoom;
+}
+
+void PagePrefetcher::BeginFrame(uint64_t frame)
+{
+	m_frame = frame;
+
+	m_visible.clear();
+	m_visible_set.Clear();
+}
+
+void PagePrefetcher::AddVisible(const textile::Page& page, int page_idx, int count, bool resident)
+{
+	m_visible.push_back({ page, count, resident });
+	m_visible_set.Add(page_idx, 1);
+
+	if (m_pending.Erase(page_idx)) {
+		++m_stats.hits;
+	}
+}
+
+void PagePrefetcher::EndFrame()
+{
+	m_candidates.clear();
+	m_candidate_set.Clear();
+
+	m_pending.EraseIf([this](int, uint64_t frame) {
+		if (m_frame - frame > static_cast<uint64_t>(m_cfg.expire_frames)) {
+			++m_stats.misses;
+			return true;
+		}
+		return false;
+	});
+
+	if (m_visible.empty()) {
+		m_has_hint = false;
+		return;
+	}
+
+	// every pixel also counts for all its parents, so this is coarse,
+	// but it moves with the view
+	Footprint fp = { 0, 0, 0 };
+	float weight = 0;
+	for (auto& v : m_visible)
+	{
+		float scale = static_cast<float>(1 << v.page.mip);
+		fp.x += (v.page.x + 0.5f) * scale * v.count;
+		fp.y += (v.page.y + 0.5f) * scale * v.count;
+		fp.mip += v.page.mip * v.count;
+		weight += v.count;
+	}
+	fp.x /= weight;
+	fp.y /= weight;
+	fp.mip /= weight;
+
+	m_history.push_back(fp);
+	while (static_cast<int>(m_history.size()) > m_cfg.history) {
+		m_history.erase(m_history.begin());
+	}
+
+	float vx, vy, zoom;
+	EstimateMotion(vx, vy, zoom);
+	m_has_hint = false;
+
+	std::sort(m_visible.begin(), m_visible.end(), [](const Visible& a, const Visible& b) {
+		return a.count > b.count;
+	});
+
+	// pages the view is moving onto
+	const float tx = vx * m_cfg.lookahead;
+	const float ty = vy * m_cfg.lookahead;
+	for (auto& v : m_visible)
+	{
+		const float scale = static_cast<float>(1 << v.page.mip);
+		const int ox = static_cast<int>(std::round(tx / scale));
+		const int oy = static_cast<int>(std::round(ty / scale));
+		if (ox != 0 || oy != 0) {
+			AddCandidate(v.page.x + ox, v.page.y + oy, v.page.mip);
+		}
+	}
+
+	// finer mips of the finest visible pages
+	if (zoom > ZOOM_THRESHOLD || m_cfg.always_finer)
+	{
+		for (auto& v : m_visible)
+		{
+			if (!v.resident || v.page.mip == 0) {
+				continue;
+			}
+
+			const int cx = v.page.x * 2, cy = v.page.y * 2, cmip = v.page.mip - 1;
+			bool leaf = true;
+			for (int i = 0; i < 4 && leaf; ++i) {
+				int idx = m_indexer.CalcPageIdx(textile::Page(cx + (i & 1), cy + (i >> 1), cmip));
+				leaf = m_visible_set.Get(idx) == 0;
+			}
+			if (!leaf) {
+				continue;
+			}
+
+			for (int i = 0; i < 4; ++i) {
+				AddCandidate(cx + (i & 1), cy + (i >> 1), cmip);
+			}
+		}
+	}
+}
+
+void PagePrefetcher::OnIssued(int page_idx)
+{
+	if (m_pending.Insert(page_idx, m_frame)) {
+		++m_stats.issued;
+	}
+}
+
+bool PagePrefetcher::IsPending(int page_idx) const
+{
+	return m_pending.Contains(page_idx);
+}
+
+void PagePrefetcher::Clear()
+{
+	m_history.clear();
+	m_pending.Clear();
+	m_candidates.clear();
+	m_candidate_set.Clear();
+}
+
+void PagePrefetcher::EstimateMotion(float& vx, float& vy, float& zoom) const
+{
+	vx = vy = zoom = 0;
+
+	if (m_has_hint)
+	{
+		vx = m_hint_du * m_page_table_w;
+		vy = m_hint_dv * m_page_table_h;
+		zoom = m_hint_zoom;
+		return;
+	}
+
+	if (m_history.size() < 2) {
+		return;
+	}
+
+	const float n = static_cast<float>(m_history.size() - 1);
+	vx = (m_history.back().x - m_history.front().x) / n;
+	vy = (m_history.back().y - m_history.front().y) / n;
+	zoom = (m_history.front().mip - m_history.back().mip) / n;
+}
+
+void PagePrefetcher::AddCandidate(int x, int y, int mip)
+{
+	if (static_cast<int>(m_candidates.size()) >= m_cfg.max_candidates) {
+		return;
+	}
+	if (mip < 0 || mip > m_max_mip) {
+		return;
+	}
+	if (x < 0 || y < 0 || x >= (m_page_table_w >> mip) || y >= (m_page_table_h >> mip)) {
+		return;
+	}
+
+	textile::Page page(x, y, mip);
+	int idx = m_indexer.CalcPageIdx(page);
+	if (m_visible_set.Get(idx) != 0 || m_pending.Contains(idx) || m_candidate_set.Get(idx) != 0) {
+		return;
+	}
+	m_candidate_set.Add(idx, 1);
+	m_candidates.push_back(page);
+}
+
+}
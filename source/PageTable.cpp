@@ -1,26 +1,36 @@
 #include "vtex/PageTable.h"
+#include "vtex/Telemetry.h"
 
-#include <unirender/Device.h>
-#include <unirender/Texture.h>
-#include <unirender/TextureDescription.h>
-#include <textile/PageIndexer.h>
+#include <textile/Page.h>
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 
 #include <assert.h>
 
+namespace
+{
+
+// more rects than this on a level are merged into their bounds
+const size_t MAX_DIRTY_RECTS = 16;
+
+}
+
 namespace vtex
 {
 
-PageTable::PageTable(const ur::Device& dev, int width, int height)
-	: m_width(width)
+PageTable::PageTable(RenderBackend& backend, int width, int height)
+	: m_backend(backend)
+	, m_width(width)
     , m_height(height)
 {
-    const auto level = CalcMaxLevel();
-	m_root = std::make_unique<QuadNode>(level, Rect(0, 0, m_width, m_height));
+	m_max_level = static_cast<int>(CalcMaxLevel());
 
-	m_data.resize(level + 1);
-	for (size_t i = 0; i < level + 1; ++i)
+	size_t entry_n = 0;
+	m_data.resize(m_max_level + 1);
+	m_offsets.resize(m_max_level + 1);
+	for (int i = 0; i < m_max_level + 1; ++i)
 	{
 		int sw = width >> i;
         int sh = height >> i;
@@ -30,169 +40,191 @@ PageTable::PageTable(const ur::Device& dev, int width, int height)
         data.h = sh;
 		data.data = new uint8_t[sw * sh * 4];
 		memset(data.data, 0, sw * sh * 4);
+
+		m_offsets[i] = entry_n;
+		entry_n += sw * sh;
+	}
+	m_entries.resize(entry_n);
+
+	// sized up front, so marking and updating never allocate
+	m_dirty.resize(m_max_level + 1);
+	for (int i = 0; i < m_max_level + 1; ++i) {
+		m_dirty[i].reserve(MAX_DIRTY_RECTS);
+		m_dirty[i].push_back(Rect(0, 0, m_data[i].w, m_data[i].h));
 	}
+	m_upload_buf.reserve(static_cast<size_t>(width) * height * 4);
 
-    ur::TextureDescription desc;
-    desc.target = ur::TextureTarget::Texture2D;
-    desc.width  = m_width;
-    desc.height = m_height;
-    desc.format = ur::TextureFormat::RGBA8;
-    m_tex = dev.CreateTexture(desc, nullptr);
+    m_tex = m_backend.CreateTexture(m_width, m_height, PageFormat::RGBA8, nullptr);
 }
 
-void PageTable::AddPage(const textile::Page& page, int mapping_x, int mapping_y)
+PageTable::~PageTable()
 {
-	int scale = 1 << page.mip;
-	int x = page.x * scale;
-	int y = page.y * scale;
-
-	QuadNode* node = m_root.get();
-	while (page.mip < node->level)
-	{
-		for (int i = 0; i < 4; ++i)
-		{
-			Rect cr = node->CalcChildRect(i);
-			if (!cr.Contain(x, y)) {
-				continue;
-			}
-			if (node->children[i] == nullptr) {
-				node->children[i] = std::make_unique<QuadNode>(node->level - 1, cr);
-			}
-			node = node->children[i].get();
-			break;
-		}
+	for (auto& data : m_data) {
+		delete[] data.data;
 	}
+}
+
+void PageTable::AddPage(const textile::Page& page, int mapping_x, int mapping_y, int layer)
+{
+	assert(page.mip >= 0 && page.mip <= m_max_level);
 
-	node->mapping_x = mapping_x;
-	node->mapping_y = mapping_y;
+	auto& entry = GetEntry(page.x, page.y, page.mip);
+	entry.mapping_x = mapping_x;
+	entry.mapping_y = mapping_y;
+	entry.layer = layer;
+	entry.resident = true;
+
+	MarkDirty(page.x << page.mip, page.y << page.mip, 1 << page.mip, page.mip);
 }
 
 void PageTable::RemovePage(const textile::Page& page)
 {
-	int index;
-	auto node = FindPage(page, index);
-	if (node != nullptr) {
-		node->children[index] = nullptr;
-	}
+	assert(page.mip >= 0 && page.mip <= m_max_level);
+
+	// texels of the page fall back to its nearest resident parent,
+	// resident children keep their own
+	GetEntry(page.x, page.y, page.mip).resident = false;
+
+	MarkDirty(page.x << page.mip, page.y << page.mip, 1 << page.mip, page.mip);
 }
 
 void PageTable::Update()
 {
-	const auto level = CalcMaxLevel();
-	for (size_t i = 0; i < level + 1; ++i)
+	m_stats = UpdateStats();
+	VTEX_SCOPED_TIMER(m_stats.update_ms);
+
+	// coarse to fine, so parents are final before children inherit them
+	for (int i = m_max_level; i >= 0; --i)
 	{
-		m_root->Write(m_data[i].w, m_data[i].h, m_data[i].data, i);
-        m_tex->Upload(m_data[i].data, 0, 0, m_data[i].w, m_data[i].h, i);
+		for (auto& r : m_dirty[i])
+		{
+			WriteRect(i, r);
+			UploadRect(i, r);
+		}
+		m_dirty[i].clear();
 	}
 }
 
-PageTable::QuadNode* PageTable::FindPage(const textile::Page& page, int& index) const
+void PageTable::MarkDirty(int x, int y, int size, int mip)
 {
-	QuadNode* node = m_root.get();
+	// a page only changes its own level and the levels below,
+	// where descendants that aren't resident inherit it
+	for (int i = 0; i <= mip; ++i) {
+		AddDirtyRect(m_dirty[i], Rect(x >> i, y >> i, std::max(size >> i, 1), std::max(size >> i, 1)));
+	}
+}
 
-	int scale = 1 << page.mip;
-	int x = page.x * scale;
-	int y = page.y * scale;
+void PageTable::AddDirtyRect(std::vector<Rect>& rects, const Rect& r)
+{
+	Rect merged = r;
 
-	bool exitloop = false;
-	while (!exitloop)
+	bool changed = true;
+	while (changed)
 	{
-		exitloop = true;
-		for (int i = 0; i < 4; ++i)
+		changed = false;
+		for (auto itr = rects.begin(); itr != rects.end(); )
 		{
-			if (node->children[i] != nullptr && node->children[i]->rect.Contain(x, y))
+			if (itr->Touch(merged))
+			{
+				merged.Combine(*itr);
+				itr = rects.erase(itr);
+				changed = true;
+			}
+			else
 			{
-				// We found it
-				if (page.mip == node->level - 1)
-				{
-					index = i;
-					return node;
-				}
-
-				// Check the children
-				else
-				{
-					node = node->children[i].get();
-					exitloop = false;
-				}
+				++itr;
 			}
 		}
 	}
 
-	// We couldn't find it so it must not exist anymore
-	index = -1;
-	return nullptr;
-}
-
-size_t PageTable::CalcMaxLevel() const
-{
-    return static_cast<size_t>(std::min(std::log2(m_width), std::log2(m_height)));
+	if (rects.size() >= MAX_DIRTY_RECTS)
+	{
+		for (auto& other : rects) {
+			merged.Combine(other);
+		}
+		rects.clear();
+	}
+	rects.push_back(merged);
 }
 
-/************************************************************************/
-/* class PageTable::QuadNode                                            */
-/************************************************************************/
-
-PageTable::QuadNode::QuadNode(int level, const Rect& rect)
-	: level(level)
-	, rect(rect)
-	, mapping_x(0)
-	, mapping_y(0)
+void PageTable::WriteRect(int level, const Rect& r)
 {
-	for (int i = 0; i < 4; ++i) {
-		children[i] = nullptr;
+	auto& img = m_data[level];
+	const Entry* entries = &m_entries[m_offsets[level]];
+	const Image* parent = level < m_max_level ? &m_data[level + 1] : nullptr;
+	for (int y = r.y; y < r.y + r.h; ++y)
+	{
+		for (int x = r.x; x < r.x + r.w; ++x)
+		{
+			uint8_t* dst = img.data + (y * img.w + x) * 4;
+			auto& entry = entries[y * img.w + x];
+			if (entry.resident)
+			{
+				dst[0] = entry.mapping_x;
+				dst[1] = entry.mapping_y;
+				dst[2] = level;
+				dst[3] = entry.layer;
+			}
+			else if (parent)
+			{
+				memcpy(dst, parent->data + ((y >> 1) * parent->w + (x >> 1)) * 4, 4);
+			}
+			else
+			{
+				dst[0] = 0;
+				dst[1] = 0;
+				dst[2] = level;
+				dst[3] = 0;
+			}
+		}
 	}
+
+	m_stats.texels_written += r.w * r.h;
 }
 
-PageTable::Rect PageTable::QuadNode::CalcChildRect(int idx) const
+void PageTable::UploadRect(int level, const Rect& r)
 {
-	int x = rect.x;
-	int y = rect.y;
-	int w = rect.w / 2;
-	int h = rect.h / 2;
+	auto& img = m_data[level];
 
-	switch (idx)
+	const uint8_t* pixels = nullptr;
+	if (r.x == 0 && r.w == img.w)
+	{
+		// whole rows are contiguous already
+		pixels = img.data + r.y * img.w * 4;
+	}
+	else
 	{
-	case 0:
-		return Rect(x, y, w, h);
-	case 1:
-		return Rect(x + w, y, w, h);
-	case 2:
-		return Rect(x + w, y + h, w, h);
-	case 3:
-		return Rect(x, y + h, w, h);
-	default:
-		assert(0);
-		return rect;
+		m_upload_buf.resize(r.w * r.h * 4);
+		for (int y = 0; y < r.h; ++y) {
+			memcpy(&m_upload_buf[y * r.w * 4], img.data + ((r.y + y) * img.w + r.x) * 4, r.w * 4);
+		}
+		pixels = m_upload_buf.data();
 	}
+    m_backend.Upload(*m_tex, pixels, r.x, r.y, r.w, r.h, level);
+
+	m_stats.bytes_uploaded += r.w * r.h * 4;
+	++m_stats.upload_calls;
 }
 
-void PageTable::QuadNode::Write(int w, int h, uint8_t* data, int mip_level)
+size_t PageTable::CalcMaxLevel() const
 {
-	if (level < mip_level) {
-		return;
-	}
+    return static_cast<size_t>(std::min(std::log2(m_width), std::log2(m_height)));
+}
 
-	// fill
-	int rx = rect.x >> mip_level;
-	int ry = rect.y >> mip_level;
-	int rw = rect.w >> mip_level;
-	int rh = rect.h >> mip_level;
-	for (int y = ry; y < ry + rh; ++y) {
-		for (int x = rx; x < rx + rw; ++x) {
-			int ptr = (y * w + x) * 4;
-			data[ptr + 0] = mapping_x;
-			data[ptr + 1] = mapping_y;
-			data[ptr + 2] = level;
-			data[ptr + 3] = 255;
-		}
-	}
+/************************************************************************/
+/* struct PageTable::Rect                                               */
+/************************************************************************/
 
-	for (int i = 0; i < 4; ++i) {
-		if (children[i] != nullptr) {
-			children[i]->Write(w, h, data, mip_level);
-		}
-	}
+void PageTable::Rect::Combine(const Rect& r)
+{
+	int x0 = std::min(x, r.x);
+	int y0 = std::min(y, r.y);
+	int x1 = std::max(x + w, r.x + r.w);
+	int y1 = std::max(y + h, r.y + r.h);
+	x = x0;
+	y = y0;
+	w = x1 - x0;
+	h = y1 - y0;
 }
 
 }
\ No newline at end of file
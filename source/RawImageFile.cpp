@@ -0,0 +1,39 @@
+#include "vtex/RawImageFile.h"
+#include "vtex/PageCodec.h"
+
+namespace vtex
+{
+
+RawImageFile::RawImageFile(const std::string& filepath, int width, int height, int channels)
+	: m_width(width)
+	, m_height(height)
+	, m_channels(channels)
+{
+	if (channels >= 1 && channels <= 4) {
+		m_fin.open(filepath.c_str(), std::ios::in | std::ios::binary);
+	}
+}
+
+bool RawImageFile::ReadRows(int y, int n, uint8_t* dst)
+{
+	if (!m_fin || y < 0 || n < 0 || y + n > m_height) {
+		return false;
+	}
+
+	const size_t row_bytes = static_cast<size_t>(m_width) * m_channels;
+	m_fin.seekg(static_cast<std::streamoff>(row_bytes) * y);
+
+	// read into the tail of dst and expand in place
+	const size_t texel_n = static_cast<size_t>(m_width) * n;
+	uint8_t* src = dst + texel_n * (4 - m_channels);
+	m_fin.read(reinterpret_cast<char*>(src), row_bytes * n);
+	if (!m_fin) {
+		return false;
+	}
+
+	PageCodec::ExpandToRGBA(src, m_channels, texel_n, dst);
+
+	return true;
+}
+
+}
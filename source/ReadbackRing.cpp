@@ -0,0 +1,54 @@
+#include "vtex/ReadbackRing.h"
+
+#include <algorithm>
+
+#include <assert.h>
+
+namespace vtex
+{
+
+ReadbackRing::ReadbackRing(int slot_n, int latency)
+	: m_latency(latency)
+{
+	assert(latency >= 0 && slot_n > latency);
+	m_slots.resize(std::max(slot_n, latency + 1));
+}
+
+int ReadbackRing::Write(uint64_t frame)
+{
+	int idx = m_next;
+	m_next = (m_next + 1) % m_slots.size();
+
+	auto& slot = m_slots[idx];
+	if (slot.written) {
+		++m_dropped;
+	}
+	slot.frame = frame;
+	slot.written = true;
+
+	return idx;
+}
+
+int ReadbackRing::Read(uint64_t frame, uint64_t& src_frame)
+{
+	int oldest = -1;
+	for (int i = 0, n = m_slots.size(); i < n; ++i)
+	{
+		auto& slot = m_slots[i];
+		if (!slot.written || slot.frame + m_latency > frame) {
+			continue;
+		}
+		if (oldest < 0 || slot.frame < m_slots[oldest].frame) {
+			oldest = i;
+		}
+	}
+
+	if (oldest >= 0)
+	{
+		m_slots[oldest].written = false;
+		src_frame = m_slots[oldest].frame;
+	}
+	return oldest;
+}
+
+}
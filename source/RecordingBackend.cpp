@@ -0,0 +1,216 @@
+#include "vtex/RecordingBackend.h"
+#include "vtex/PageCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <assert.h>
+
+namespace
+{
+
+// block compressed formats are addressed in rows of 4x4 blocks
+int block_dim(vtex::PageFormat fmt)
+{
+	return vtex::PageCodec::IsCompressed(fmt) ? 4 : 1;
+}
+
+size_t row_bytes(vtex::PageFormat fmt, int w)
+{
+	const int b = block_dim(fmt);
+	return (w + b - 1) / b * vtex::PageCodec::GetPageBytes(fmt, b);
+}
+
+size_t rect_bytes(vtex::PageFormat fmt, int w, int h)
+{
+	const int b = block_dim(fmt);
+	return row_bytes(fmt, w) * ((h + b - 1) / b);
+}
+
+}
+
+namespace vtex
+{
+
+RecordingBackend::RecordingBackend(bool keep_pixels)
+	: m_keep_pixels(keep_pixels)
+{
+}
+
+RenderBackend::TexturePtr
+RecordingBackend::CreateTexture(int width, int height, PageFormat fmt, const uint8_t* pixels)
+{
+	assert(fmt != PageFormat::RGB8);
+
+	auto tex = std::make_shared<MemTexture>(width, height, fmt);
+
+	const size_t bytes = rect_bytes(fmt, width, height);
+	if (m_keep_pixels)
+	{
+		if (pixels) {
+			tex->pixels.assign(pixels, pixels + bytes);
+		} else {
+			tex->pixels.resize(bytes, 0);
+		}
+	}
+
+	++m_stats.textures_created;
+	m_stats.texture_bytes += bytes;
+
+	return tex;
+}
+
+RenderBackend::TexturePtr
+RecordingBackend::CreateTextureArray(int width, int height, int layers, PageFormat fmt)
+{
+	assert(fmt != PageFormat::RGB8 && layers > 0);
+
+	auto tex = std::make_shared<MemTexture>(width, height, fmt, layers);
+
+	const size_t bytes = rect_bytes(fmt, width, height) * layers;
+	if (m_keep_pixels) {
+		tex->pixels.resize(bytes, 0);
+	}
+
+	++m_stats.textures_created;
+	m_stats.texture_bytes += bytes;
+
+	return tex;
+}
+
+void RecordingBackend::Upload(Texture& tex, const uint8_t* pixels, int x, int y, int w, int h, int level, int layer)
+{
+	const size_t bytes = rect_bytes(tex.format, w, h);
+	++m_stats.upload_calls;
+	m_stats.upload_bytes += bytes;
+
+	auto& mem = static_cast<MemTexture&>(tex);
+	if (level != 0 || mem.pixels.empty()) {
+		return;
+	}
+
+	const int b = block_dim(tex.format);
+	assert(x % b == 0 && y % b == 0 && x + w <= tex.width && y + h <= tex.height);
+	assert(layer >= 0 && layer < tex.layers);
+
+	const size_t src_pitch = row_bytes(tex.format, w);
+	const size_t dst_pitch = row_bytes(tex.format, tex.width);
+	const size_t dst_x = row_bytes(tex.format, x);
+	uint8_t* dst = &mem.pixels[rect_bytes(tex.format, tex.width, tex.height) * layer];
+	for (int row = 0, n = (h + b - 1) / b; row < n; ++row) {
+		memcpy(&dst[(y / b + row) * dst_pitch + dst_x], pixels + row * src_pitch, src_pitch);
+	}
+}
+
+bool RecordingBackend::Copy(const Texture& src, int sx, int sy, Texture& dst, int dx, int dy, int w, int h,
+	                        int src_layer, int dst_layer)
+{
+	assert(src.format == dst.format);
+
+	const size_t bytes = rect_bytes(src.format, w, h);
+	++m_stats.copy_calls;
+	m_stats.copy_bytes += bytes;
+
+	auto& from = static_cast<const MemTexture&>(src).pixels;
+	auto& to = static_cast<MemTexture&>(dst).pixels;
+	if (from.empty() || to.empty()) {
+		return true;
+	}
+
+	const int b = block_dim(src.format);
+	assert(sx % b == 0 && sy % b == 0 && sx + w <= src.width && sy + h <= src.height);
+	assert(dx % b == 0 && dy % b == 0 && dx + w <= dst.width && dy + h <= dst.height);
+	assert(src_layer >= 0 && src_layer < src.layers && dst_layer >= 0 && dst_layer < dst.layers);
+
+	const size_t pitch = row_bytes(src.format, w);
+	const size_t src_pitch = row_bytes(src.format, src.width);
+	const size_t dst_pitch = row_bytes(dst.format, dst.width);
+	const size_t src_x = row_bytes(src.format, sx) + rect_bytes(src.format, src.width, src.height) * src_layer;
+	const size_t dst_x = row_bytes(dst.format, dx) + rect_bytes(dst.format, dst.width, dst.height) * dst_layer;
+	for (int row = 0, n = (h + b - 1) / b; row < n; ++row) {
+		memcpy(&to[(dy / b + row) * dst_pitch + dst_x], &from[(sy / b + row) * src_pitch + src_x], pitch);
+	}
+
+	return true;
+}
+
+RenderBackend::RenderTargetPtr RecordingBackend::CreateRenderTarget(int width, int height)
+{
+	auto rt = std::make_shared<RenderTarget>(width, height);
+
+	// the color is always kept, it is what a readback returns
+	auto color = std::make_shared<MemTexture>(width, height, PageFormat::RGBA8);
+	color->pixels.resize(static_cast<size_t>(width) * height * 4, 0);
+	rt->color = color;
+
+	// color and depth
+	++m_stats.textures_created;
+	m_stats.texture_bytes += static_cast<size_t>(width) * height * 8;
+
+	return rt;
+}
+
+void RecordingBackend::BindRenderTarget(const RenderTarget& rt)
+{
+	assert(!m_bound);
+	m_bound = &rt;
+	++m_stats.target_binds;
+}
+
+void RecordingBackend::UnbindRenderTarget()
+{
+	m_bound = nullptr;
+}
+
+void RecordingBackend::ReadPixels(const RenderTarget* rt, uint8_t* dst, int w, int h)
+{
+	++m_stats.readback_calls;
+	m_stats.readback_bytes += static_cast<size_t>(w) * h * 4;
+
+	if (!rt) {
+		rt = m_bound ? m_bound : m_default_rt.get();
+	}
+	if (!rt)
+	{
+		memset(dst, 0, static_cast<size_t>(w) * h * 4);
+		return;
+	}
+
+	auto& src = static_cast<const MemTexture&>(*rt->color).pixels;
+	const int cw = std::min(w, rt->width);
+	for (int y = 0; y < h; ++y)
+	{
+		uint8_t* row = dst + static_cast<size_t>(y) * w * 4;
+		if (y < rt->height) {
+			memcpy(row, &src[static_cast<size_t>(y) * rt->width * 4], cw * 4);
+			memset(row + cw * 4, 0, (w - cw) * 4);
+		} else {
+			memset(row, 0, static_cast<size_t>(w) * 4);
+		}
+	}
+}
+
+void RecordingBackend::DrawPixels(const uint8_t* rgba, int w, int h)
+{
+	const RenderTarget* rt = m_bound;
+	if (!rt)
+	{
+		if (!m_default_rt || m_default_rt->width != w || m_default_rt->height != h) {
+			m_default_rt = CreateRenderTarget(w, h);
+		}
+		rt = m_default_rt.get();
+	}
+
+	assert(rt->width == w && rt->height == h);
+	auto& dst = static_cast<MemTexture&>(*rt->color).pixels;
+	memcpy(dst.data(), rgba, dst.size());
+}
+
+const uint8_t* RecordingBackend::GetPixels(const Texture& tex, int layer) const
+{
+	assert(layer >= 0 && layer < tex.layers);
+	auto& pixels = static_cast<const MemTexture&>(tex).pixels;
+	return pixels.empty() ? nullptr : pixels.data() + rect_bytes(tex.format, tex.width, tex.height) * layer;
+}
+
+}
@@ -0,0 +1,24 @@
+#include "vtex/ReplacementPolicy.h"
+#include "vtex/LruPolicy.h"
+#include "vtex/ClockPolicy.h"
+#include "vtex/LfuPolicy.h"
+
+namespace vtex
+{
+
+std::unique_ptr<ReplacementPolicy> ReplacementPolicy::Create(ReplacementPolicyType type)
+{
+	switch (type)
+	{
+	case ReplacementPolicyType::LRU:
+		return std::make_unique<LruPolicy>();
+	case ReplacementPolicyType::CLOCK:
+		return std::make_unique<ClockPolicy>();
+	case ReplacementPolicyType::LFU:
+		return std::make_unique<LfuPolicy>();
+	default:
+		return nullptr;
+	}
+}
+
+}
@@ -0,0 +1,113 @@
+#include "vtex/RequestSet.h"
+
+namespace
+{
+
+const size_t MIN_TABLE_SIZE = 1024;
+
+inline uint32_t hash_idx(int page_idx)
+{
+	uint32_t h = static_cast<uint32_t>(page_idx) * 0x9e3779b1;
+	return h ^ (h >> 16);
+}
+
+}
+
+namespace vtex
+{
+
+RequestSet::RequestSet()
+	: m_table(MIN_TABLE_SIZE)
+{
+}
+
+void RequestSet::Add(int page_idx, int count)
+{
+	if ((m_frame.size() + 1) * 2 > m_table.size()) {
+		Grow();
+	}
+
+	const uint32_t mask = static_cast<uint32_t>(m_table.size() - 1);
+	uint32_t i = hash_idx(page_idx) & mask;
+	while (true)
+	{
+		auto& e = m_table[i];
+		if (e.gen != m_gen)
+		{
+			e.gen = m_gen;
+			e.pos = static_cast<int>(m_frame.size());
+			m_frame.push_back({ page_idx, count });
+			return;
+		}
+		if (m_frame[e.pos].page_idx == page_idx)
+		{
+			m_frame[e.pos].count += count;
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+int RequestSet::Get(int page_idx) const
+{
+	int pos = Find(page_idx);
+	return pos < 0 ? 0 : m_frame[pos].count;
+}
+
+void RequestSet::Reserve(size_t n)
+{
+	m_frame.reserve(n);
+	while (m_table.size() < n * 2) {
+		Grow();
+	}
+}
+
+void RequestSet::Clear()
+{
+	m_frame.clear();
+
+	// on wrap around old entries could look current again
+	if (++m_gen == 0)
+	{
+		for (auto& e : m_table) {
+			e.gen = 0;
+		}
+		m_gen = 1;
+	}
+}
+
+int RequestSet::Find(int page_idx) const
+{
+	const uint32_t mask = static_cast<uint32_t>(m_table.size() - 1);
+	uint32_t i = hash_idx(page_idx) & mask;
+	while (true)
+	{
+		auto& e = m_table[i];
+		if (e.gen != m_gen) {
+			return -1;
+		}
+		if (m_frame[e.pos].page_idx == page_idx) {
+			return e.pos;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+void RequestSet::Grow()
+{
+	m_table.assign(m_table.size() * 2, Entry());
+	m_gen = 1;
+
+	const uint32_t mask = static_cast<uint32_t>(m_table.size() - 1);
+	for (int pos = 0, n = m_frame.size(); pos < n; ++pos)
+	{
+		uint32_t i = hash_idx(m_frame[pos].page_idx) & mask;
+		while (m_table[i].gen == m_gen) {
+			i = (i + 1) & mask;
+		}
+		m_table[i].gen = m_gen;
+		m_table[i].pos = pos;
+	}
+}
+
+}
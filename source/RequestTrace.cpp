@@ -0,0 +1,78 @@
+#include "vtex/RequestTrace.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+
+bool read_varint(const uint8_t*& ptr, const uint8_t* end, uint32_t& v)
+{
+	v = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		if (ptr == end) {
+			return false;
+		}
+		uint8_t b = *ptr++;
+		v |= static_cast<uint32_t>(b & 0x7f) << shift;
+		if (!(b & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+}
+
+namespace vtex
+{
+
+RequestTrace::RequestTrace(const std::string& filepath)
+{
+	std::ifstream fin(filepath.c_str(), std::ios::in | std::ios::binary);
+	if (!fin) {
+		return;
+	}
+
+	Header header;
+	fin.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!fin || memcmp(header.magic, "VTTR", 4) != 0 || header.version != VERSION) {
+		return;
+	}
+
+	m_info.vtex_width  = header.vtex_width;
+	m_info.vtex_height = header.vtex_height;
+	m_info.tile_size   = header.tile_size;
+	m_info.border_size = header.border_size;
+
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+	const uint8_t* ptr = data.data();
+	const uint8_t* end = ptr + data.size();
+
+	m_frames.resize(header.frame_count);
+	for (auto& frame : m_frames)
+	{
+		uint32_t n;
+		if (!read_varint(ptr, end, n) || n > static_cast<size_t>(end - ptr)) {
+			return;
+		}
+
+		frame.resize(n);
+		uint32_t idx = 0;
+		for (auto& req : frame)
+		{
+			uint32_t delta, count;
+			if (!read_varint(ptr, end, delta) || !read_varint(ptr, end, count)) {
+				return;
+			}
+			idx += delta;
+			req.page_idx = static_cast<int>(idx);
+			req.count    = static_cast<int>(count);
+		}
+	}
+
+	m_valid = true;
+}
+
+}
@@ -0,0 +1,94 @@
+#include "vtex/RequestTraceWriter.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vtex
+{
+
+RequestTraceWriter::RequestTraceWriter(const std::string& filepath, const textile::VTexInfo& info)
+{
+	memset(&m_header, 0, sizeof(m_header));
+	memcpy(m_header.magic, "VTTR", 4);
+	m_header.version     = RequestTrace::VERSION;
+	m_header.vtex_width  = info.vtex_width;
+	m_header.vtex_height = info.vtex_height;
+	m_header.tile_size   = info.tile_size;
+	m_header.border_size = info.border_size;
+
+	m_fout.open(filepath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!m_fout) {
+		return;
+	}
+
+	m_fout.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+	m_size = sizeof(m_header);
+
+	m_valid = !!m_fout;
+}
+
+RequestTraceWriter::~RequestTraceWriter()
+{
+	Finish();
+}
+
+void RequestTraceWriter::AddFrame(const RequestFrame& frame)
+{
+	if (!m_valid) {
+		return;
+	}
+
+	// deltas need ascending indices
+	const RequestFrame* src = &frame;
+	auto less = [](const PageRequest& a, const PageRequest& b) {
+		return a.page_idx < b.page_idx;
+	};
+	if (!std::is_sorted(frame.begin(), frame.end(), less))
+	{
+		m_sorted = frame;
+		std::sort(m_sorted.begin(), m_sorted.end(), less);
+		src = &m_sorted;
+	}
+
+	m_buf.clear();
+	WriteVarint(static_cast<uint32_t>(src->size()));
+	int prev = 0;
+	for (auto& req : *src)
+	{
+		WriteVarint(static_cast<uint32_t>(req.page_idx - prev));
+		WriteVarint(static_cast<uint32_t>(req.count));
+		prev = req.page_idx;
+	}
+
+	m_fout.write(reinterpret_cast<const char*>(m_buf.data()), m_buf.size());
+	m_size += m_buf.size();
+	++m_header.frame_count;
+
+	m_valid = !!m_fout;
+}
+
+bool RequestTraceWriter::Finish()
+{
+	if (!m_valid) {
+		return false;
+	}
+
+	m_fout.seekp(0);
+	m_fout.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+	m_fout.close();
+	m_valid = false;
+
+	return !m_fout.fail();
+}
+
+void RequestTraceWriter::WriteVarint(uint32_t v)
+{
+	while (v >= 0x80)
+	{
+		m_buf.push_back(static_cast<uint8_t>(v | 0x80));
+		v >>= 7;
+	}
+	m_buf.push_back(static_cast<uint8_t>(v));
+}
+
+}
@@ -0,0 +1,366 @@
+#include "vtex/SoftRenderer.h"
+#include "vtex/PageTable.h"
+
+#include <textile/VTexInfo.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+// rows per chunk handed to a thread, even so quads stay together
+const int CHUNK_ROWS = 16;
+
+bool fetch_uv(const vtex::UvBuffer& buf, int x, int y, float* uv)
+{
+	if (x < 0 || y < 0 || x >= buf.width || y >= buf.height) {
+		return false;
+	}
+	size_t i = static_cast<size_t>(y) * buf.width + x;
+	if (!buf.covered[i]) {
+		return false;
+	}
+	uv[0] = buf.uv[i * 2];
+	uv[1] = buf.uv[i * 2 + 1];
+	return true;
+}
+
+// coarse derivative in x (dir 0) or y (dir 1) like the hardware, from
+// the pixel's own quad first, neighbour quads if its partners are
+// not covered
+void derivative(const vtex::UvBuffer& buf, int x, int y, int dir, float* d)
+{
+	const int qx = x & ~1, qy = y & ~1;
+
+	int pairs[4][4];
+	if (dir == 0)
+	{
+		int p[4][4] = {
+			{ qx, qy, qx + 1, qy }, { qx, qy + 1, qx + 1, qy + 1 },
+			{ x - 1, y, x, y }, { x, y, x + 1, y },
+		};
+		memcpy(pairs, p, sizeof(p));
+	}
+	else
+	{
+		int p[4][4] = {
+			{ qx, qy, qx, qy + 1 }, { qx + 1, qy, qx + 1, qy + 1 },
+			{ x, y - 1, x, y }, { x, y, x, y + 1 },
+		};
+		memcpy(pairs, p, sizeof(p));
+	}
+
+	for (auto& p : pairs)
+	{
+		float a[2], b[2];
+		if (fetch_uv(buf, p[0], p[1], a) && fetch_uv(buf, p[2], p[3], b)) {
+			d[0] = b[0] - a[0];
+			d[1] = b[1] - a[1];
+			return;
+		}
+	}
+	d[0] = d[1] = 0;
+}
+
+// tex_mip_level() of both shaders, on a target `scale` times smaller
+// than the uv buffer
+float tex_mip_level(const vtex::UvBuffer& buf, int x, int y, const float* tex_size, float scale = 1)
+{
+	float dx[2], dy[2];
+	derivative(buf, x, y, 0, dx);
+	derivative(buf, x, y, 1, dy);
+	for (int i = 0; i < 2; ++i) {
+		dx[i] *= tex_size[i] * scale;
+		dy[i] *= tex_size[i] * scale;
+	}
+
+	float dtex_x = dx[0] * dx[0] + dy[0] * dy[0];
+	float dtex_y = dx[1] * dx[1] + dy[1] * dy[1];
+	float min_delta = std::max(dtex_x, dtex_y);
+	if (min_delta <= 0) {
+		return 0;
+	}
+	return std::max(0.5f * std::log2(min_delta), 0.0f);
+}
+
+float fract(float v)
+{
+	return v - std::floor(v);
+}
+
+void sample_bilinear(const uint8_t* img, int size, float u, float v, uint8_t* dst)
+{
+	float fx = u * size - 0.5f;
+	float fy = v * size - 0.5f;
+	int x0 = static_cast<int>(std::floor(fx));
+	int y0 = static_cast<int>(std::floor(fy));
+	float tx = fx - x0;
+	float ty = fy - y0;
+
+	auto texel = [&](int x, int y) {
+		x = std::min(std::max(x, 0), size - 1);
+		y = std::min(std::max(y, 0), size - 1);
+		return img + (static_cast<size_t>(y) * size + x) * 4;
+	};
+	const uint8_t* t00 = texel(x0, y0);
+	const uint8_t* t10 = texel(x0 + 1, y0);
+	const uint8_t* t01 = texel(x0, y0 + 1);
+	const uint8_t* t11 = texel(x0 + 1, y0 + 1);
+	for (int c = 0; c < 4; ++c)
+	{
+		float top = t00[c] + (t10[c] - t00[c]) * tx;
+		float bot = t01[c] + (t11[c] - t01[c]) * tx;
+		dst[c] = static_cast<uint8_t>(top + (bot - top) * ty + 0.5f);
+	}
+}
+
+}
+
+namespace vtex
+{
+
+/************************************************************************/
+/* struct UvBuffer                                                      */
+/************************************************************************/
+
+void UvBuffer::Resize(int w, int h)
+{
+	width = w;
+	height = h;
+	uv.assign(static_cast<size_t>(w) * h * 2, 0.0f);
+	covered.assign(static_cast<size_t>(w) * h, 0);
+}
+
+void UvBuffer::Clear()
+{
+	std::fill(covered.begin(), covered.end(), 0);
+}
+
+void UvBuffer::Set(int x, int y, float u, float v)
+{
+	size_t i = static_cast<size_t>(y) * width + x;
+	uv[i * 2] = u;
+	uv[i * 2 + 1] = v;
+	covered[i] = 1;
+}
+
+void UvBuffer::FillPlane(float cam_u, float cam_v, float cam_h, float pitch, float fov_y)
+{
+	Clear();
+
+	const float tan_half = std::tan(fov_y * 0.5f);
+	const float aspect = static_cast<float>(width) / height;
+
+	// forward is +v, tilted down towards the plane
+	const float fwd[3] = { 0, std::cos(pitch), -std::sin(pitch) };
+	const float up[3]  = { 0, std::sin(pitch), std::cos(pitch) };
+
+	for (int y = 0; y < height; ++y)
+	{
+		float py = (1.0f - 2.0f * (y + 0.5f) / height) * tan_half;
+		for (int x = 0; x < width; ++x)
+		{
+			float px = (2.0f * (x + 0.5f) / width - 1.0f) * tan_half * aspect;
+			float dir[3] = {
+				px,
+				fwd[1] + py * up[1],
+				fwd[2] + py * up[2],
+			};
+			if (dir[2] >= 0) {
+				continue;
+			}
+
+			float t = cam_h / -dir[2];
+			float u = cam_u + dir[0] * t;
+			float v = cam_v + dir[1] * t;
+			if (u >= 0 && u < 1 && v >= 0 && v < 1) {
+				Set(x, y, u, v);
+			}
+		}
+	}
+}
+
+/************************************************************************/
+/* class SoftRenderer                                                   */
+/************************************************************************/
+
+SoftRenderer::Params SoftRenderer::MakeParams(const textile::VTexInfo& info, int atlas_size, float mip_sample_bias)
+{
+	Params p;
+	p.page_table_size  = static_cast<float>(info.PageTableWidth());
+	p.virt_tex_size[0] = static_cast<float>(info.vtex_width);
+	p.virt_tex_size[1] = static_cast<float>(info.vtex_height);
+	p.mip_sample_bias  = mip_sample_bias;
+
+	const float page_size = static_cast<float>(info.PageSize());
+	p.atlas_scale   = page_size / atlas_size;
+	p.border_scale  = (page_size - 2 * info.border_size) / page_size;
+	p.border_offset = info.border_size / page_size;
+	p.atlas_size    = atlas_size;
+
+	return p;
+}
+
+SoftRenderer::SoftRenderer(int thread_n)
+{
+	if (thread_n <= 0) {
+		thread_n = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	}
+
+	m_next_row = 0;
+
+	// the calling thread is one of them
+	for (int i = 1; i < thread_n; ++i) {
+		m_threads.emplace_back(&SoftRenderer::WorkerLoop, this);
+	}
+}
+
+SoftRenderer::~SoftRenderer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_stop = true;
+	}
+	m_start_cv.notify_all();
+	for (auto& t : m_threads) {
+		t.join();
+	}
+}
+
+void SoftRenderer::RenderFeedback(const UvBuffer& uv, const Params& params, uint8_t* dst)
+{
+	const float max_mip = std::log2(params.page_table_size);
+
+	const int s = params.subsample;
+	const int w = uv.width / s;
+	ParallelRows(uv.height / s, [&](int y0, int y1)
+	{
+		for (int y = y0; y < y1; ++y)
+		{
+			for (int x = 0; x < w; ++x)
+			{
+				const int ux = x * s + params.jitter[0];
+				const int uy = y * s + params.jitter[1];
+				size_t i = static_cast<size_t>(uy) * uv.width + ux;
+				uint8_t* out = dst + (static_cast<size_t>(y) * w + x) * 4;
+				if (!uv.covered[i]) {
+					memset(out, 0, 4);
+					continue;
+				}
+
+				float mip = std::floor(tex_mip_level(uv, ux, uy, params.virt_tex_size, static_cast<float>(s)) - params.mip_sample_bias);
+				mip = std::min(std::max(mip, 0.0f), max_mip);
+
+				float times = params.page_table_size / std::exp2(mip);
+				for (int c = 0; c < 2; ++c) {
+					float offset = std::floor(uv.uv[i * 2 + c] * times);
+					out[c] = static_cast<uint8_t>(std::min(std::max(offset, 0.0f), times - 1));
+				}
+				out[2] = static_cast<uint8_t>(mip);
+				out[3] = 255;
+			}
+		}
+	});
+}
+
+void SoftRenderer::RenderFinal(const UvBuffer& uv, const Params& params,
+	                           const PageTable& table, const uint8_t* atlas, uint8_t* dst)
+{
+	const int pt_size = static_cast<int>(params.page_table_size);
+	const float max_mip = std::log2(params.page_table_size);
+	const size_t layer_bytes = static_cast<size_t>(params.atlas_size) * params.atlas_size * 4;
+
+	ParallelRows(uv.height, [&](int y0, int y1)
+	{
+		for (int y = y0; y < y1; ++y)
+		{
+			for (int x = 0; x < uv.width; ++x)
+			{
+				size_t i = static_cast<size_t>(y) * uv.width + x;
+				uint8_t* out = dst + i * 4;
+				if (!uv.covered[i]) {
+					memset(out, 0, 4);
+					continue;
+				}
+
+				const float u = uv.uv[i * 2];
+				const float v = uv.uv[i * 2 + 1];
+
+				// bilinear_sample()
+				float mip = std::floor(tex_mip_level(uv, x, y, params.virt_tex_size));
+				int level = static_cast<int>(std::min(std::max(mip, 0.0f), max_mip));
+
+				// sample_table(), nearest texel of the level
+				int tx = std::min(static_cast<int>(u * pt_size), pt_size - 1) >> level;
+				int ty = std::min(static_cast<int>(v * pt_size), pt_size - 1) >> level;
+				const uint8_t* page = table.GetLevelData(level) + (static_cast<size_t>(ty) * (pt_size >> level) + tx) * 4;
+
+				// sample_atlas()
+				float mipsize = std::exp2(static_cast<float>(page[2]));
+				float su = fract(u * params.page_table_size / mipsize) * params.border_scale + params.border_offset;
+				float sv = fract(v * params.page_table_size / mipsize) * params.border_scale + params.border_offset;
+				sample_bilinear(atlas + page[3] * layer_bytes, params.atlas_size,
+					(page[0] + su) * params.atlas_scale, (page[1] + sv) * params.atlas_scale, out);
+			}
+		}
+	});
+}
+
+void SoftRenderer::ParallelRows(int height, const std::function<void(int y0, int y1)>& fn)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_job = &fn;
+		m_job_height = height;
+		m_next_row = 0;
+		m_running = static_cast<int>(m_threads.size());
+		++m_generation;
+	}
+	m_start_cv.notify_all();
+
+	RunChunks();
+
+	std::unique_lock<std::mutex> lock(m_mtx);
+	m_done_cv.wait(lock, [this] { return m_running == 0; });
+	m_job = nullptr;
+}
+
+void SoftRenderer::WorkerLoop()
+{
+	uint64_t generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mtx);
+			m_start_cv.wait(lock, [&] { return m_stop || m_generation != generation; });
+			if (m_stop) {
+				return;
+			}
+			generation = m_generation;
+		}
+
+		RunChunks();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			--m_running;
+		}
+		m_done_cv.notify_one();
+	}
+}
+
+void SoftRenderer::RunChunks()
+{
+	while (true)
+	{
+		int y0 = m_next_row.fetch_add(CHUNK_ROWS);
+		if (y0 >= m_job_height) {
+			break;
+		}
+		(*m_job)(y0, std::min(y0 + CHUNK_ROWS, m_job_height));
+	}
+}
+
+}
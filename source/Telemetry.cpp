@@ -0,0 +1,340 @@
+#include "vtex/Telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+
+// buckets below 2^0
+const int HISTOGRAM_FRAC_BUCKETS = 7;
+
+// totals sum every counter and time
+void accumulate(vtex::FrameStats& dst, const vtex::FrameStats& src)
+{
+	dst.frame = src.frame;
+
+	dst.feedback += src.feedback;
+	dst.readback_bytes += src.readback_bytes;
+
+	dst.download_ms += src.download_ms;
+	dst.analyze_ms  += src.analyze_ms;
+	dst.update_ms   += src.update_ms;
+	dst.pool_ms     += src.pool_ms;
+	dst.table_ms    += src.table_ms;
+
+	dst.requested  += src.requested;
+	dst.hits       += src.hits;
+	dst.misses     += src.misses;
+	dst.issued     += src.issued;
+	dst.deferred   += src.deferred;
+	dst.prefetched += src.prefetched;
+
+	dst.loaded  += src.loaded;
+	dst.evicted += src.evicted;
+	dst.dropped += src.dropped;
+
+	dst.table_texels  += src.table_texels;
+	dst.table_uploads += src.table_uploads;
+	dst.table_bytes   += src.table_bytes;
+
+	dst.mip_bias = src.mip_bias;
+	dst.mip_bias_changes += src.mip_bias_changes;
+	dst.atlas_pressure = src.atlas_pressure;
+	dst.thrash_rate    = src.thrash_rate;
+}
+
+const char* CSV_HEADER =
+	"frame,feedback,readback_bytes,download_ms,analyze_ms,update_ms,pool_ms,table_ms,requested,hits,misses,issued,deferred,"
+	"prefetched,loaded,evicted,dropped,table_texels,table_uploads,table_bytes,mip_bias,mip_bias_changes,"
+	"atlas_pressure,thrash_rate";
+
+void write_row(std::ostream& os, const vtex::FrameStats& s, char sep)
+{
+	os << s.frame << sep << s.feedback << sep << s.readback_bytes << sep
+	   << s.download_ms << sep << s.analyze_ms << sep << s.update_ms << sep << s.pool_ms << sep << s.table_ms << sep
+	   << s.requested << sep << s.hits << sep << s.misses << sep << s.issued << sep
+	   << s.deferred << sep << s.prefetched << sep
+	   << s.loaded << sep << s.evicted << sep << s.dropped << sep
+	   << s.table_texels << sep << s.table_uploads << sep << s.table_bytes << sep
+	   << s.mip_bias << sep << s.mip_bias_changes << sep
+	   << s.atlas_pressure << sep << s.thrash_rate;
+}
+
+}
+
+namespace vtex
+{
+
+Telemetry::Telemetry(int window)
+	: m_frames(std::max(window, 1))
+{
+}
+
+void Telemetry::Record(const FrameStats& stats)
+{
+	const int n = static_cast<int>(Metric::MaxNum);
+
+	auto& slot = m_frames[m_next];
+	if (m_count == static_cast<int>(m_frames.size()))
+	{
+		for (int i = 0; i < n; ++i) {
+			m_hists[i].Remove(MetricValue(slot, static_cast<Metric>(i)));
+		}
+	}
+	else
+	{
+		++m_count;
+	}
+
+	slot = stats;
+	for (int i = 0; i < n; ++i) {
+		m_hists[i].Add(MetricValue(slot, static_cast<Metric>(i)));
+	}
+	m_next = (m_next + 1) % m_frames.size();
+
+	accumulate(m_totals, stats);
+}
+
+const FrameStats& Telemetry::GetLast() const
+{
+	static const FrameStats EMPTY;
+	if (m_count == 0) {
+		return EMPTY;
+	}
+	return m_frames[(m_next + m_frames.size() - 1) % m_frames.size()];
+}
+
+void Telemetry::GetFrames(std::vector<FrameStats>& frames) const
+{
+	frames.clear();
+	frames.reserve(m_count);
+	const int size = static_cast<int>(m_frames.size());
+	for (int i = 0; i < m_count; ++i) {
+		frames.push_back(m_frames[(m_next - m_count + i + size) % size]);
+	}
+}
+
+double Telemetry::GetMean(Metric m) const
+{
+	if (m_count == 0) {
+		return 0;
+	}
+
+	double sum = 0;
+	const int size = static_cast<int>(m_frames.size());
+	for (int i = 0; i < m_count; ++i) {
+		sum += MetricValue(m_frames[(m_next - m_count + i + size) % size], m);
+	}
+	return sum / m_count;
+}
+
+double Telemetry::GetMax(Metric m) const
+{
+	double ret = 0;
+	const int size = static_cast<int>(m_frames.size());
+	for (int i = 0; i < m_count; ++i) {
+		ret = std::max(ret, MetricValue(m_frames[(m_next - m_count + i + size) % size], m));
+	}
+	return ret;
+}
+
+void Telemetry::Reset()
+{
+	m_next = 0;
+	m_count = 0;
+	for (auto& h : m_hists) {
+		h = Histogram();
+	}
+	m_totals = FrameStats();
+}
+
+bool Telemetry::DumpCSV(const std::string& filepath) const
+{
+	std::ofstream fout(filepath);
+	if (!fout) {
+		return false;
+	}
+
+	fout << CSV_HEADER << '\n';
+
+	std::vector<FrameStats> frames;
+	GetFrames(frames);
+	for (auto& f : frames) {
+		write_row(fout, f, ',');
+		fout << '\n';
+	}
+	return static_cast<bool>(fout);
+}
+
+bool Telemetry::DumpJSON(const std::string& filepath) const
+{
+	std::ofstream fout(filepath);
+	if (!fout) {
+		return false;
+	}
+
+	// the csv columns double as the json keys
+	std::vector<std::string> keys;
+	std::string header(CSV_HEADER);
+	for (size_t begin = 0, end; begin < header.size(); begin = end + 1)
+	{
+		end = header.find(',', begin);
+		if (end == std::string::npos) {
+			end = header.size();
+		}
+		keys.push_back(header.substr(begin, end - begin));
+	}
+
+	auto write_object = [&](const FrameStats& s)
+	{
+		std::ostringstream row;
+		write_row(row, s, ',');
+		std::string values = row.str();
+
+		fout << "{";
+		size_t begin = 0;
+		for (size_t i = 0; i < keys.size(); ++i)
+		{
+			size_t end = values.find(',', begin);
+			if (end == std::string::npos) {
+				end = values.size();
+			}
+			fout << (i ? ", " : "") << "\"" << keys[i] << "\": " << values.substr(begin, end - begin);
+			begin = end + 1;
+		}
+		fout << "}";
+	};
+
+	fout << "{\n  \"frames_in_window\": " << m_count << ",\n";
+
+	fout << "  \"totals\": ";
+	write_object(m_totals);
+	fout << ",\n";
+
+	fout << "  \"metrics\": {\n";
+	for (int i = 0, n = static_cast<int>(Metric::MaxNum); i < n; ++i)
+	{
+		auto m = static_cast<Metric>(i);
+		auto& h = GetHistogram(m);
+		fout << "    \"" << MetricName(m) << "\": {"
+			 << "\"mean\": " << GetMean(m) << ", \"max\": " << GetMax(m)
+			 << ", \"p50\": " << h.Percentile(0.5) << ", \"p95\": " << h.Percentile(0.95)
+			 << ", \"p99\": " << h.Percentile(0.99) << "}"
+			 << (i + 1 < n ? ",\n" : "\n");
+	}
+	fout << "  },\n";
+
+	fout << "  \"frames\": [\n";
+	std::vector<FrameStats> frames;
+	GetFrames(frames);
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		fout << "    ";
+		write_object(frames[i]);
+		fout << (i + 1 < frames.size() ? ",\n" : "\n");
+	}
+	fout << "  ]\n}\n";
+
+	return static_cast<bool>(fout);
+}
+
+const char* Telemetry::MetricName(Metric m)
+{
+	switch (m)
+	{
+	case Metric::DownloadMs:
+		return "download_ms";
+	case Metric::AnalyzeMs:
+		return "analyze_ms";
+	case Metric::UpdateMs:
+		return "update_ms";
+	case Metric::PoolMs:
+		return "pool_ms";
+	case Metric::TableMs:
+		return "table_ms";
+	case Metric::Requested:
+		return "requested";
+	case Metric::Misses:
+		return "misses";
+	case Metric::Loaded:
+		return "loaded";
+	case Metric::Evicted:
+		return "evicted";
+	case Metric::TableBytes:
+		return "table_bytes";
+	default:
+		return "";
+	}
+}
+
+double Telemetry::MetricValue(const FrameStats& stats, Metric m)
+{
+	switch (m)
+	{
+	case Metric::DownloadMs:
+		return stats.download_ms;
+	case Metric::AnalyzeMs:
+		return stats.analyze_ms;
+	case Metric::UpdateMs:
+		return stats.update_ms;
+	case Metric::PoolMs:
+		return stats.pool_ms;
+	case Metric::TableMs:
+		return stats.table_ms;
+	case Metric::Requested:
+		return stats.requested;
+	case Metric::Misses:
+		return stats.misses;
+	case Metric::Loaded:
+		return stats.loaded;
+	case Metric::Evicted:
+		return stats.evicted;
+	case Metric::TableBytes:
+		return static_cast<double>(stats.table_bytes);
+	default:
+		return 0;
+	}
+}
+
+/************************************************************************/
+/* class Telemetry::Histogram                                           */
+/************************************************************************/
+
+double Telemetry::Histogram::Percentile(double p) const
+{
+	if (m_count == 0) {
+		return 0;
+	}
+
+	const int target = std::max(1, static_cast<int>(std::ceil(p * m_count)));
+	int sum = 0;
+	for (int i = 0; i < BUCKET_NUM; ++i)
+	{
+		sum += m_buckets[i];
+		if (sum >= target) {
+			return BucketMax(i);
+		}
+	}
+	return BucketMax(BUCKET_NUM - 1);
+}
+
+double Telemetry::Histogram::BucketMax(int i)
+{
+	return std::ldexp(1.0, i + 1 - HISTOGRAM_FRAC_BUCKETS);
+}
+
+int Telemetry::Histogram::Bucket(double v)
+{
+	if (v <= 0) {
+		return 0;
+	}
+	int e;
+	std::frexp(v, &e);
+	// v in [2^(e - 1), 2^e)
+	return std::min(std::max(e - 1 + HISTOGRAM_FRAC_BUCKETS, 0), BUCKET_NUM - 1);
+}
+
+}
@@ -0,0 +1,120 @@
+#include "vtex/TextilePageSource.h"
+#include "vtex/PageCodec.h"
+
+#include <textile/Page.h>
+#include <textile/PageIndexer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace vtex
+{
+
+TextilePageSource::TextilePageSource(const std::string& filepath, const textile::PageIndexer& indexer,
+	                                 size_t page_size, int channels)
+	: m_indexer(indexer)
+	, m_channels(channels)
+	, m_texel_n(page_size * page_size)
+	, m_loader(filepath, indexer)
+	, m_sink(*this, m_loader, indexer)
+{
+	std::ifstream fin(filepath.c_str(), std::ios::in | std::ios::binary);
+	m_valid = fin && fin.peek() != std::ifstream::traits_type::eof();
+}
+
+TextilePageSource::~TextilePageSource()
+{
+	Close();
+}
+
+PageFormat TextilePageSource::GetPageFormat() const
+{
+	return m_channels == 3 ? PageFormat::RGBA8 : PageCodec::FromChannels(m_channels);
+}
+
+size_t TextilePageSource::GetPageBytes() const
+{
+	return m_texel_n * (m_channels == 3 ? 4 : m_channels);
+}
+
+bool TextilePageSource::ReadPage(const textile::Page& page, uint8_t* dst)
+{
+	if (!m_valid) {
+		return false;
+	}
+
+	Read read;
+	read.page      = page;
+	read.page_idx  = m_indexer.CalcPageIdx(page);
+	read.dst       = dst;
+	read.requested = false;
+	read.done      = false;
+
+	std::unique_lock<std::mutex> lock(m_mtx);
+	if (m_closed) {
+		return false;
+	}
+	m_reads.push_back(&read);
+	m_cv.wait(lock, [&] { return read.done || m_closed; });
+	m_reads.erase(std::find(m_reads.begin(), m_reads.end(), &read));
+
+	return read.done;
+}
+
+void TextilePageSource::Update(const ur::Device& dev)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		for (auto read : m_reads)
+		{
+			if (!read->requested) {
+				m_sink.Request(dev, read->page);
+				read->requested = true;
+			}
+		}
+	}
+
+	// LoadComplete() is called from here
+	m_loader.Update(dev);
+}
+
+void TextilePageSource::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		m_closed = true;
+	}
+	m_cv.notify_all();
+}
+
+void TextilePageSource::OnLoaded(const textile::Page& page, const uint8_t* data)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mtx);
+		const int page_idx = m_indexer.CalcPageIdx(page);
+		auto itr = std::find_if(m_reads.begin(), m_reads.end(), [&](const Read* read) {
+			return read->page_idx == page_idx && !read->done;
+		});
+		// cancelled and failed since it was requested
+		if (itr == m_reads.end()) {
+			return;
+		}
+
+		auto read = *itr;
+		if (m_channels == 3) {
+			PageCodec::ExpandToRGBA(data, 3, m_texel_n, read->dst);
+		} else {
+			memcpy(read->dst, data, GetPageBytes());
+		}
+		read->done = true;
+	}
+	m_cv.notify_all();
+}
+
+void TextilePageSource::Sink::LoadComplete(const ur::Device&, const textile::Page& page, const uint8_t* data)
+{
+	m_owner.OnLoaded(page, data);
+}
+
+}
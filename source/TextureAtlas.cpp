@@ -1,41 +1,237 @@
 #include "vtex/TextureAtlas.h"
+#include "vtex/PageCodec.h"
 
-#include <unirender/Device.h>
-#include <unirender/TextureDescription.h>
-#include <unirender/Texture.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <assert.h>
 
 namespace vtex
 {
 
-TextureAtlas::TextureAtlas(const ur::Device& dev, size_t atlas_size,
-                           size_t page_size, int tex_channel)
-	: m_atlas_size(atlas_size)
+TextureAtlas::TextureAtlas(RenderBackend& backend, size_t atlas_size,
+                           size_t page_size, PageFormat fmt, int layers)
+	: m_backend(backend)
+	, m_atlas_size(atlas_size)
 	, m_page_size(page_size)
-	, m_tex_channel(tex_channel)
+	, m_layers(layers)
+	, m_format(fmt == PageFormat::RGB8 ? PageFormat::RGBA8 : fmt)
 {
-	m_page_count = m_atlas_size / m_page_size;
+	assert(m_layers > 0);
+	m_page_bytes = PageCodec::GetPageBytes(m_format, m_page_size);
+
+	CreateTexture();
+}
+
+bool TextureAtlas::Resize(size_t atlas_size, std::vector<PageMove>& moves)
+{
+	// the staged pages have slots of the old texture
+	Flush();
+
+	const size_t old_size = m_atlas_size;
+	auto old_tex = m_tex;
+
+	m_atlas_size = atlas_size;
+	CreateTexture();
+
+	// by layer, row, then column of the new texture
+	std::sort(moves.begin(), moves.end(), [](const PageMove& a, const PageMove& b)->bool {
+		if (a.dst_layer != b.dst_layer) {
+			return a.dst_layer < b.dst_layer;
+		} else if (a.dst_y != b.dst_y) {
+			return a.dst_y < b.dst_y;
+		} else {
+			return a.dst_x < b.dst_x;
+		}
+	});
+
+	bool copied = true;
+	for (size_t begin = 0, n = moves.size(); begin < n && copied; )
+	{
+		auto& first = moves[begin];
 
-    uint8_t* pixels = new uint8_t[atlas_size * atlas_size * 4];
-    memset(pixels, 0xff, atlas_size * atlas_size * 4);
+		size_t end = begin + 1;
+		while (end < n && moves[end].dst_layer == first.dst_layer && moves[end].src_layer == first.src_layer
+			&& moves[end].dst_y == first.dst_y && moves[end].src_y == first.src_y
+			&& moves[end].dst_x == moves[end - 1].dst_x + 1 && moves[end].src_x == moves[end - 1].src_x + 1) {
+			++end;
+		}
 
-    ur::TextureDescription desc;
-    desc.target = ur::TextureTarget::Texture2D;
-    desc.width  = atlas_size;
-    desc.height = atlas_size;
-    desc.format = ur::TextureFormat::RGBA8;
-    m_tex = dev.CreateTexture(desc, pixels);
+		copied = m_backend.Copy(*old_tex, first.src_x * m_page_size, first.src_y * m_page_size,
+			*m_tex, first.dst_x * m_page_size, first.dst_y * m_page_size, (end - begin) * m_page_size, m_page_size,
+			first.src_layer, first.dst_layer);
 
-	delete[] pixels;
+		begin = end;
+	}
+	if (!copied) {
+		CreateTexture();
+	}
+
+	if (!m_shadow.empty())
+	{
+		std::vector<uint8_t> old_shadow(m_atlas_size * m_atlas_size * 4 * m_layers, 0xff);
+		old_shadow.swap(m_shadow);
+		if (copied)
+		{
+			for (auto& m : moves) {
+				for (size_t row = 0; row < m_page_size; ++row)
+				{
+					size_t src = ((m.src_layer * old_size + m.src_y * m_page_size + row) * old_size + m.src_x * m_page_size) * 4;
+					size_t dst = ((m.dst_layer * m_atlas_size + m.dst_y * m_page_size + row) * m_atlas_size + m.dst_x * m_page_size) * 4;
+					memcpy(&m_shadow[dst], &old_shadow[src], m_page_size * 4);
+				}
+			}
+		}
+	}
+
+	return copied;
 }
 
-void TextureAtlas::Bind()
+void TextureAtlas::UploadPage(const uint8_t* pixels, int x, int y, int layer)
 {
-    m_tex->Bind();
+	assert(layer >= 0 && layer < m_layers);
+
+	const int pos = static_cast<int>(m_staged.size());
+	if (m_staging.size() < (pos + 1) * m_page_bytes) {
+		m_staging.resize((pos + 1) * m_page_bytes);
+	}
+	memcpy(&m_staging[pos * m_page_bytes], pixels, m_page_bytes);
+	m_staged.push_back({ x, y, layer, pos });
+
+	if (m_shadow.empty()) {
+		return;
+	}
+
+	PageCodec::ToRGBA(pixels, m_format, m_page_size, m_shadow_page.data());
+	for (size_t row = 0; row < m_page_size; ++row)
+	{
+		size_t dst = ((layer * m_atlas_size + y * m_page_size + row) * m_atlas_size + x * m_page_size) * 4;
+		memcpy(&m_shadow[dst], &m_shadow_page[row * m_page_size * 4], m_page_size * 4);
+	}
+}
+
+void TextureAtlas::Flush()
+{
+	m_flush_stats = FlushStats();
+	if (m_staged.empty()) {
+		return;
+	}
+
+	// by layer, row, then column, a slot staged twice keeps the later page
+	std::sort(m_staged.begin(), m_staged.end(), [](const Staged& a, const Staged& b)->bool {
+		if (a.layer != b.layer) {
+			return a.layer < b.layer;
+		} else if (a.y != b.y) {
+			return a.y < b.y;
+		} else if (a.x != b.x) {
+			return a.x < b.x;
+		} else {
+			return a.pos < b.pos;
+		}
+	});
+	size_t n = 0;
+	for (size_t i = 0; i < m_staged.size(); ++i)
+	{
+		if (n > 0 && m_staged[n - 1].x == m_staged[i].x && m_staged[n - 1].y == m_staged[i].y
+			&& m_staged[n - 1].layer == m_staged[i].layer) {
+			m_staged[n - 1] = m_staged[i];
+		} else {
+			m_staged[n++] = m_staged[i];
+		}
+	}
+	m_staged.resize(n);
+
+	// block compressed pages are rows of 4x4 blocks
+	const size_t rows = PageCodec::IsCompressed(m_format) ? m_page_size / 4 : m_page_size;
+	const size_t row_bytes = m_page_bytes / rows;
+
+	for (size_t begin = 0; begin < n; )
+	{
+		size_t end = begin + 1;
+		while (end < n && m_staged[end].layer == m_staged[begin].layer && m_staged[end].y == m_staged[begin].y
+			&& m_staged[end].x == m_staged[end - 1].x + 1) {
+			++end;
+		}
+
+		const size_t run = end - begin;
+		const uint8_t* pixels = &m_staging[m_staged[begin].pos * m_page_bytes];
+		if (run > 1)
+		{
+			if (m_run.size() < run * m_page_bytes) {
+				m_run.resize(run * m_page_bytes);
+			}
+			for (size_t row = 0; row < rows; ++row) {
+				for (size_t i = 0; i < run; ++i) {
+					memcpy(&m_run[(row * run + i) * row_bytes],
+						&m_staging[m_staged[begin + i].pos * m_page_bytes + row * row_bytes], row_bytes);
+				}
+			}
+			pixels = m_run.data();
+		}
+
+		m_backend.Upload(*m_tex, pixels, m_staged[begin].x * m_page_size, m_staged[begin].y * m_page_size,
+			run * m_page_size, m_page_size, 0, m_staged[begin].layer);
+
+		++m_flush_stats.upload_calls;
+		m_flush_stats.upload_bytes += run * m_page_bytes;
+
+		begin = end;
+	}
+	m_flush_stats.pages = static_cast<int>(n);
+
+	m_staged.clear();
+}
+
+void TextureAtlas::ReserveStaging(int pages)
+{
+	if (m_staging.size() < pages * m_page_bytes) {
+		m_staging.resize(pages * m_page_bytes);
+	}
+	m_staged.reserve(pages);
+}
+
+void TextureAtlas::CreateTexture()
+{
+	m_page_count = m_atlas_size / m_page_size;
+	// page tables address slots with 8 bits
+	assert(m_page_count > 0 && m_page_count <= 256);
+
+	// white, block compressed atlases repeat one encoded white block
+	const size_t block_size = PageCodec::IsCompressed(m_format) ? 4 : 1;
+	const size_t block_bytes = PageCodec::GetPageBytes(m_format, block_size);
+
+	std::vector<uint8_t> white(block_size * block_size * 4, 0xff);
+	std::vector<uint8_t> block(block_bytes);
+	PageCodec::FromRGBA(white.data(), block_size, m_format, block.data());
+
+	// uploaded in strips of page rows, not as one atlas sized buffer
+	const size_t strip_h = std::min(m_page_size, m_atlas_size);
+	const size_t strip_bytes = block_bytes * (m_atlas_size / block_size) * (strip_h / block_size);
+	std::vector<uint8_t> strip(strip_bytes);
+	for (size_t i = 0; i < strip_bytes; i += block_bytes) {
+		memcpy(&strip[i], block.data(), block_bytes);
+	}
+
+	if (m_layers == 1) {
+		m_tex = m_backend.CreateTexture(m_atlas_size, m_atlas_size, m_format, nullptr);
+	} else {
+		m_tex = m_backend.CreateTextureArray(m_atlas_size, m_atlas_size, m_layers, m_format);
+	}
+	for (int layer = 0; layer < m_layers; ++layer) {
+		for (size_t y = 0; y < m_atlas_size; y += strip_h) {
+			m_backend.Upload(*m_tex, strip.data(), 0, y, m_atlas_size, std::min(strip_h, m_atlas_size - y), 0, layer);
+		}
+	}
 }
 
-void TextureAtlas::UploadPage(const uint8_t* pixels, int x, int y)
+void TextureAtlas::EnableShadow()
 {
-    m_tex->Upload(pixels, x * m_page_size, y * m_page_size, m_page_size, m_page_size);
+	if (m_shadow.empty())
+	{
+		m_shadow.assign(m_atlas_size * m_atlas_size * 4 * m_layers, 0xff);
+		m_shadow_page.resize(m_page_size * m_page_size * 4);
+	}
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,372 @@
+#include "vtex/Tiler.h"
+#include "vtex/ImageSource.h"
+#include "vtex/PageFileWriter.h"
+#include "vtex/PageCodec.h"
+
+#include <textile/Page.h>
+#include <textile/PageIndexer.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+
+// queued jobs per thread, bounds the bands kept alive by the queue
+const int JOBS_PER_THREAD = 4;
+
+// texels a level's filter job writes at least, smaller levels are
+// filtered by fewer threads
+const size_t MIN_FILTER_TEXELS = 16384;
+
+int format_channels(vtex::PageFormat fmt)
+{
+	switch (fmt)
+	{
+	case vtex::PageFormat::R8:
+		return 1;
+	case vtex::PageFormat::RG8:
+		return 2;
+	case vtex::PageFormat::RGB8:
+	case vtex::PageFormat::BC1:
+		return 3;
+	default:
+		return 4;
+	}
+}
+
+bool is_pow2(int v)
+{
+	return v > 0 && (v & (v - 1)) == 0;
+}
+
+// 2x2 box filter of two rows, columns [x0, x1) of the smaller row
+void box_filter(const uint8_t* top, const uint8_t* bottom, int x0, int x1, uint8_t* dst)
+{
+	for (int x = x0; x < x1; ++x) {
+		for (int c = 0; c < 4; ++c) {
+			int sum = top[x * 8 + c] + top[x * 8 + 4 + c]
+				    + bottom[x * 8 + c] + bottom[x * 8 + 4 + c];
+			dst[x * 4 + c] = static_cast<uint8_t>((sum + 2) >> 2);
+		}
+	}
+}
+
+}
+
+namespace vtex
+{
+
+Tiler::Tiler(const Config& cfg)
+	: m_cfg(cfg)
+	, m_page_size(cfg.tile_size + cfg.border_size * 2)
+{
+	if (m_cfg.thread_n <= 0) {
+		m_cfg.thread_n = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	}
+	m_cfg.read_rows = std::max(1, m_cfg.read_rows);
+
+	m_failed = false;
+	m_page_n = 0;
+}
+
+bool Tiler::Run(ImageSource& src, const std::string& filepath)
+{
+	const int ts = m_cfg.tile_size;
+	const int w = src.GetWidth();
+	const int h = src.GetHeight();
+	if (ts <= 0 || m_cfg.border_size < 0 || w != h || w % ts != 0 || !is_pow2(w / ts)) {
+		return false;
+	}
+
+	auto info = MakeInfo(w, h, ts, m_cfg.border_size);
+	textile::PageIndexer indexer(info);
+
+	PageFile::Header header;
+	memset(&header, 0, sizeof(header));
+	header.vtex_width  = w;
+	header.vtex_height = h;
+	header.tile_size   = ts;
+	header.border_size = m_cfg.border_size;
+	header.channels    = format_channels(m_cfg.format);
+	header.page_count  = indexer.GetPageCount();
+	header.format      = static_cast<uint32_t>(m_cfg.format);
+
+	PageFileWriter writer(filepath, header);
+	if (!writer.IsValid()) {
+		return false;
+	}
+
+	m_indexer = &indexer;
+	m_writer = &writer;
+	m_failed = false;
+	m_page_n = 0;
+
+	m_levels.clear();
+	for (int size = w; size >= ts; size /= 2)
+	{
+		Level lv;
+		lv.width = lv.height = size;
+		lv.tiles = size / ts;
+		m_levels.push_back(std::move(lv));
+	}
+
+	m_stop = false;
+	for (int i = 0; i < m_cfg.thread_n; ++i) {
+		m_threads.emplace_back(&Tiler::WorkerLoop, this);
+	}
+
+	const size_t row_bytes = static_cast<size_t>(w) * 4;
+	std::vector<uint8_t> chunk(row_bytes * m_cfg.read_rows);
+	for (int y = 0; y < h && !m_failed; y += m_cfg.read_rows)
+	{
+		int n = std::min(m_cfg.read_rows, h - y);
+		if (!src.ReadRows(y, n, chunk.data())) {
+			m_failed = true;
+			break;
+		}
+		std::vector<std::vector<uint8_t>> rows(n);
+		for (int i = 0; i < n; ++i) {
+			rows[i].assign(chunk.begin() + row_bytes * i, chunk.begin() + row_bytes * (i + 1));
+		}
+		AddRows(0, rows);
+	}
+
+	WaitJobs();
+	{
+		std::lock_guard<std::mutex> lock(m_jobs_mtx);
+		m_stop = true;
+	}
+	m_jobs_cv.notify_all();
+	for (auto& t : m_threads) {
+		t.join();
+	}
+	m_threads.clear();
+
+	m_stats.levels = static_cast<int>(m_levels.size());
+	m_stats.pages  = m_page_n;
+	m_stats.bytes  = static_cast<uint64_t>(m_page_n) * writer.GetPageBytes();
+
+	m_levels.clear();
+	m_indexer = nullptr;
+	m_writer = nullptr;
+
+	return writer.Finish() && !m_failed;
+}
+
+textile::VTexInfo Tiler::MakeInfo(int width, int height, int tile_size, int border_size)
+{
+	textile::VTexInfo info;
+	info.vtex_width  = width;
+	info.vtex_height = height;
+	info.tile_size   = tile_size;
+	info.border_size = border_size;
+	return info;
+}
+
+void Tiler::AddRows(int mip, std::vector<std::vector<uint8_t>>& rows)
+{
+	auto& lv = m_levels[mip];
+
+	if (mip + 1 < static_cast<int>(m_levels.size()) && !rows.empty())
+	{
+		// pairs of rows, the first one may pair the last call's odd row
+		std::vector<std::pair<const uint8_t*, const uint8_t*>> pairs;
+		size_t i = 0;
+		if (!lv.half.empty()) {
+			pairs.push_back({ lv.half.data(), rows[0].data() });
+			i = 1;
+		}
+		for (; i + 1 < rows.size(); i += 2) {
+			pairs.push_back({ rows[i].data(), rows[i + 1].data() });
+		}
+
+		// every pair's row is split into the same column ranges
+		const int w = lv.width / 2;
+		std::vector<std::vector<uint8_t>> down(pairs.size(), std::vector<uint8_t>(static_cast<size_t>(w) * 4));
+		const size_t texels = static_cast<size_t>(w) * pairs.size();
+		const int job_n = static_cast<int>(std::max<size_t>(1,
+			std::min<size_t>(m_cfg.thread_n, texels / MIN_FILTER_TEXELS)));
+		ParallelFor(job_n, [&](int job) {
+			const int x0 = w * job / job_n;
+			const int x1 = w * (job + 1) / job_n;
+			for (size_t p = 0; p < pairs.size(); ++p) {
+				box_filter(pairs[p].first, pairs[p].second, x0, x1, down[p].data());
+			}
+		});
+
+		// a row left without a pair waits for the next call
+		if (i < rows.size()) {
+			lv.half = rows[i];
+		} else {
+			lv.half.clear();
+		}
+
+		AddRows(mip + 1, down);
+	}
+
+	const int ts = m_cfg.tile_size;
+	const int b = m_cfg.border_size;
+	for (auto& row : rows)
+	{
+		lv.rows.push_back(std::move(row));
+
+		while (lv.next_band < lv.tiles)
+		{
+			int need = std::min((lv.next_band + 1) * ts + b, lv.height);
+			if (lv.first_row + static_cast<int>(lv.rows.size()) < need) {
+				break;
+			}
+
+			EmitBand(mip);
+
+			// rows the next band's top border still needs stay
+			int keep = lv.next_band * ts - b;
+			while (lv.first_row < keep && !lv.rows.empty()) {
+				lv.rows.pop_front();
+				++lv.first_row;
+			}
+		}
+	}
+}
+
+void Tiler::EmitBand(int mip)
+{
+	auto& lv = m_levels[mip];
+
+	const int ts = m_cfg.tile_size;
+	const int b = m_cfg.border_size;
+	const int ty = lv.next_band++;
+
+	// page_size rows, clamped to the image at the top and bottom, the
+	// columns are clamped while cutting
+	const size_t row_bytes = static_cast<size_t>(lv.width) * 4;
+	auto band = std::make_shared<std::vector<uint8_t>>(row_bytes * m_page_size);
+	for (int r = 0; r < m_page_size; ++r)
+	{
+		int y = std::min(std::max(ty * ts - b + r, 0), lv.height - 1);
+		memcpy(band->data() + row_bytes * r, lv.rows[y - lv.first_row].data(), row_bytes);
+	}
+
+	BandPtr shared = band;
+	const int width = lv.width;
+	for (int tx = 0; tx < lv.tiles; ++tx) {
+		PushJob([this, mip, width, tx, ty, shared]() {
+			WritePage(mip, width, tx, ty, shared);
+		});
+	}
+}
+
+void Tiler::WritePage(int mip, int w, int tx, int ty, const BandPtr& band)
+{
+	const int ts = m_cfg.tile_size;
+	const int b = m_cfg.border_size;
+	const size_t row_bytes = static_cast<size_t>(w) * 4;
+
+	std::vector<uint8_t> rgba(static_cast<size_t>(m_page_size) * m_page_size * 4);
+	for (int r = 0; r < m_page_size; ++r)
+	{
+		const uint8_t* src = band->data() + row_bytes * r;
+		uint8_t* dst = rgba.data() + static_cast<size_t>(m_page_size) * 4 * r;
+
+		int x0 = tx * ts - b;
+		int begin = std::max(0, -x0);
+		int end = std::min(m_page_size, w - x0);
+		for (int c = 0; c < begin; ++c) {
+			memcpy(dst + c * 4, src, 4);
+		}
+		memcpy(dst + begin * 4, src + static_cast<size_t>(x0 + begin) * 4, (end - begin) * 4);
+		for (int c = end; c < m_page_size; ++c) {
+			memcpy(dst + c * 4, src + row_bytes - 4, 4);
+		}
+	}
+
+	std::vector<uint8_t> page(m_writer->GetPageBytes());
+	PageCodec::FromRGBA(rgba.data(), m_page_size, m_cfg.format, page.data());
+
+	int idx = m_indexer->CalcPageIdx(textile::Page(tx, ty, mip));
+	if (m_writer->WritePage(idx, page.data())) {
+		++m_page_n;
+	} else {
+		m_failed = true;
+	}
+}
+
+void Tiler::PushJob(std::function<void()> job)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_jobs_mtx);
+		const size_t max_jobs = static_cast<size_t>(m_cfg.thread_n) * JOBS_PER_THREAD;
+		m_done_cv.wait(lock, [&] { return m_jobs.size() < max_jobs; });
+		m_jobs.push_back(std::move(job));
+	}
+	m_jobs_cv.notify_one();
+}
+
+void Tiler::ParallelFor(int n, const std::function<void(int)>& fn)
+{
+	if (n <= 1)
+	{
+		if (n == 1) {
+			fn(0);
+		}
+		return;
+	}
+
+	// ahead of the queued pages and not bounded, the levels hold up
+	// the reading, the calling thread takes job 0
+	int left = n - 1;
+	{
+		std::lock_guard<std::mutex> lock(m_jobs_mtx);
+		for (int i = n - 1; i > 0; --i)
+		{
+			m_jobs.push_front([this, i, &fn, &left]() {
+				fn(i);
+				std::lock_guard<std::mutex> lock(m_jobs_mtx);
+				--left;
+			});
+		}
+	}
+	m_jobs_cv.notify_all();
+
+	fn(0);
+
+	std::unique_lock<std::mutex> lock(m_jobs_mtx);
+	m_done_cv.wait(lock, [&] { return left == 0; });
+}
+
+void Tiler::WaitJobs()
+{
+	std::unique_lock<std::mutex> lock(m_jobs_mtx);
+	m_done_cv.wait(lock, [this] { return m_jobs.empty() && m_busy == 0; });
+}
+
+void Tiler::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_jobs_mtx);
+			m_jobs_cv.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+			if (m_jobs.empty()) {
+				return;
+			}
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			++m_busy;
+		}
+		m_done_cv.notify_all();
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(m_jobs_mtx);
+			--m_busy;
+		}
+		m_done_cv.notify_all();
+	}
+}
+
+}
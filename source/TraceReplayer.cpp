@@ -0,0 +1,184 @@
+#include "vtex/TraceReplayer.h"
+#include "vtex/RequestTrace.h"
+#include "vtex/RecordingBackend.h"
+#include "vtex/VirtualTexture.h"
+#include "vtex/PageFile.h"
+
+#include <textile/PageIndexer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+
+namespace
+{
+
+const int LATENCY_BUCKETS = 64;
+
+}
+
+namespace vtex
+{
+
+TraceReplayer::TraceReplayer(const Config& cfg)
+	: m_cfg(cfg)
+{
+}
+
+bool TraceReplayer::Run(const RequestTrace& trace, const std::string& vtex_path, Result& result) const
+{
+	result = Result();
+	if (!trace.IsValid()) {
+		return false;
+	}
+
+	textile::VTexInfo info;
+	if (!PageFile::ReadInfo(vtex_path, info)) {
+		return false;
+	}
+	auto& trace_info = trace.GetInfo();
+	if (info.vtex_width != trace_info.vtex_width || info.vtex_height != trace_info.vtex_height ||
+		info.tile_size != trace_info.tile_size) {
+		return false;
+	}
+
+	PageFormat fmt = m_cfg.format;
+	if (m_cfg.file_format)
+	{
+		textile::PageIndexer indexer(info);
+		PageFile file(vtex_path, indexer);
+		if (!file.IsValid()) {
+			return false;
+		}
+		fmt = file.GetPageFormat();
+	}
+
+	// nothing is kept, uploads are only counted
+	auto backend = std::make_shared<RecordingBackend>(false);
+	PagePool::Config pool_cfg;
+	pool_cfg.atlas_size    = m_cfg.atlas_size;
+	pool_cfg.atlas_layers  = m_cfg.atlas_layers;
+	pool_cfg.pinned_levels = m_cfg.pinned_levels;
+	if (m_cfg.uploads_per_frame > 0)
+	{
+		pool_cfg.upload.budget_ms    = 0;
+		pool_cfg.upload.budget_bytes = 0;
+		pool_cfg.upload.min_pages    = m_cfg.uploads_per_frame;
+		pool_cfg.upload.max_pages    = m_cfg.uploads_per_frame;
+	}
+	auto pool = std::make_shared<PagePool>(backend, info.PageSize(), fmt, pool_cfg);
+
+	auto& cache = pool->GetCache();
+	cache.SetPolicy(ReplacementPolicy::Create(m_cfg.policy));
+	result.policy = cache.GetPolicy().GetName();
+
+	// only Replay(), no feedback
+	VirtualTextureConfig vt_cfg;
+	vt_cfg.feedback_size = 0;
+	VirtualTexture vt(vtex_path, info, pool, vt_cfg);
+	const int tex = vt.GetTexID();
+	textile::PageIndexer indexer(info);
+
+	result.latency_hist.resize(LATENCY_BUCKETS, 0);
+
+	// page idx to the frame of its first miss
+	std::unordered_map<int, int> pending;
+
+	RequestSet requests;
+
+	auto start = std::chrono::steady_clock::now();
+
+	auto& frames = trace.GetFrames();
+	for (int f = 0, n = frames.size(); f < n; ++f)
+	{
+		requests.Clear();
+		for (auto& req : frames[f]) {
+			requests.Add(req.page_idx, req.count);
+		}
+		vt.Replay(requests);
+
+		auto& stats = vt.GetTelemetry().GetLast();
+		result.requests += stats.requested;
+		result.hits     += stats.hits;
+		result.misses   += stats.misses;
+		if (stats.misses > 0)
+		{
+			++result.fallback_frames;
+			result.fallback_pages += stats.misses;
+		}
+
+		for (auto& req : frames[f])
+		{
+			auto& page = indexer.QueryPageByIdx(req.page_idx);
+			if (!cache.IsResident(tex, page)) {
+				pending.insert({ req.page_idx, f });
+			}
+		}
+
+		if (m_cfg.wait_loads) {
+			pool->GetPageLoader().WaitIdle();
+		}
+		pool->Update();
+
+		for (auto itr = pending.begin(); itr != pending.end(); )
+		{
+			auto& page = indexer.QueryPageByIdx(itr->first);
+			if (cache.IsResident(tex, page))
+			{
+				int latency = std::min(f - itr->second, LATENCY_BUCKETS - 1);
+				++result.latency_hist[latency];
+				itr = pending.erase(itr);
+			}
+			else if (requests.Get(itr->first) == 0 && !cache.IsLoading(tex, page))
+			{
+				++result.abandoned;
+				itr = pending.erase(itr);
+			}
+			else
+			{
+				++itr;
+			}
+		}
+	}
+
+	std::chrono::duration<double> dt = std::chrono::steady_clock::now() - start;
+	result.frames  = static_cast<int>(frames.size());
+	result.seconds = dt.count();
+
+	auto& totals = vt.GetTelemetry().GetTotals();
+	result.update_ms = result.frames > 0 ? totals.update_ms / result.frames : 0;
+	auto& cache_stats = cache.GetTextureStats(tex);
+	result.loads     = cache_stats.loaded;
+	result.evictions = cache_stats.evicted;
+
+	return true;
+}
+
+/************************************************************************/
+/* struct TraceReplayer::Result                                         */
+/************************************************************************/
+
+int TraceReplayer::Result::LatencyPercentile(float p) const
+{
+	int total = 0;
+	for (int n : latency_hist) {
+		total += n;
+	}
+	if (total == 0) {
+		return 0;
+	}
+
+	const int target = std::max(1, static_cast<int>(std::ceil(p * total)));
+	int sum = 0;
+	for (int i = 0, n = latency_hist.size(); i < n; ++i)
+	{
+		sum += latency_hist[i];
+		if (sum >= target) {
+			return i;
+		}
+	}
+	return static_cast<int>(latency_hist.size()) - 1;
+}
+
+}
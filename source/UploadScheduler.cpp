@@ -0,0 +1,108 @@
+#include "vtex/UploadScheduler.h"
+
+#include <chrono>
+
+namespace vtex
+{
+
+UploadScheduler::UploadScheduler(const Config& cfg, const Clock& clock)
+	: m_cfg(cfg)
+	, m_clock(clock)
+{
+}
+
+void UploadScheduler::BeginFrame()
+{
+	m_frame_start = Now();
+	m_frame_pages = 0;
+	m_frame_bytes = 0;
+	m_frame_ms = 0;
+}
+
+void UploadScheduler::EndFrame(int ready)
+{
+	m_frame_ms = static_cast<float>(Now() - m_frame_start);
+	m_deferred = ready;
+}
+
+bool UploadScheduler::CanUpload(size_t bytes) const
+{
+	if (m_frame_pages < m_cfg.min_pages) {
+		return true;
+	}
+	if (m_frame_pages >= m_cfg.max_pages) {
+		return false;
+	}
+
+	if (m_cfg.budget_bytes > 0 && m_frame_bytes + bytes > m_cfg.budget_bytes) {
+		return false;
+	}
+	if (m_cfg.budget_ms > 0)
+	{
+		// the flush of the pages staged so far comes after the frame's
+		// uploads, it is not in the elapsed time yet
+		double predict = Now() - m_frame_start + m_flush_ms_per_byte * m_frame_bytes
+			+ (m_ms_per_byte + m_flush_ms_per_byte) * bytes;
+		if (predict > m_cfg.budget_ms) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void UploadScheduler::BeginUpload()
+{
+	m_upload_start = Now();
+}
+
+void UploadScheduler::EndUpload(size_t bytes)
+{
+	double ms = Now() - m_upload_start;
+
+	++m_frame_pages;
+	m_frame_bytes += bytes;
+
+	if (bytes > 0)
+	{
+		double ms_per_byte = ms / bytes;
+		if (m_ms_per_byte == 0) {
+			m_ms_per_byte = ms_per_byte;
+		} else {
+			m_ms_per_byte += (ms_per_byte - m_ms_per_byte) * m_cfg.smoothing;
+		}
+	}
+
+	m_avg_upload_ms += (static_cast<float>(ms) - m_avg_upload_ms) * m_cfg.smoothing;
+}
+
+void UploadScheduler::RecordDecode(float ms)
+{
+	m_avg_decode_ms += (ms - m_avg_decode_ms) * m_cfg.smoothing;
+}
+
+void UploadScheduler::RecordFlush(size_t bytes, float ms)
+{
+	if (bytes == 0) {
+		return;
+	}
+
+	double ms_per_byte = ms / bytes;
+	if (m_flush_ms_per_byte == 0) {
+		m_flush_ms_per_byte = ms_per_byte;
+	} else {
+		m_flush_ms_per_byte += (ms_per_byte - m_flush_ms_per_byte) * m_cfg.smoothing;
+	}
+}
+
+double UploadScheduler::Now() const
+{
+	if (m_clock) {
+		return m_clock();
+	}
+
+	std::chrono::duration<double, std::milli> t = std::chrono::steady_clock::now().time_since_epoch();
+	return t.count();
+}
+
+}
@@ -0,0 +1,173 @@
+#include "vtex/UrBackend.h"
+#include "vtex/PageCodec.h"
+
+#include <unirender/Device.h>
+#include <unirender/Context.h>
+#include <unirender/Framebuffer.h>
+#include <unirender/Texture.h>
+#include <unirender/TextureDescription.h>
+#include <painting2/DebugDraw.h>
+
+#include <assert.h>
+
+namespace
+{
+
+ur::TextureFormat texture_format(vtex::PageFormat fmt)
+{
+	switch (fmt)
+	{
+	case vtex::PageFormat::R8:
+		return ur::TextureFormat::RED;
+	case vtex::PageFormat::RG8:
+		return ur::TextureFormat::RG8;
+	case vtex::PageFormat::BC1:
+		return ur::TextureFormat::COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case vtex::PageFormat::BC3:
+		return ur::TextureFormat::COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case vtex::PageFormat::BC7:
+		return ur::TextureFormat::COMPRESSED_RGBA_BPTC_UNORM;
+	default:
+		return ur::TextureFormat::RGBA8;
+	}
+}
+
+}
+
+namespace vtex
+{
+
+UrBackend::UrBackend(const ur::Device& dev)
+	: m_dev(dev)
+{
+}
+
+RenderBackend::TexturePtr
+UrBackend::CreateTexture(int width, int height, PageFormat fmt, const uint8_t* pixels)
+{
+	assert(fmt != PageFormat::RGB8);
+
+    ur::TextureDescription desc;
+    desc.target = ur::TextureTarget::Texture2D;
+    desc.width  = width;
+    desc.height = height;
+    desc.format = texture_format(fmt);
+	return std::make_shared<UrTexture>(width, height, fmt, m_dev.CreateTexture(desc, pixels));
+}
+
+RenderBackend::TexturePtr
+UrBackend::CreateTextureArray(int width, int height, int layers, PageFormat fmt)
+{
+	assert(fmt != PageFormat::RGB8 && layers > 0);
+
+    ur::TextureDescription desc;
+    desc.target = ur::TextureTarget::Texture2DArray;
+    desc.width  = width;
+    desc.height = height;
+    desc.depth  = layers;
+    desc.format = texture_format(fmt);
+	return std::make_shared<UrTexture>(width, height, fmt, m_dev.CreateTexture(desc, nullptr), layers);
+}
+
+void UrBackend::Upload(Texture& tex, const uint8_t* pixels, int x, int y, int w, int h, int level, int layer)
+{
+	auto& ur_tex = static_cast<UrTexture&>(tex).tex;
+	if (tex.layers > 1) {
+		// a sub box one layer deep
+		ur_tex->Upload(pixels, x, y, layer, w, h, 1, level);
+	} else {
+		ur_tex->Upload(pixels, x, y, w, h, level);
+	}
+}
+
+bool UrBackend::Copy(const Texture& src, int sx, int sy, Texture& dst, int dx, int dy, int w, int h,
+	                 int, int dst_layer)
+{
+	assert(src.format == dst.format);
+	if (!m_ctx || PageCodec::IsCompressed(src.format) || src.layers > 1) {
+		return false;
+	}
+
+	if (!m_copy_fbo) {
+		m_copy_fbo = m_dev.CreateFramebuffer();
+	}
+	m_copy_fbo->SetAttachment(ur::AttachmentType::Color0, ur::TextureTarget::Texture2D,
+		static_cast<const UrTexture&>(src).tex, nullptr);
+
+	m_copy_buf.resize(PageCodec::GetPageBytes(src.format, 1) * w * h);
+
+	auto prev_fbo = m_ctx->GetFramebuffer();
+	m_ctx->SetFramebuffer(m_copy_fbo);
+	m_dev.ReadPixels(m_copy_buf.data(), texture_format(src.format), sx, sy, w, h);
+	m_ctx->SetFramebuffer(prev_fbo);
+
+	Upload(dst, m_copy_buf.data(), dx, dy, w, h, 0, dst_layer);
+
+	return true;
+}
+
+RenderBackend::RenderTargetPtr UrBackend::CreateRenderTarget(int width, int height)
+{
+	auto rt = std::make_shared<UrRenderTarget>(width, height);
+
+    ur::TextureDescription desc;
+    desc.target = ur::TextureTarget::Texture2D;
+    desc.width  = width;
+    desc.height = height;
+
+	desc.format = ur::TextureFormat::RGBA8;
+	auto col_tex = m_dev.CreateTexture(desc, nullptr);
+	rt->color = std::make_shared<UrTexture>(width, height, PageFormat::RGBA8, col_tex);
+
+	desc.format = ur::TextureFormat::DEPTH;
+	rt->depth_tex = m_dev.CreateTexture(desc, nullptr);
+
+	rt->fbo = m_dev.CreateFramebuffer();
+	rt->fbo->SetAttachment(ur::AttachmentType::Color0, ur::TextureTarget::Texture2D, col_tex, nullptr);
+	rt->fbo->SetAttachment(ur::AttachmentType::Depth, ur::TextureTarget::Texture2D, rt->depth_tex, nullptr);
+
+	return rt;
+}
+
+void UrBackend::BindRenderTarget(const RenderTarget& rt)
+{
+	assert(m_ctx && !m_prev_fbo);
+	m_prev_fbo = m_ctx->GetFramebuffer();
+	m_ctx->SetFramebuffer(static_cast<const UrRenderTarget&>(rt).fbo);
+}
+
+void UrBackend::UnbindRenderTarget()
+{
+	assert(m_ctx);
+	m_ctx->SetFramebuffer(m_prev_fbo);
+	m_prev_fbo.reset();
+}
+
+void UrBackend::ReadPixels(const RenderTarget* rt, uint8_t* dst, int w, int h)
+{
+	if (!rt)
+	{
+		m_dev.ReadPixels(dst, ur::TextureFormat::RGBA8, 0, 0, w, h);
+		return;
+	}
+
+	assert(m_ctx);
+	auto prev_fbo = m_ctx->GetFramebuffer();
+	m_ctx->SetFramebuffer(static_cast<const UrRenderTarget*>(rt)->fbo);
+	m_dev.ReadPixels(dst, ur::TextureFormat::RGBA8, 0, 0, w, h);
+	m_ctx->SetFramebuffer(prev_fbo);
+}
+
+void UrBackend::DebugDraw(const Texture& tex, int slot)
+{
+	assert(m_ctx);
+	pt2::DebugDraw::Draw(m_dev, *m_ctx, static_cast<const UrTexture&>(tex).tex->GetTexID(), slot);
+}
+
+ur::TexturePtr UrBackend::GetTexture(const Texture& tex)
+{
+	auto ur_tex = dynamic_cast<const UrTexture*>(&tex);
+	return ur_tex ? ur_tex->tex : nullptr;
+}
+
+}
@@ -1,26 +1,75 @@
 #include "vtex/VirtualTexture.h"
 #include "vtex/feedback.frag"
 #include "vtex/final.frag"
+#include "vtex/PageFile.h"
+#include "vtex/MappedPageFile.h"
+#include "vtex/TextilePageSource.h"
+#include "vtex/PageCodec.h"
+#include "vtex/UrBackend.h"
 
 #include <unirender/ShaderProgram.h>
 #include <unirender/Device.h>
 #include <unirender/Context.h>
 #include <unirender/Uniform.h>
-#include <unirender/Texture.h>
 #include <shadertrans/ShaderTrans.h>
-#include <painting2/DebugDraw.h>
-#include <painting3/Blackboard.h>
-#include <painting3/WindowContext.h>
 
 #include <algorithm>
+#include <cmath>
 
 namespace
 {
 
-const int ATLAS_TEX_SIZE = 4096;
-const int UPLOADS_PER_FRAME = 5;
+// textile_channels is 0 without a device to pump textile's loader
+std::unique_ptr<vtex::PageSource>
+create_page_source(const std::string& filepath, const textile::VTexInfo& info,
+                   const textile::PageIndexer& indexer, int textile_channels)
+{
+	auto mapped = std::make_unique<vtex::MappedPageFile>(filepath, indexer);
+	if (mapped->IsValid()) {
+		return mapped;
+	}
+	auto file = std::make_unique<vtex::PageFile>(filepath, indexer);
+	if (file->IsValid() || textile_channels <= 0) {
+		return file;
+	}
+
+	// no PageFile header, the format before it
+	auto textile = std::make_unique<vtex::TextilePageSource>(filepath, indexer, info.PageSize(), textile_channels);
+	if (textile->IsValid()) {
+		return textile;
+	}
+	return file;
+}
+
+// a feedback frame has one page per pixel at most, the analyzer adds
+// their parents, no level has more pages than pixels or than it holds
+int max_request_pages(const textile::VTexInfo& info, int feedback_size)
+{
+	const int pixels = feedback_size * feedback_size;
+
+	int ret = 0;
+	int w = info.PageTableWidth(), h = info.PageTableHeight();
+	while (true)
+	{
+		ret += std::min(pixels, w * h);
+		if (w == 1 && h == 1) {
+			break;
+		}
+		w = std::max(w >> 1, 1);
+		h = std::max(h >> 1, 1);
+	}
+	return ret;
+}
 
-const int MIP_SAMPLE_BIAS = 3;
+vtex::VirtualTextureConfig make_config(int atlas_channel, int feedback_size)
+{
+	vtex::VirtualTextureConfig cfg;
+	cfg.atlas_format = vtex::PageCodec::FromChannels(atlas_channel);
+	cfg.feedback_size = feedback_size;
+	// the files this constructor was written for
+	cfg.textile_channels = atlas_channel;
+	return cfg;
+}
 
 const char* default_vs = R"(
 
@@ -41,6 +90,30 @@ void main()
 
 )";
 
+// default_vs with pixel centers moved to the frame's sample position,
+// when the feedback is subsampled
+const char* feedback_vs = R"(
+
+attribute vec4 position;
+attribute vec3 normal;
+attribute vec2 texcoord;
+
+uniform mat4 u_projection;
+uniform mat4 u_modelview;
+
+uniform vec2 u_feedback_jitter;
+
+varying vec2 v_texcoord;
+
+void main()
+{
+	gl_Position = u_projection * u_modelview * position;
+	gl_Position.xy += u_feedback_jitter * gl_Position.w;
+	v_texcoord = texcoord;
+}
+
+)";
+
 }
 
 namespace vtex
@@ -51,28 +124,125 @@ VirtualTexture::VirtualTexture(const ur::Device& dev,
 	                           const textile::VTexInfo& info,
 	                           int atlas_channel,
 	                           int feedback_size)
-	: m_feedback_size(feedback_size)
+	: VirtualTexture(dev, filepath, info, make_config(atlas_channel, feedback_size))
+{
+}
+
+VirtualTexture::VirtualTexture(const ur::Device& dev,
+                               const std::string& filepath,
+	                           const textile::VTexInfo& info,
+	                           const VirtualTextureConfig& cfg)
+	: VirtualTexture(dev, filepath, info, std::make_shared<PagePool>(std::make_shared<UrBackend>(dev),
+		info.PageSize(), cfg.atlas_format, cfg.pool), cfg)
+{
+	m_own_pool = true;
+}
+
+VirtualTexture::VirtualTexture(const ur::Device& dev,
+                               const std::string& filepath,
+	                           const textile::VTexInfo& info,
+	                           const std::shared_ptr<PagePool>& pool,
+	                           const VirtualTextureConfig& cfg)
+	: VirtualTexture(&dev, filepath, info, pool, cfg)
+{
+}
+
+VirtualTexture::VirtualTexture(const std::string& filepath,
+	                           const textile::VTexInfo& info,
+	                           const std::shared_ptr<PagePool>& pool,
+	                           const VirtualTextureConfig& cfg)
+	: VirtualTexture(nullptr, filepath, info, pool, cfg)
+{
+}
+
+VirtualTexture::VirtualTexture(const ur::Device* dev,
+                               const std::string& filepath,
+	                           const textile::VTexInfo& info,
+	                           const std::shared_ptr<PagePool>& pool,
+	                           const VirtualTextureConfig& cfg)
+	: m_feedback_size(cfg.feedback_size)
 	, m_vtex_w(info.vtex_width)
     , m_vtex_h(info.vtex_height)
 	, m_info(info)
-	, m_atlas(dev, ATLAS_TEX_SIZE, m_info.PageSize(), atlas_channel)
+	, m_pool(pool)
+	, m_own_pool(false)
 	, m_indexer(m_info)
-	, m_loader(filepath, m_indexer)
-	, m_table(dev, m_info.PageTableWidth(), m_info.PageTableHeight())
-	, m_cache(m_atlas, m_loader, m_table, m_indexer)
-	, m_feedback(dev, feedback_size, m_info.PageTableWidth(), m_info.PageTableHeight(), m_indexer)
-	, m_mip_bias(MIP_SAMPLE_BIAS)
+	, m_source(create_page_source(filepath, m_info, m_indexer, dev ? cfg.textile_channels : 0))
+	, m_table(*m_pool->GetBackend(), m_info.PageTableWidth(), m_info.PageTableHeight())
+	, m_feedback(*m_pool->GetBackend(), cfg.feedback_size, m_info.PageTableWidth(), m_info.PageTableHeight(),
+		m_indexer, cfg.feedback_latency, cfg.feedback_subsample)
+	, m_prefetcher(m_indexer, m_info.PageTableWidth(), m_info.PageTableHeight(), cfg.prefetch)
+	, m_load_queue(cfg.load_priority)
+	, m_mip_bias(cfg.mip_bias_control, cfg.mip_bias)
+{
+	assert(m_pool->GetPageSize() == static_cast<size_t>(m_info.PageSize()));
+	// no source can read filepath, see IsValid()
+	assert(m_source->IsValid());
+	m_textile = dynamic_cast<TextilePageSource*>(m_source.get());
+
+	m_tex_id = m_pool->GetCache().Register(m_table, m_indexer, *m_source);
+
+	m_feedback.SetAsync(cfg.feedback_async);
+
+	// pages pending are pages of one feedback frame, so the queue never
+	// grows after this
+	m_load_queue.Reserve(max_request_pages(m_info, cfg.feedback_size));
+
+	if (dev) {
+		InitShaders(*dev);
+	}
+}
+
+VirtualTexture::~VirtualTexture()
 {
-	InitShaders(dev);
+	// its reads wait for Draw(), Unregister() waits for them
+	if (m_textile) {
+		m_textile->Close();
+	}
+	m_pool->GetCache().Unregister(m_tex_id);
+}
+
+void VirtualTexture::Draw(const ur::Device& dev, ur::Context& ctx, const std::function<void()>& draw_cb)
+{
+	auto backend = dynamic_cast<UrBackend*>(m_pool->GetBackend().get());
+	assert(backend && m_final_shader);
+	backend->SetContext(ctx);
+
+	if (m_textile) {
+		m_textile->Update(dev);
+	}
+
+	Stream(draw_cb);
+
+	// the pool's atlas may have been resized
+	if (m_pool->GetAtlas().GetSize() != m_atlas_size) {
+		UpdateAtlasScale();
+	}
+
+	// pass 2
+//	rc.Clear();
+
+//	pt3::EffectsManager::Instance()->SetUserEffect(m_final_shader);
+    ctx.SetTexture(m_final_shader->QueryTexSlot("u_page_table_tex"), UrBackend::GetTexture(*m_table.GetTexture()));
+    ctx.SetTexture(m_final_shader->QueryTexSlot("u_texture_atlas_tex"), UrBackend::GetTexture(*m_pool->GetAtlas().GetTexture()));
+	draw_cb();
+
+	// debug
+	backend->DebugDraw(*m_pool->GetAtlas().GetTexture(), 4);
+	backend->DebugDraw(*m_feedback.GetTexture(), 3);
+	//backend->DebugDraw(*m_table.GetTexture(), 2);
 }
 
-void VirtualTexture::Draw(const ur::Device& dev, ur::Context& ctx, std::function<void()> draw_cb)
+void VirtualTexture::Stream(const std::function<void()>& draw_cb)
 {
 	// pass 1
 
 	//pt3::EffectsManager::Instance()->SetUserEffect(m_feedback_shader);
 
-	m_feedback.BindRT();
+	m_feedback.BindRT(m_frame);
+	if (m_feedback_shader && m_feedback.GetSubsample() > 1) {
+		UpdateFeedbackJitter();
+	}
 
 	//m_feedback_shader->Use();
 
@@ -88,41 +258,133 @@ void VirtualTexture::Draw(const ur::Device& dev, ur::Context& ctx, std::function
 
 	draw_cb();
 
-	m_feedback.Download(dev);
-	Update(dev, m_feedback.GetRequests());
-	m_feedback.Clear();
-
 	m_feedback.UnbindRT();
 
+	m_frame_stats = FrameStats();
+	m_frame_stats.frame = m_frame;
+
+	bool downloaded;
+	{
+		VTEX_SCOPED_TIMER(m_frame_stats.download_ms);
+		downloaded = m_feedback.Download(m_frame);
+	}
+	if (downloaded)
+	{
+		if (m_trace_writer) {
+			m_trace_writer->AddFrame(m_feedback.GetRequests());
+		}
+
+		m_frame_stats.feedback = 1;
+		m_frame_stats.analyze_ms = m_feedback.GetAnalyzeTime();
+		m_frame_stats.readback_bytes = m_feedback.GetReadbackBytes();
+		VTEX_SCOPED_TIMER(m_frame_stats.update_ms);
+		Update(m_feedback.GetRequests(), m_feedback.GetRequestsFrame());
+		m_feedback.Clear();
+	}
+
 //	rc.SetViewport(0, 0, screen_sz.x, screen_sz.y);
 
-	// pass 2
-//	rc.Clear();
+	EndFrame();
+}
 
-//	pt3::EffectsManager::Instance()->SetUserEffect(m_final_shader);
-    ctx.SetTexture(m_final_shader->QueryTexSlot("u_page_table_tex"), m_table.GetTexture());
-    ctx.SetTexture(m_final_shader->QueryTexSlot("u_texture_atlas_tex"), m_atlas.GetTexture());
-	draw_cb();
+void VirtualTexture::Replay(const RequestSet& requests)
+{
+	m_frame_stats = FrameStats();
+	m_frame_stats.frame = m_frame;
+	m_frame_stats.feedback = 1;
 
-	// debug
-	pt2::DebugDraw::Draw(dev, ctx, m_atlas.GetTexture()->GetTexID(), 4);
-	pt2::DebugDraw::Draw(dev, ctx, m_feedback.GetTexture()->GetTexID(), 3);
-	//pt2::DebugDraw::Draw(virt_tex->GetPageTableTexID(), 2);
+	{
+		VTEX_SCOPED_TIMER(m_frame_stats.update_ms);
+		Update(requests, m_frame);
+	}
+
+	EndFrame();
+}
+
+void VirtualTexture::EndFrame()
+{
+	// a shared pool is updated once by its owner, after all textures
+	// have added their requests
+	if (m_own_pool)
+	{
+		VTEX_SCOPED_TIMER(m_frame_stats.pool_ms);
+		m_pool->Update();
+	}
+
+	// with a shared pool these are from its last update, usually the
+	// previous frame
+	auto& cache_stats = m_pool->GetCache().GetTextureStats(m_tex_id);
+	m_frame_stats.loaded  = static_cast<int>(cache_stats.loaded - m_cache_stats.loaded);
+	m_frame_stats.evicted = static_cast<int>(cache_stats.evicted - m_cache_stats.evicted);
+	m_frame_stats.dropped = static_cast<int>(cache_stats.dropped - m_cache_stats.dropped);
+	m_cache_stats = cache_stats;
+
+	auto& table_stats = m_table.GetUpdateStats();
+	m_frame_stats.table_ms      = table_stats.update_ms;
+	m_frame_stats.table_texels  = static_cast<int>(table_stats.texels_written);
+	m_frame_stats.table_uploads = table_stats.upload_calls;
+	m_frame_stats.table_bytes   = table_stats.bytes_uploaded;
+
+	// feedback rendered with an older bias would move it again
+	// before the last change is visible
+	if (m_frame_stats.feedback && m_feedback_frame >= m_mip_bias_frame)
+	{
+		// a texture sharing the pool gets its share of the slots, the
+		// others' requests fill the rest
+		auto& cache = m_pool->GetCache();
+		const int slot_n = cache.GetSlotCount() / std::max(cache.GetTextureCount(), 1);
+		// loads that found no slot are thrash as well
+		const int thrashed = m_frame_stats.evicted + m_frame_stats.dropped;
+		if (m_mip_bias.Update(m_frame_stats.requested, thrashed, slot_n) != 0) {
+			ApplyMipBias();
+		}
+		m_frame_stats.atlas_pressure = m_mip_bias.GetPressure();
+		m_frame_stats.thrash_rate    = m_mip_bias.GetThrash();
+	}
+	m_frame_stats.mip_bias = m_mip_bias.GetBias();
+
+	m_telemetry.Record(m_frame_stats);
+
+	++m_frame;
+}
+
+void VirtualTexture::SetMipBias(int bias)
+{
+	m_mip_bias.SetBias(bias);
+	ApplyMipBias();
+}
+
+void VirtualTexture::SetMipBiasControl(const MipBiasController::Config& cfg)
+{
+	const int bias = m_mip_bias.GetBias();
+	m_mip_bias.SetConfig(cfg);
+	if (m_mip_bias.GetBias() != bias) {
+		ApplyMipBias();
+	}
 }
 
-void VirtualTexture::DecreaseMipBias()
+void VirtualTexture::ApplyMipBias()
 {
-	--m_mip_bias;
-	if (m_mip_bias < 0) {
-		m_mip_bias = 0;
+	m_mip_bias_frame = m_frame + 1;
+	++m_frame_stats.mip_bias_changes;
+
+	// headless
+	if (!m_feedback_shader) {
+		return;
 	}
 
     auto u_mip_sample_bias = m_feedback_shader->QueryUniform("u_mip_sample_bias");
     assert(u_mip_sample_bias);
-    float bias = static_cast<float>(m_mip_bias);
+    float bias = GetFeedbackMipBias();
     u_mip_sample_bias->SetValue(&bias, 1);
 }
 
+float VirtualTexture::GetFeedbackMipBias() const
+{
+	// the smaller target's derivatives are subsample times larger
+	return m_mip_bias.GetBias() + std::log2(static_cast<float>(m_feedback.GetSubsample()));
+}
+
 void VirtualTexture::InitShaders(const ur::Device& dev)
 {
 	//CU_VEC<ur::VertexAttrib> layout;
@@ -142,7 +404,7 @@ void VirtualTexture::InitShaders(const ur::Device& dev)
 	// feedback
 	{
 		std::vector<unsigned int> vs, fs;
-		shadertrans::ShaderTrans::GLSL2SpirV(shadertrans::ShaderStage::VertexShader, default_vs, vs);
+		shadertrans::ShaderTrans::GLSL2SpirV(shadertrans::ShaderStage::VertexShader, feedback_vs, vs);
 		shadertrans::ShaderTrans::GLSL2SpirV(shadertrans::ShaderStage::PixelShader, feedback_frag, fs);
         m_feedback_shader = dev.CreateShaderProgram(vs, fs);
 
@@ -156,7 +418,7 @@ void VirtualTexture::InitShaders(const ur::Device& dev)
 
         auto u_mip_sample_bias = m_feedback_shader->QueryUniform("u_mip_sample_bias");
         assert(u_mip_sample_bias);
-        float bias = static_cast<float>(m_mip_bias);
+        float bias = GetFeedbackMipBias();
         u_mip_sample_bias->SetValue(&bias, 1);
 	}
 	// final
@@ -165,9 +427,15 @@ void VirtualTexture::InitShaders(const ur::Device& dev)
 		//textures.push_back("u_page_table_tex");
 		//textures.push_back("u_texture_atlas_tex");
 
+		// an array atlas is sampled with the layer of the page table
+		std::string final_fs = final_frag;
+		if (m_pool->GetAtlas().GetLayerCount() > 1) {
+			final_fs = "#define ATLAS_ARRAY\n" + final_fs;
+		}
+
 		std::vector<unsigned int> vs, fs;
 		shadertrans::ShaderTrans::GLSL2SpirV(shadertrans::ShaderStage::VertexShader, default_vs, vs);
-		shadertrans::ShaderTrans::GLSL2SpirV(shadertrans::ShaderStage::PixelShader, final_frag, fs);
+		shadertrans::ShaderTrans::GLSL2SpirV(shadertrans::ShaderStage::PixelShader, final_fs.c_str(), fs);
         m_final_shader = dev.CreateShaderProgram(vs, fs);
 
         auto u_page_table_size = m_final_shader->QueryUniform("u_page_table_size");
@@ -178,10 +446,7 @@ void VirtualTexture::InitShaders(const ur::Device& dev)
         assert(u_virt_tex_size);
         u_virt_tex_size->SetValue(vtex_sz, 2);
 
-        auto u_atlas_scale = m_final_shader->QueryUniform("u_atlas_scale");
-        assert(u_atlas_scale);
-        float atlas_scale = static_cast<float>(m_info.PageSize()) / m_atlas.GetSize();
-        u_atlas_scale->SetValue(&atlas_scale, 1);
+        UpdateAtlasScale();
 
 		float page_size = static_cast<float>(m_info.PageSize());
 
@@ -197,50 +462,102 @@ void VirtualTexture::InitShaders(const ur::Device& dev)
 	}
 }
 
-void VirtualTexture::Update(const ur::Device& dev,
-                            const std::vector<int>& requests)
+void VirtualTexture::UpdateFeedbackJitter()
+{
+	// offset of the sample from the center of the target's pixel, in
+	// its pixels, the geometry moves the other way
+	const int n = m_feedback.GetSubsample();
+	const float ndc_per_pixel = 2.0f / m_feedback.GetTargetSize();
+	const float jitter[2] = {
+		-((m_feedback.GetJitterX() + 0.5f) / n - 0.5f) * ndc_per_pixel,
+		-((m_feedback.GetJitterY() + 0.5f) / n - 0.5f) * ndc_per_pixel
+	};
+
+    auto u_feedback_jitter = m_feedback_shader->QueryUniform("u_feedback_jitter");
+    assert(u_feedback_jitter);
+    u_feedback_jitter->SetValue(jitter, 2);
+}
+
+void VirtualTexture::UpdateAtlasScale()
 {
-	m_toload.clear();
+	m_atlas_size = m_pool->GetAtlas().GetSize();
+
+    auto u_atlas_scale = m_final_shader->QueryUniform("u_atlas_scale");
+    assert(u_atlas_scale);
+    float atlas_scale = static_cast<float>(m_info.PageSize()) / m_atlas_size;
+    u_atlas_scale->SetValue(&atlas_scale, 1);
+}
+
+void VirtualTexture::Update(const RequestSet& requests,
+                            uint64_t feedback_frame)
+{
+	auto& cache  = m_pool->GetCache();
+	auto& loader = m_pool->GetPageLoader();
+
+	m_feedback_frame = feedback_frame;
+
+	m_prefetcher.BeginFrame(feedback_frame);
+	m_load_queue.BeginFrame(feedback_frame);
 
 	int touched = 0;
-	for (int i = 0, n = requests.size(); i < n; ++i)
+	int loading = 0;
+	for (auto& req : requests)
 	{
-		if (requests[i] == 0) {
-			continue;
-		}
+		++m_frame_stats.requested;
 
-		auto& page = m_indexer.QueryPageByIdx(i);
-		if (!m_cache.Touch(page)) {
-			m_toload.push_back(PageWithCount(page, requests[i]));
-		} else {
+		auto& page = m_indexer.QueryPageByIdx(req.page_idx);
+		bool resident = cache.Touch(m_tex_id, page, req.count);
+		if (resident) {
 			++touched;
+		} else if (cache.IsLoading(m_tex_id, page)) {
+			++loading;
+		} else {
+			m_load_queue.Push(page, req.page_idx, req.count);
 		}
+		m_prefetcher.AddVisible(page, req.page_idx, req.count, resident);
 	}
-
-	int page_n = m_atlas.GetPageCount();
-	if (touched < page_n * page_n)
+	m_prefetcher.EndFrame();
+	m_load_queue.EndFrame();
+
+	m_frame_stats.hits   = touched;
+	m_frame_stats.misses = m_frame_stats.requested - touched;
+
+	// pages that went out of view before they finished loading, other
+	// textures' loads are left alone, two captures keep the
+	// std::function from allocating
+	loader.CancelIf([this, &requests](uint64_t key) {
+		if (PageCache::KeyTexture(key) != m_tex_id) {
+			return false;
+		}
+		int page_idx = PageCache::KeyPage(key);
+		return requests.Get(page_idx) == 0 && !m_prefetcher.IsPending(page_idx);
+	});
+
+	// the loader's in-flight limit is the throttle here, only as
+	// many pages as it has free slots are picked
+	const int free_n = loader.GetMaxInFlight() - loader.GetInFlightCount();
+	for (auto& page : m_load_queue.Select(free_n))
 	{
-		std::sort(m_toload.begin(), m_toload.end(), [](const PageWithCount& p0, const PageWithCount& p1)->bool {
-			if (p0.page.mip != p1.page.mip) {
-				return p0.page.mip < p1.page.mip;
-			} else {
-				return p0.count > p1.count;
-			}
-		});
-
-		int load_n = std::min((int)m_toload.size(), UPLOADS_PER_FRAME);
-		for (int i = 0; i < load_n; ++i) {
-			m_cache.Request(dev, m_toload[i].page);
+		if (!cache.Request(m_tex_id, page)) {
+			break;
 		}
+		m_load_queue.Remove(m_indexer.CalcPageIdx(page));
+		++m_frame_stats.issued;
 	}
-	else
+	m_frame_stats.deferred = m_frame_stats.misses - m_frame_stats.issued - loading;
+
+	// prefetch only with spare loader capacity, after demand loads
+	const int prefetch_limit = loader.GetMaxInFlight() - loader.GetMaxInFlight() / 2;
+	for (auto& page : m_prefetcher.GetCandidates())
 	{
-		DecreaseMipBias();
+		if (loader.GetInFlightCount() >= prefetch_limit) {
+			break;
+		}
+		if (!cache.IsResident(m_tex_id, page) && cache.Request(m_tex_id, page)) {
+			m_prefetcher.OnIssued(m_indexer.CalcPageIdx(page));
+			++m_frame_stats.prefetched;
+		}
 	}
-
-	m_loader.Update(dev);
-
-	m_table.Update();
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "vtex/VirtualTexture.h"
+#include "vtex/RecordingBackend.h"
+#include "vtex/SoftRenderer.h"
+#include "vtex/ImageSource.h"
+#include "vtex/Tiler.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+// Streams a camera path on a RecordingBackend until the cache is warm,
+// then fails if one more pass over the same path allocates. Covers
+// VirtualTexture::Stream() and PagePool::Update(), the part of Draw()
+// that runs without a device, not Draw()'s shader and unirender calls.
+
+namespace
+{
+
+std::atomic<bool> g_counting(false);
+std::atomic<long> g_allocs(0);
+
+void* counted_alloc(size_t size)
+{
+	if (g_counting.load(std::memory_order_relaxed)) {
+		g_allocs.fetch_add(1, std::memory_order_relaxed);
+	}
+	void* p = malloc(size > 0 ? size : 1);
+	if (!p) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+const int VTEX_SIZE     = 1024;
+const int TILE_SIZE     = 128;
+const int BORDER_SIZE   = 4;
+const int FEEDBACK_SIZE = 256;
+const int PATH_FRAMES   = 40;
+
+class PatternImage : public vtex::ImageSource
+{
+public:
+	virtual int GetWidth() const override { return VTEX_SIZE; }
+	virtual int GetHeight() const override { return VTEX_SIZE; }
+
+	virtual bool ReadRows(int y, int n, uint8_t* dst) override
+	{
+		for (int row = y; row < y + n; ++row) {
+			for (int x = 0; x < VTEX_SIZE; ++x, dst += 4) {
+				dst[0] = static_cast<uint8_t>(x);
+				dst[1] = static_cast<uint8_t>(row);
+				dst[2] = ((x >> 5) + (row >> 5)) & 1 ? 255 : 0;
+				dst[3] = 255;
+			}
+		}
+		return true;
+	}
+
+}; // PatternImage
+
+}
+
+void* operator new(size_t size) { return counted_alloc(size); }
+void* operator new[](size_t size) { return counted_alloc(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+int main(int argc, char* argv[])
+{
+	const std::string filepath = argc > 1 ? argv[1] : "vtex_test_alloc.vtex";
+
+	vtex::Tiler::Config tiler_cfg;
+	tiler_cfg.tile_size   = TILE_SIZE;
+	tiler_cfg.border_size = BORDER_SIZE;
+	tiler_cfg.format      = vtex::PageFormat::RGBA8;
+	PatternImage image;
+	if (!vtex::Tiler(tiler_cfg).Run(image, filepath)) {
+		printf("can't write %s\n", filepath.c_str());
+		return 1;
+	}
+	const auto info = vtex::Tiler::MakeInfo(VTEX_SIZE, VTEX_SIZE, TILE_SIZE, BORDER_SIZE);
+
+	auto backend = std::make_shared<vtex::RecordingBackend>();
+
+	vtex::PagePool::Config pool_cfg;
+	pool_cfg.atlas_size = info.PageSize() * 4;
+	auto pool = std::make_shared<vtex::PagePool>(backend, info.PageSize(), vtex::PageFormat::RGBA8, pool_cfg);
+
+	vtex::VirtualTextureConfig cfg;
+	cfg.feedback_size = FEEDBACK_SIZE;
+	// the recorded feedback is rendered with one bias
+	cfg.mip_bias_control.min_bias = cfg.mip_bias;
+	cfg.mip_bias_control.max_bias = cfg.mip_bias;
+	auto vt = std::make_unique<vtex::VirtualTexture>(filepath, info, pool, cfg);
+
+	// a camera moving over the plane and back, rendered up front
+	vtex::SoftRenderer renderer(1);
+	vtex::UvBuffer uv;
+	uv.Resize(FEEDBACK_SIZE, FEEDBACK_SIZE);
+	auto params = vtex::SoftRenderer::MakeParams(info, pool_cfg.atlas_size, static_cast<float>(cfg.mip_bias));
+	std::vector<std::vector<uint8_t>> feedback(PATH_FRAMES);
+	for (int i = 0; i < PATH_FRAMES; ++i)
+	{
+		const float t = static_cast<float>(i < PATH_FRAMES / 2 ? i : PATH_FRAMES - i);
+		uv.FillPlane(0.1f + 0.04f * t, -0.3f + 0.03f * t, 0.08f, 0.5f, 1.0f);
+		feedback[i].resize(FEEDBACK_SIZE * FEEDBACK_SIZE * 4);
+		renderer.RenderFeedback(uv, params, feedback[i].data());
+	}
+
+	int frame = 0;
+	const uint8_t* curr = nullptr;
+	const std::function<void()> draw = [&]() {
+		backend->DrawPixels(curr, FEEDBACK_SIZE, FEEDBACK_SIZE);
+	};
+	auto run = [&](int n) {
+		for (int i = 0; i < n; ++i, ++frame) {
+			curr = feedback[frame % PATH_FRAMES].data();
+			vt->Stream(draw);
+			pool->Update();
+		}
+	};
+
+	run(PATH_FRAMES * 8);
+
+	g_counting = true;
+	run(PATH_FRAMES * 4);
+	g_counting = false;
+
+	const auto& totals = vt->GetTelemetry().GetTotals();
+	printf("%d frames, %ld allocations, %lld pages loaded, %lld evicted\n", PATH_FRAMES * 4,
+		g_allocs.load(), static_cast<long long>(totals.loaded), static_cast<long long>(totals.evicted));
+
+	vt.reset();
+	pool.reset();
+	std::remove(filepath.c_str());
+
+	return g_allocs.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+#include "vtex/FeedbackAnalyzer.h"
+#include "vtex/RequestSet.h"
+#include "vtex/SoftRenderer.h"
+
+#include <textile/Page.h>
+#include <textile/PageIndexer.h>
+#include <textile/VTexInfo.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// Times FeedbackAnalyzer against the per pixel walk it replaced, which
+// called the indexer for every pixel and every level above it, on
+// synthetic feedback images without a GPU: planes seen by SoftRenderer
+// and noise with no two neighbours alike. Fails if the two disagree on
+// any page or count.
+
+namespace
+{
+
+const int VTEX_SIZE   = 32768;
+const int TILE_SIZE   = 128;
+const int BORDER_SIZE = 4;
+const int SIZE        = 256;
+const int ITERATIONS  = 100;
+
+// the loop of FeedbackBuffer::Download() before the analyzer
+void analyze_per_pixel(const textile::PageIndexer& indexer, int max_mip,
+                       const uint8_t* pixels, size_t pixel_n, std::vector<int>& counts)
+{
+	for (size_t i = 0; i < pixel_n; ++i)
+	{
+		const uint8_t* p = pixels + i * 4;
+		if (p[3] != 255) {
+			continue;
+		}
+		for (int mip = p[2], j = 0; mip <= max_mip; ++mip, ++j) {
+			++counts[indexer.CalcPageIdx(textile::Page(p[0] >> j, p[1] >> j, mip))];
+		}
+	}
+}
+
+// seeded, the same images every run
+uint32_t g_seed = 2463534242u;
+
+uint32_t rand_u32()
+{
+	g_seed ^= g_seed << 13;
+	g_seed ^= g_seed >> 17;
+	g_seed ^= g_seed << 5;
+	return g_seed;
+}
+
+void fill_noise(const textile::VTexInfo& info, int max_mip, std::vector<uint8_t>& pixels)
+{
+	for (size_t i = 0; i < pixels.size(); i += 4)
+	{
+		const int mip = rand_u32() % (max_mip + 1);
+		pixels[i + 0] = static_cast<uint8_t>(rand_u32() % (info.PageTableWidth() >> mip));
+		pixels[i + 1] = static_cast<uint8_t>(rand_u32() % (info.PageTableHeight() >> mip));
+		pixels[i + 2] = static_cast<uint8_t>(mip);
+		// a tenth is background
+		pixels[i + 3] = rand_u32() % 10 == 0 ? 0 : 255;
+	}
+}
+
+double ms_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main()
+{
+	textile::VTexInfo info;
+	info.vtex_width  = VTEX_SIZE;
+	info.vtex_height = VTEX_SIZE;
+	info.tile_size   = TILE_SIZE;
+	info.border_size = BORDER_SIZE;
+	textile::PageIndexer indexer(info);
+
+	const int max_mip = static_cast<int>(std::log2(std::min(info.PageTableWidth(), info.PageTableHeight())));
+	const size_t pixel_n = static_cast<size_t>(SIZE) * SIZE;
+
+	struct Image
+	{
+		const char* name;
+		std::vector<uint8_t> pixels;
+	};
+	std::vector<Image> images;
+
+	vtex::SoftRenderer renderer;
+	vtex::UvBuffer uv;
+	uv.Resize(SIZE, SIZE);
+	// levels of a 2048 pixel wide screen, as the feedback pass biases them
+	auto params = vtex::SoftRenderer::MakeParams(info, 4096, std::log2(2048.0f / SIZE));
+	const float views[][4] = {
+		{ 0.5f, -0.2f, 0.05f, 0.6f },
+		{ 0.3f, -0.1f, 0.01f, 0.3f },
+		{ 0.7f, -0.4f, 0.20f, 0.9f },
+	};
+	const char* names[] = { "plane near", "plane grazing", "plane far" };
+	for (int i = 0; i < 3; ++i)
+	{
+		uv.FillPlane(views[i][0], views[i][1], views[i][2], views[i][3], 1.0f);
+		images.push_back({ names[i], std::vector<uint8_t>(pixel_n * 4) });
+		renderer.RenderFeedback(uv, params, images.back().pixels.data());
+	}
+	images.push_back({ "noise", std::vector<uint8_t>(pixel_n * 4) });
+	fill_noise(info, max_mip, images.back().pixels);
+
+	vtex::FeedbackAnalyzer analyzer(indexer, max_mip);
+	vtex::RequestSet requests;
+	std::vector<int> counts(indexer.GetPageCount());
+
+	printf("%dx%d feedback, %d levels, %d iterations\n", SIZE, SIZE, max_mip + 1, ITERATIONS);
+
+	int failed = 0;
+	for (auto& img : images)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < ITERATIONS; ++i) {
+			std::fill(counts.begin(), counts.end(), 0);
+			analyze_per_pixel(indexer, max_mip, img.pixels.data(), pixel_n, counts);
+		}
+		const double pixel_ms = ms_since(start) / ITERATIONS;
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < ITERATIONS; ++i) {
+			requests.Clear();
+			analyzer.Analyze(img.pixels.data(), pixel_n, requests);
+		}
+		const double analyzer_ms = ms_since(start) / ITERATIONS;
+
+		size_t requested = 0;
+		bool same = true;
+		for (int idx = 0, n = static_cast<int>(counts.size()); idx < n; ++idx)
+		{
+			if (counts[idx] > 0) {
+				++requested;
+			}
+			if (requests.Get(idx) != counts[idx]) {
+				same = false;
+			}
+		}
+		same = same && requests.GetCount() == requested;
+
+		printf("%-14s %6zu unique keys, %5zu pages, per pixel %.3f ms, analyzer %.3f ms, %.1fx\n",
+			img.name, analyzer.GetUniqueCount(), requested, pixel_ms, analyzer_ms, pixel_ms / analyzer_ms);
+		if (!same) {
+			printf("FAILED: %s, the requests differ\n", img.name);
+			++failed;
+		}
+	}
+
+	return failed == 0 ? 0 : 1;
+}
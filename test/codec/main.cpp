@@ -0,0 +1,219 @@
+#include "vtex/BlockCodec.h"
+#include "vtex/PageCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Round trips of random blocks and pages through the CPU codecs, fails
+// if a format's error is above its bound.
+
+namespace
+{
+
+const int BLOCK_N   = 20000;
+const int PAGE_SIZE = 136;
+
+// seeded, the same blocks every run
+uint32_t g_seed = 2463534242u;
+
+uint32_t rand_u32()
+{
+	g_seed ^= g_seed << 13;
+	g_seed ^= g_seed >> 17;
+	g_seed ^= g_seed << 5;
+	return g_seed;
+}
+
+uint8_t clamp_u8(int v)
+{
+	return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// texture like content: a gradient between two random colors across a
+// random direction, with a little noise
+void random_block(uint8_t* rgba, bool opaque)
+{
+	uint8_t c0[4], c1[4];
+	for (int c = 0; c < 4; ++c) {
+		c0[c] = static_cast<uint8_t>(rand_u32());
+		c1[c] = static_cast<uint8_t>(rand_u32());
+	}
+	const float angle = (rand_u32() % 360) * 3.14159265f / 180.0f;
+	const float dx = std::cos(angle), dy = std::sin(angle);
+	for (int y = 0; y < 4; ++y)
+	{
+		for (int x = 0; x < 4; ++x)
+		{
+			const float t = std::min(std::max(((x - 1.5f) * dx + (y - 1.5f) * dy) / 4.2f + 0.5f, 0.0f), 1.0f);
+			uint8_t* texel = rgba + (y * 4 + x) * 4;
+			for (int c = 0; c < 4; ++c) {
+				const int noise = static_cast<int>(rand_u32() % 9) - 4;
+				texel[c] = clamp_u8(static_cast<int>(c0[c] + (c1[c] - c0[c]) * t + 0.5f) + noise);
+			}
+			if (opaque) {
+				texel[3] = 255;
+			}
+		}
+	}
+}
+
+struct Error
+{
+	double sum = 0;
+	size_t n = 0;
+
+	void Add(const uint8_t* a, const uint8_t* b, size_t texel_n, int channels)
+	{
+		for (size_t i = 0; i < texel_n; ++i) {
+			for (int c = 0; c < channels; ++c) {
+				const double d = static_cast<double>(a[i * 4 + c]) - b[i * 4 + c];
+				sum += d * d;
+				++n;
+			}
+		}
+	}
+
+	double Rmse() const { return n > 0 ? std::sqrt(sum / n) : 0.0; }
+};
+
+int g_failed = 0;
+
+void check(bool ok, const char* what)
+{
+	if (!ok) {
+		printf("FAILED: %s\n", what);
+		++g_failed;
+	}
+}
+
+void check_rmse(const char* name, const Error& err, double bound)
+{
+	printf("%-12s rmse %.2f, bound %.1f\n", name, err.Rmse(), bound);
+	check(err.Rmse() <= bound, name);
+}
+
+void test_blocks()
+{
+	uint8_t rgba[64], decoded[64], block[16];
+
+	Error bc1, bc3, bc7;
+	int bc7_failed = 0;
+	for (int i = 0; i < BLOCK_N; ++i)
+	{
+		random_block(rgba, true);
+		vtex::BlockCodec::EncodeBC1(rgba, block);
+		vtex::BlockCodec::DecodeBC1(block, decoded);
+		bc1.Add(rgba, decoded, 16, 3);
+
+		random_block(rgba, false);
+		vtex::BlockCodec::EncodeBC3(rgba, block);
+		vtex::BlockCodec::DecodeBC3(block, decoded);
+		bc3.Add(rgba, decoded, 16, 4);
+
+		vtex::BlockCodec::EncodeBC7(rgba, block);
+		if (vtex::BlockCodec::DecodeBC7(block, decoded)) {
+			bc7.Add(rgba, decoded, 16, 4);
+		} else {
+			++bc7_failed;
+		}
+	}
+
+	check_rmse("bc1 block", bc1, 10.0);
+	check_rmse("bc3 block", bc3, 9.0);
+	check_rmse("bc7 block", bc7, 4.5);
+	check(bc7_failed == 0, "bc7 decodes every encoded block");
+
+	// the mode is the lowest set bit of the first byte, only 6 is decoded
+	for (int mode = 0; mode < 8; ++mode)
+	{
+		memset(block, 0, sizeof(block));
+		block[0] = static_cast<uint8_t>(1 << mode);
+		const bool decoded_mode = vtex::BlockCodec::DecodeBC7(block, decoded);
+		check(decoded_mode == (mode == 6), "bc7 decodes mode 6 only");
+	}
+	memset(block, 0, sizeof(block));
+	check(!vtex::BlockCodec::DecodeBC7(block, decoded), "bc7 rejects the reserved mode");
+}
+
+void test_pages()
+{
+	const size_t texel_n = PAGE_SIZE * PAGE_SIZE;
+
+	std::vector<uint8_t> page(texel_n * 4), opaque(texel_n * 4);
+	uint8_t block[64];
+	for (int by = 0; by < PAGE_SIZE / 4; ++by)
+	{
+		for (int bx = 0; bx < PAGE_SIZE / 4; ++bx)
+		{
+			random_block(block, false);
+			for (int row = 0; row < 4; ++row) {
+				memcpy(&page[((by * 4 + row) * PAGE_SIZE + bx * 4) * 4], block + row * 16, 16);
+			}
+		}
+	}
+	for (size_t i = 0; i < texel_n; ++i) {
+		memcpy(&opaque[i * 4], &page[i * 4], 3);
+		opaque[i * 4 + 3] = 255;
+	}
+
+	std::vector<uint8_t> encoded(texel_n * 4), decoded(texel_n * 4), tmp(texel_n * 4);
+
+	// raw formats keep their channels exactly
+	struct Raw { vtex::PageFormat fmt; int channels; const char* name; };
+	const Raw RAWS[] = {
+		{ vtex::PageFormat::R8,    1, "r8 page" },
+		{ vtex::PageFormat::RG8,   2, "rg8 page" },
+		{ vtex::PageFormat::RGBA8, 4, "rgba8 page" },
+	};
+	for (auto& raw : RAWS)
+	{
+		check(vtex::PageCodec::FromRGBA(page.data(), PAGE_SIZE, raw.fmt, encoded.data()), raw.name);
+		check(vtex::PageCodec::ToRGBA(encoded.data(), raw.fmt, PAGE_SIZE, decoded.data()), raw.name);
+		Error err;
+		err.Add(page.data(), decoded.data(), texel_n, raw.channels);
+		check_rmse(raw.name, err, 0.0);
+	}
+
+	// block compressed pages, bounds as for single blocks
+	struct Compressed { vtex::PageFormat fmt; const std::vector<uint8_t>* src; int channels; double bound; const char* name; };
+	const Compressed COMPRESSED[] = {
+		{ vtex::PageFormat::BC1, &opaque, 3, 10.0, "bc1 page" },
+		{ vtex::PageFormat::BC3, &page,   4, 9.0,  "bc3 page" },
+		{ vtex::PageFormat::BC7, &page,   4, 4.5,  "bc7 page" },
+	};
+	for (auto& c : COMPRESSED)
+	{
+		check(vtex::PageCodec::FromRGBA(c.src->data(), PAGE_SIZE, c.fmt, encoded.data()), c.name);
+		check(vtex::PageCodec::ToRGBA(encoded.data(), c.fmt, PAGE_SIZE, decoded.data()), c.name);
+		Error err;
+		err.Add(c.src->data(), decoded.data(), texel_n, c.channels);
+		check_rmse(c.name, err, c.bound);
+	}
+
+	// what the loader threads do, BC7 to BC1 through RGBA8
+	std::vector<uint8_t> bc7(vtex::PageCodec::GetPageBytes(vtex::PageFormat::BC7, PAGE_SIZE));
+	check(vtex::PageCodec::FromRGBA(opaque.data(), PAGE_SIZE, vtex::PageFormat::BC7, bc7.data()), "bc7 to bc1");
+	check(vtex::PageCodec::Transcode(bc7.data(), vtex::PageFormat::BC7, encoded.data(),
+		vtex::PageFormat::BC1, PAGE_SIZE, tmp.data()), "bc7 to bc1");
+	check(vtex::PageCodec::ToRGBA(encoded.data(), vtex::PageFormat::BC1, PAGE_SIZE, decoded.data()), "bc7 to bc1");
+	Error err;
+	err.Add(opaque.data(), decoded.data(), texel_n, 3);
+	check_rmse("bc7 to bc1", err, 10.5);
+}
+
+}
+
+int main()
+{
+	test_blocks();
+	test_pages();
+
+	if (g_failed > 0) {
+		printf("%d checks failed\n", g_failed);
+		return 1;
+	}
+	return 0;
+}
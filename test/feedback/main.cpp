@@ -0,0 +1,228 @@
+#include "vtex/FeedbackBuffer.h"
+#include "vtex/FeedbackWorker.h"
+#include "vtex/FeedbackAnalyzer.h"
+#include "vtex/RecordingBackend.h"
+#include "vtex/SoftRenderer.h"
+
+#include <textile/PageIndexer.h>
+#include <textile/VTexInfo.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Subsampled feedback: after a view change the requests have to match
+// the full image's within n * n frames, with 1 / n^2 of its readback,
+// and the async worker has to merge every jitter position even when
+// the render thread submits faster than it analyzes.
+
+namespace
+{
+
+const int VTEX_SIZE   = 8192;
+const int TILE_SIZE   = 128;
+const int BORDER_SIZE = 4;
+const int SIZE        = 256;
+const int FRAMES      = 40;
+
+int g_failed = 0;
+
+void check(bool ok, const char* what, int n)
+{
+	if (!ok) {
+		printf("FAILED: %s, subsample %d\n", what, n);
+		++g_failed;
+	}
+}
+
+bool same_requests(const vtex::RequestSet& a, const vtex::RequestSet& b)
+{
+	if (a.GetCount() != b.GetCount()) {
+		return false;
+	}
+	for (auto& req : a) {
+		if (b.Get(req.page_idx) != req.count) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// the same pages, counts differ with the sample density
+bool same_pages(const vtex::RequestSet& a, const vtex::RequestSet& b)
+{
+	if (a.GetCount() != b.GetCount()) {
+		return false;
+	}
+	for (auto& req : a) {
+		if (b.Get(req.page_idx) == 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+class Scene
+{
+public:
+	explicit Scene(const textile::VTexInfo& info)
+		: m_info(info)
+		, m_renderer(1)
+	{
+		m_uv.Resize(SIZE, SIZE);
+	}
+
+	void SetView(int view)
+	{
+		if (view == 0) {
+			m_uv.FillPlane(0.5f, -0.2f, 0.05f, 0.6f, 1.0f);
+		} else {
+			m_uv.FillPlane(0.3f, -0.1f, 0.04f, 0.7f, 1.0f);
+		}
+	}
+
+	void Render(int n, int jitter_x, int jitter_y, uint8_t* dst)
+	{
+		auto params = vtex::SoftRenderer::MakeParams(m_info, 1024, std::log2(static_cast<float>(n)));
+		params.subsample = n;
+		params.jitter[0] = jitter_x;
+		params.jitter[1] = jitter_y;
+		m_renderer.RenderFeedback(m_uv, params, dst);
+	}
+
+private:
+	const textile::VTexInfo& m_info;
+
+	vtex::SoftRenderer m_renderer;
+	vtex::UvBuffer m_uv;
+
+}; // Scene
+
+// frames after a view change until the requests are the full image's
+void test_convergence(const textile::VTexInfo& info, const textile::PageIndexer& indexer, int n)
+{
+	Scene scene(info);
+	vtex::RecordingBackend backend;
+
+	// what the full image requests
+	vtex::FeedbackBuffer full(backend, SIZE, info.PageTableWidth(), info.PageTableHeight(), indexer);
+	std::vector<uint8_t> full_pixels(SIZE * SIZE * 4);
+	vtex::RequestSet ref;
+	auto render_ref = [&]() {
+		scene.Render(1, 0, 0, full_pixels.data());
+		full.BindRT(0);
+		backend.DrawPixels(full_pixels.data(), SIZE, SIZE);
+		full.UnbindRT();
+		full.Download(0);
+		ref.Clear();
+		for (auto& req : full.GetRequests()) {
+			ref.Add(req.page_idx, req.count);
+		}
+		full.Clear();
+	};
+
+	vtex::FeedbackBuffer fb(backend, SIZE, info.PageTableWidth(), info.PageTableHeight(), indexer, 0, n);
+	const int target = fb.GetTargetSize();
+	std::vector<uint8_t> pixels(target * target * 4);
+
+	size_t readback = 0;
+	float analyze_ms = 0;
+	int converged = -1;
+	for (int frame = 0; frame < FRAMES; ++frame)
+	{
+		if (frame == 0 || frame == FRAMES / 2)
+		{
+			scene.SetView(frame == 0 ? 0 : 1);
+			render_ref();
+			converged = -1;
+		}
+
+		fb.BindRT(frame);
+		scene.Render(n, fb.GetJitterX(), fb.GetJitterY(), pixels.data());
+		backend.DrawPixels(pixels.data(), target, target);
+		fb.UnbindRT();
+		fb.Download(frame);
+
+		readback += fb.GetReadbackBytes();
+		analyze_ms += fb.GetAnalyzeTime();
+		if (converged < 0 && same_pages(fb.GetRequests(), ref)) {
+			converged = frame - (frame < FRAMES / 2 ? 0 : FRAMES / 2) + 1;
+		}
+		fb.Clear();
+
+		if (frame == FRAMES / 2 - 1 || frame == FRAMES - 1) {
+			check(converged > 0 && converged <= n * n, "requests converge within n * n frames", n);
+		}
+	}
+
+	printf("subsample %d: converged in %d frames, readback %zu bytes/frame, analyze %.3f ms/frame\n",
+		n, converged, readback / FRAMES, analyze_ms / FRAMES);
+	check(readback / FRAMES == static_cast<size_t>(SIZE * SIZE * 4 / (n * n)), "readback is 1 / n^2", n);
+}
+
+// submits back to back without waiting, the result has to be the one of
+// analyzing the last n * n frames in order
+void test_worker_history(const textile::VTexInfo& info, const textile::PageIndexer& indexer, int n)
+{
+	Scene scene(info);
+	scene.SetView(0);
+
+	const int max_mip = static_cast<int>(std::log2(std::min(info.PageTableWidth(), info.PageTableHeight())));
+	const int target = SIZE / n;
+	const size_t pixel_n = static_cast<size_t>(target) * target;
+	const int history = n * n;
+	const int submit_n = history * 2 + 1;
+
+	std::vector<std::vector<uint8_t>> frames(submit_n);
+	for (int i = 0; i < submit_n; ++i) {
+		frames[i].resize(pixel_n * 4);
+		scene.Render(n, i % n, (i / n) % n, frames[i].data());
+	}
+
+	vtex::FeedbackWorker worker(indexer, max_mip, pixel_n, history);
+	for (int i = 0; i < submit_n; ++i) {
+		memcpy(worker.GetPixels(), frames[i].data(), pixel_n * 4);
+		worker.Submit(i);
+	}
+	worker.WaitIdle();
+	check(worker.Poll(), "worker publishes", n);
+	check(worker.GetResult().frame == static_cast<uint64_t>(submit_n - 1), "worker ends at the last submit", n);
+
+	vtex::FeedbackAnalyzer analyzer(indexer, max_mip);
+	analyzer.SetHistory(history);
+	vtex::RequestSet expected;
+	for (int i = submit_n - history; i < submit_n; ++i) {
+		expected.Clear();
+		analyzer.Analyze(frames[i].data(), pixel_n, expected);
+	}
+	check(same_requests(worker.GetResult().requests, expected), "worker merges the last n * n submits", n);
+
+	printf("subsample %d: %d submits, %d dropped by the worker\n", n, submit_n, worker.GetDropCount());
+}
+
+}
+
+int main()
+{
+	textile::VTexInfo info;
+	info.vtex_width  = VTEX_SIZE;
+	info.vtex_height = VTEX_SIZE;
+	info.tile_size   = TILE_SIZE;
+	info.border_size = BORDER_SIZE;
+	textile::PageIndexer indexer(info);
+
+	for (int n : { 1, 2, 4 }) {
+		test_convergence(info, indexer, n);
+	}
+	for (int n : { 2, 4 }) {
+		test_worker_history(info, indexer, n);
+	}
+
+	if (g_failed > 0) {
+		printf("%d checks failed\n", g_failed);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,174 @@
+#include "vtex/MappedPageFile.h"
+#include "vtex/PageFile.h"
+#include "vtex/ImageSource.h"
+#include "vtex/Tiler.h"
+
+#include <textile/Page.h>
+#include <textile/PageIndexer.h>
+#include <textile/VTexInfo.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Pages per second read through PageFile into a buffer and through
+// MappedPageFile, in file order and in random order, from a file the
+// Tiler writes. The file was just written, so both read from the OS
+// cache: this is the cost of the read call and the copy, not of the
+// disk. Fails if the two disagree on any page's bytes.
+
+namespace
+{
+
+const int VTEX_SIZE   = 8192;
+const int TILE_SIZE   = 128;
+const int BORDER_SIZE = 4;
+const int PASSES      = 4;
+
+// every texel differs from its neighbours, a page read from the wrong
+// offset is seen
+class PatternImage : public vtex::ImageSource
+{
+public:
+	virtual int GetWidth() const override { return VTEX_SIZE; }
+	virtual int GetHeight() const override { return VTEX_SIZE; }
+
+	virtual bool ReadRows(int y, int n, uint8_t* dst) override
+	{
+		for (int row = y; row < y + n; ++row) {
+			for (int x = 0; x < VTEX_SIZE; ++x, dst += 4) {
+				dst[0] = static_cast<uint8_t>(x);
+				dst[1] = static_cast<uint8_t>(row);
+				dst[2] = static_cast<uint8_t>((x >> 8) ^ (row >> 8));
+				dst[3] = 255;
+			}
+		}
+		return true;
+	}
+
+}; // PatternImage
+
+// seeded, the same order every run
+uint32_t g_seed = 2463534242u;
+
+uint32_t rand_u32()
+{
+	g_seed ^= g_seed << 13;
+	g_seed ^= g_seed >> 17;
+	g_seed ^= g_seed << 5;
+	return g_seed;
+}
+
+double ms_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// sums the bytes so the mapped reads can't be skipped
+uint32_t checksum(const uint8_t* data, size_t size)
+{
+	uint32_t sum = 0;
+	for (size_t i = 0; i < size; i += 64) {
+		sum += data[i];
+	}
+	return sum;
+}
+
+void print_rate(const char* name, const char* order, size_t pages, size_t page_bytes, double ms)
+{
+	const double sec = ms / 1000.0;
+	printf("%-9s %-6s %9.0f pages/s %8.1f MB/s\n", name, order,
+		pages / sec, pages * page_bytes / sec / (1024.0 * 1024.0));
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string filepath = argc > 1 ? argv[1] : "vtex_test_mmap.vtex";
+
+	vtex::Tiler::Config tiler_cfg;
+	tiler_cfg.tile_size   = TILE_SIZE;
+	tiler_cfg.border_size = BORDER_SIZE;
+	tiler_cfg.format      = vtex::PageFormat::RGBA8;
+	PatternImage image;
+	if (!vtex::Tiler(tiler_cfg).Run(image, filepath)) {
+		printf("can't write %s\n", filepath.c_str());
+		return 1;
+	}
+	const auto info = vtex::Tiler::MakeInfo(VTEX_SIZE, VTEX_SIZE, TILE_SIZE, BORDER_SIZE);
+	textile::PageIndexer indexer(info);
+
+	int failed = 0;
+	{
+		vtex::PageFile file(filepath, indexer);
+		vtex::MappedPageFile mapped(filepath, indexer);
+		if (!file.IsValid() || !mapped.IsValid()) {
+			printf("can't open %s\n", filepath.c_str());
+			return 1;
+		}
+
+		const size_t page_bytes = file.GetPageBytes();
+		std::vector<uint8_t> buf(page_bytes), mapped_buf(page_bytes);
+
+		std::vector<textile::Page> in_order, shuffled;
+		for (int i = 0, n = indexer.GetPageCount(); i < n; ++i) {
+			in_order.push_back(indexer.QueryPageByIdx(i));
+		}
+		shuffled = in_order;
+		for (size_t i = shuffled.size() - 1; i > 0; --i) {
+			std::swap(shuffled[i], shuffled[rand_u32() % (i + 1)]);
+		}
+
+		int mismatch = 0;
+		for (auto& page : in_order)
+		{
+			auto src = mapped.MapPage(page);
+			if (!file.ReadPage(page, buf.data()) || !mapped.ReadPage(page, mapped_buf.data()) || !src
+			 || memcmp(buf.data(), src, page_bytes) != 0 || memcmp(buf.data(), mapped_buf.data(), page_bytes) != 0) {
+				++mismatch;
+			}
+		}
+		if (mismatch > 0) {
+			printf("FAILED: %d pages differ\n", mismatch);
+			++failed;
+		}
+
+		printf("%zu pages of %zu bytes, %d passes\n", in_order.size(), page_bytes, PASSES);
+
+		uint32_t sum = 0;
+		for (auto order : { &in_order, &shuffled })
+		{
+			const char* order_name = order == &in_order ? "file" : "random";
+			const size_t pages = order->size() * PASSES;
+
+			auto start = std::chrono::steady_clock::now();
+			for (int pass = 0; pass < PASSES; ++pass) {
+				for (auto& page : *order) {
+					file.ReadPage(page, buf.data());
+					sum += checksum(buf.data(), page_bytes);
+				}
+			}
+			print_rate("buffered", order_name, pages, page_bytes, ms_since(start));
+
+			start = std::chrono::steady_clock::now();
+			for (int pass = 0; pass < PASSES; ++pass) {
+				for (auto& page : *order) {
+					sum += checksum(mapped.MapPage(page), page_bytes);
+				}
+			}
+			print_rate("mapped", order_name, pages, page_bytes, ms_since(start));
+		}
+		// keeps the sums alive
+		if (sum == 1) {
+			printf("\n");
+		}
+	}
+
+	std::remove(filepath.c_str());
+
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,446 @@
+#include "vtex/PageTable.h"
+#include "vtex/RecordingBackend.h"
+
+#include <textile/Page.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <assert.h>
+
+// Runs the same page swaps on PageTable and on the pointer quadtree it
+// replaced, fails if their levels differ after any frame, prints the
+// time of both. Residency is kept closed under parents, the one case
+// where the two agree byte for byte.
+
+namespace
+{
+
+const int TABLE_SIZE  = 64;
+const int SLOT_N      = 256;
+const int FRAMES      = 2000;
+const int SWAPS       = 32;
+
+// the PageTable before it was flattened, AddPage() allocates nodes,
+// Update() rewrites and uploads every level
+class QuadTreeTable : private boost::noncopyable
+{
+public:
+	QuadTreeTable(vtex::RenderBackend& backend, int width, int height);
+
+	void AddPage(const textile::Page& page, int mapping_x, int mapping_y);
+	void RemovePage(const textile::Page& page);
+
+	void Update();
+
+	const uint8_t* GetLevelData(int level) const { return m_data[level].data.data(); }
+
+private:
+	struct Image
+	{
+		int w = 0, h = 0;
+		std::vector<uint8_t> data;
+	};
+
+	struct Rect
+	{
+		Rect(int x, int y, int w, int h)
+			: x(x), y(y), w(w), h(h) {}
+
+		bool Contain(int px, int py) const {
+			return px >= x && px < x + w
+				&& py >= y && py < y + h;
+		}
+
+		int x, y;
+		int w, h;
+	};
+
+	struct QuadNode : private boost::noncopyable
+	{
+		QuadNode(int level, const Rect& rect);
+
+		Rect CalcChildRect(int idx) const;
+
+		void Write(int w, uint8_t* data, int mip_level);
+
+		int level;
+		Rect rect;
+
+		int mapping_x, mapping_y;
+
+		std::unique_ptr<QuadNode> children[4];
+
+	}; // QuadNode
+
+private:
+	QuadNode* FindPage(const textile::Page& page, int& index) const;
+
+	size_t CalcMaxLevel() const;
+
+private:
+	vtex::RenderBackend& m_backend;
+
+	int m_width, m_height;
+
+	std::unique_ptr<QuadNode> m_root;
+
+	std::vector<Image> m_data;
+
+	vtex::RenderBackend::TexturePtr m_tex = nullptr;
+
+}; // QuadTreeTable
+
+QuadTreeTable::QuadTreeTable(vtex::RenderBackend& backend, int width, int height)
+	: m_backend(backend)
+	, m_width(width)
+	, m_height(height)
+{
+	const auto level = CalcMaxLevel();
+	m_root = std::make_unique<QuadNode>(static_cast<int>(level), Rect(0, 0, m_width, m_height));
+
+	m_data.resize(level + 1);
+	for (size_t i = 0; i < level + 1; ++i)
+	{
+		auto& data = m_data[i];
+		data.w = width >> i;
+		data.h = height >> i;
+		data.data.resize(data.w * data.h * 4, 0);
+	}
+
+	m_tex = m_backend.CreateTexture(m_width, m_height, vtex::PageFormat::RGBA8, nullptr);
+}
+
+void QuadTreeTable::AddPage(const textile::Page& page, int mapping_x, int mapping_y)
+{
+	int scale = 1 << page.mip;
+	int x = page.x * scale;
+	int y = page.y * scale;
+
+	QuadNode* node = m_root.get();
+	while (page.mip < node->level)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			Rect cr = node->CalcChildRect(i);
+			if (!cr.Contain(x, y)) {
+				continue;
+			}
+			if (node->children[i] == nullptr) {
+				node->children[i] = std::make_unique<QuadNode>(node->level - 1, cr);
+			}
+			node = node->children[i].get();
+			break;
+		}
+	}
+
+	node->mapping_x = mapping_x;
+	node->mapping_y = mapping_y;
+}
+
+void QuadTreeTable::RemovePage(const textile::Page& page)
+{
+	int index;
+	auto node = FindPage(page, index);
+	if (node != nullptr) {
+		node->children[index] = nullptr;
+	}
+}
+
+void QuadTreeTable::Update()
+{
+	const auto level = CalcMaxLevel();
+	for (size_t i = 0; i < level + 1; ++i)
+	{
+		auto& img = m_data[i];
+		m_root->Write(img.w, img.data.data(), static_cast<int>(i));
+		m_backend.Upload(*m_tex, img.data.data(), 0, 0, img.w, img.h, static_cast<int>(i));
+	}
+}
+
+QuadTreeTable::QuadNode* QuadTreeTable::FindPage(const textile::Page& page, int& index) const
+{
+	QuadNode* node = m_root.get();
+
+	int scale = 1 << page.mip;
+	int x = page.x * scale;
+	int y = page.y * scale;
+
+	bool exitloop = false;
+	while (!exitloop)
+	{
+		exitloop = true;
+		for (int i = 0; i < 4; ++i)
+		{
+			if (node->children[i] != nullptr && node->children[i]->rect.Contain(x, y))
+			{
+				if (page.mip == node->level - 1)
+				{
+					index = i;
+					return node;
+				}
+				else
+				{
+					node = node->children[i].get();
+					exitloop = false;
+				}
+			}
+		}
+	}
+
+	index = -1;
+	return nullptr;
+}
+
+size_t QuadTreeTable::CalcMaxLevel() const
+{
+	return static_cast<size_t>(std::min(std::log2(m_width), std::log2(m_height)));
+}
+
+QuadTreeTable::QuadNode::QuadNode(int level, const Rect& rect)
+	: level(level)
+	, rect(rect)
+	, mapping_x(0)
+	, mapping_y(0)
+{
+}
+
+QuadTreeTable::Rect QuadTreeTable::QuadNode::CalcChildRect(int idx) const
+{
+	int x = rect.x;
+	int y = rect.y;
+	int w = rect.w / 2;
+	int h = rect.h / 2;
+
+	switch (idx)
+	{
+	case 0:
+		return Rect(x, y, w, h);
+	case 1:
+		return Rect(x + w, y, w, h);
+	case 2:
+		return Rect(x + w, y + h, w, h);
+	case 3:
+		return Rect(x, y + h, w, h);
+	default:
+		assert(0);
+		return rect;
+	}
+}
+
+void QuadTreeTable::QuadNode::Write(int w, uint8_t* data, int mip_level)
+{
+	if (level < mip_level) {
+		return;
+	}
+
+	int rx = rect.x >> mip_level;
+	int ry = rect.y >> mip_level;
+	int rw = rect.w >> mip_level;
+	int rh = rect.h >> mip_level;
+	for (int y = ry; y < ry + rh; ++y) {
+		for (int x = rx; x < rx + rw; ++x) {
+			int ptr = (y * w + x) * 4;
+			data[ptr + 0] = mapping_x;
+			data[ptr + 1] = mapping_y;
+			data[ptr + 2] = level;
+			// the atlas layer, the quadtree knew only one
+			data[ptr + 3] = 0;
+		}
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		if (children[i] != nullptr) {
+			children[i]->Write(w, data, mip_level);
+		}
+	}
+}
+
+// seeded, the same swaps every run
+uint32_t g_seed = 2463534242u;
+
+uint32_t rand_u32()
+{
+	g_seed ^= g_seed << 13;
+	g_seed ^= g_seed >> 17;
+	g_seed ^= g_seed << 5;
+	return g_seed;
+}
+
+// which pages are resident, a page is only added under a resident
+// parent and only removed without resident children
+class Residency
+{
+public:
+	explicit Residency(int size)
+		: m_max_mip(static_cast<int>(std::log2(size)))
+	{
+		int n = 0;
+		for (int mip = 0; mip <= m_max_mip; ++mip) {
+			m_offsets.push_back(n);
+			n += (size >> mip) * (size >> mip);
+		}
+		m_children.resize(n, 0);
+		m_resident.resize(n, false);
+		m_size = size;
+	}
+
+	bool IsResident(const textile::Page& p) const { return m_resident[Index(p)]; }
+
+	bool CanAdd(const textile::Page& p) const {
+		return !IsResident(p) && IsResident(textile::Page(p.x / 2, p.y / 2, p.mip + 1));
+	}
+	bool CanRemove(const textile::Page& p) const {
+		return p.mip < m_max_mip && IsResident(p) && m_children[Index(p)] == 0;
+	}
+
+	void Set(const textile::Page& p, bool resident)
+	{
+		m_resident[Index(p)] = resident;
+		if (p.mip < m_max_mip) {
+			m_children[Index(textile::Page(p.x / 2, p.y / 2, p.mip + 1))] += resident ? 1 : -1;
+		}
+	}
+
+	textile::Page RandomPage() const
+	{
+		const int mip = rand_u32() % (m_max_mip + 1);
+		const int n = m_size >> mip;
+		return textile::Page(rand_u32() % n, rand_u32() % n, mip);
+	}
+
+	int GetMaxMip() const { return m_max_mip; }
+
+private:
+	int Index(const textile::Page& p) const {
+		return m_offsets[p.mip] + p.y * (m_size >> p.mip) + p.x;
+	}
+
+private:
+	int m_max_mip, m_size;
+	std::vector<int> m_offsets;
+	std::vector<int> m_children;
+	std::vector<bool> m_resident;
+
+}; // Residency
+
+struct Swap
+{
+	textile::Page page;
+	bool add;
+	int mapping_x, mapping_y;
+};
+
+// one frame of swaps, as many adds as removes once the slots are full
+void make_swaps(Residency& res, int& resident_n, std::vector<textile::Page>& resident,
+                std::vector<Swap>& swaps)
+{
+	swaps.clear();
+	while (static_cast<int>(swaps.size()) < SWAPS)
+	{
+		const bool add = resident_n < SLOT_N && (resident_n < SLOT_N / 2 || rand_u32() % 2 == 0);
+		if (add)
+		{
+			auto page = res.RandomPage();
+			if (!res.CanAdd(page)) {
+				continue;
+			}
+			res.Set(page, true);
+			resident.push_back(page);
+			++resident_n;
+			swaps.push_back({ page, true, static_cast<int>(rand_u32() % 16), static_cast<int>(rand_u32() % 16) });
+		}
+		else
+		{
+			const size_t i = rand_u32() % resident.size();
+			auto page = resident[i];
+			if (!res.CanRemove(page)) {
+				continue;
+			}
+			res.Set(page, false);
+			resident[i] = resident.back();
+			resident.pop_back();
+			--resident_n;
+			swaps.push_back({ page, false, 0, 0 });
+		}
+	}
+}
+
+}
+
+int main()
+{
+	vtex::RecordingBackend backend(false);
+
+	vtex::PageTable flat(backend, TABLE_SIZE, TABLE_SIZE);
+	QuadTreeTable tree(backend, TABLE_SIZE, TABLE_SIZE);
+
+	// the top page is always resident
+	Residency res(TABLE_SIZE);
+	const textile::Page top(0, 0, res.GetMaxMip());
+	res.Set(top, true);
+	flat.AddPage(top, 0, 0);
+	tree.AddPage(top, 0, 0);
+
+	int resident_n = 0;
+	std::vector<textile::Page> resident;
+	std::vector<Swap> swaps;
+	swaps.reserve(SWAPS);
+
+	double flat_ms = 0, tree_ms = 0;
+	int mismatch_frames = 0;
+	for (int frame = 0; frame < FRAMES; ++frame)
+	{
+		make_swaps(res, resident_n, resident, swaps);
+
+		auto t0 = std::chrono::steady_clock::now();
+		for (auto& s : swaps) {
+			if (s.add) {
+				flat.AddPage(s.page, s.mapping_x, s.mapping_y);
+			} else {
+				flat.RemovePage(s.page);
+			}
+		}
+		flat.Update();
+
+		auto t1 = std::chrono::steady_clock::now();
+		for (auto& s : swaps) {
+			if (s.add) {
+				tree.AddPage(s.page, s.mapping_x, s.mapping_y);
+			} else {
+				tree.RemovePage(s.page);
+			}
+		}
+		tree.Update();
+
+		auto t2 = std::chrono::steady_clock::now();
+		flat_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+		tree_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+
+		for (int level = 0; level <= flat.GetMaxLevel(); ++level)
+		{
+			const int w = TABLE_SIZE >> level;
+			if (memcmp(flat.GetLevelData(level), tree.GetLevelData(level), w * w * 4) != 0) {
+				++mismatch_frames;
+				break;
+			}
+		}
+	}
+
+	printf("%d frames of %d swaps, %d pages resident\n", FRAMES, SWAPS, resident_n);
+	printf("flat     %.4f ms/frame\n", flat_ms / FRAMES);
+	printf("quadtree %.4f ms/frame\n", tree_ms / FRAMES);
+
+	if (mismatch_frames > 0) {
+		printf("FAILED: %d frames differ\n", mismatch_frames);
+		return 1;
+	}
+	return 0;
+}
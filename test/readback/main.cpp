@@ -0,0 +1,242 @@
+#include "vtex/FeedbackBuffer.h"
+#include "vtex/ReadbackRing.h"
+#include "vtex/RecordingBackend.h"
+#include "vtex/RequestTrace.h"
+#include "vtex/RequestTraceWriter.h"
+#include "vtex/VirtualTexture.h"
+#include "vtex/ImageSource.h"
+#include "vtex/Tiler.h"
+
+#include <textile/Page.h>
+#include <textile/PageIndexer.h>
+#include <textile/VTexInfo.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Feedback read back `latency` frames late on a RecordingBackend: frame
+// N's requests have to show up at frame N + latency, tagged with N, and
+// never the target drawn in between. Every frame's feedback requests
+// one page of its own, so a result from the wrong frame is seen.
+
+namespace
+{
+
+const int VTEX_SIZE   = 2048;
+const int TILE_SIZE   = 128;
+const int BORDER_SIZE = 4;
+const int SIZE        = 32;
+const int FRAMES      = 40;
+
+int g_failed = 0;
+
+void check(bool ok, const char* what, int latency)
+{
+	if (!ok) {
+		printf("FAILED: %s, latency %d\n", what, latency);
+		++g_failed;
+	}
+}
+
+// the level 0 page frame requests
+textile::Page frame_page(const textile::VTexInfo& info, uint64_t frame)
+{
+	const int w = info.PageTableWidth();
+	return textile::Page(static_cast<int>(frame % w), static_cast<int>(frame / w % info.PageTableHeight()), 0);
+}
+
+void fill_feedback(const textile::Page& page, std::vector<uint8_t>& pixels)
+{
+	for (size_t i = 0; i < pixels.size(); i += 4)
+	{
+		pixels[i + 0] = static_cast<uint8_t>(page.x);
+		pixels[i + 1] = static_cast<uint8_t>(page.y);
+		pixels[i + 2] = static_cast<uint8_t>(page.mip);
+		pixels[i + 3] = 255;
+	}
+}
+
+void test_ring(int latency)
+{
+	vtex::ReadbackRing ring(latency + 1, latency);
+	for (uint64_t frame = 0; frame < FRAMES; ++frame)
+	{
+		ring.Write(frame);
+
+		uint64_t src_frame = 0;
+		const int slot = ring.Read(frame, src_frame);
+		if (frame < static_cast<uint64_t>(latency)) {
+			check(slot < 0, "ring reads nothing while filling up", latency);
+		} else {
+			check(slot >= 0 && src_frame + latency == frame, "ring reads the frame latency ago", latency);
+		}
+	}
+	check(ring.GetDropCount() == 0, "ring drops nothing", latency);
+}
+
+void test_buffer(const textile::VTexInfo& info, const textile::PageIndexer& indexer, int latency, bool async)
+{
+	vtex::RecordingBackend backend;
+	vtex::FeedbackBuffer fb(backend, SIZE, info.PageTableWidth(), info.PageTableHeight(), indexer, latency);
+	fb.SetAsync(async);
+
+	std::vector<uint8_t> pixels(SIZE * SIZE * 4);
+	std::vector<uint8_t> other(SIZE * SIZE * 4);
+	fill_feedback(textile::Page(0, 0, 1), other);
+
+	int results = 0;
+	uint64_t last_frame = 0;
+	for (uint64_t frame = 0; frame < FRAMES; ++frame)
+	{
+		fb.BindRT(frame);
+		fill_feedback(frame_page(info, frame), pixels);
+		backend.DrawPixels(pixels.data(), SIZE, SIZE);
+		fb.UnbindRT();
+
+		// the frame's main pass, a readback of the current target
+		// would see it
+		if (latency > 0) {
+			backend.DrawPixels(other.data(), SIZE, SIZE);
+		}
+
+		const bool downloaded = fb.Download(frame);
+		// the worker finishes what it was handed before the next frame
+		fb.WaitAnalysis();
+		if (frame < static_cast<uint64_t>(latency))
+		{
+			check(!downloaded, "nothing is read back while the ring fills up", latency);
+			continue;
+		}
+		// async a frame only gets what the worker finished
+		check(downloaded || async, "a readback every frame once the ring is full", latency);
+		if (!downloaded) {
+			continue;
+		}
+
+		const uint64_t src_frame = fb.GetRequestsFrame();
+		if (async) {
+			check(src_frame + latency <= frame && (results == 0 || src_frame > last_frame),
+				"results are tagged with newer frames, at least latency old", latency);
+		} else {
+			check(src_frame + latency == frame, "requests are tagged with the frame latency ago", latency);
+		}
+		// every pixel, none of the target drawn since
+		check(fb.GetRequests().Get(indexer.CalcPageIdx(frame_page(info, src_frame))) == SIZE * SIZE,
+			"requests are the ones of their frame", latency);
+		fb.Clear();
+
+		++results;
+		last_frame = src_frame;
+	}
+	check(async ? results > 0 : results == FRAMES - latency, "one result per frame", latency);
+
+	printf("latency %d%s: %d results, %d readbacks, %d target binds\n", latency, async ? " async" : "",
+		results, backend.GetStats().readback_calls, backend.GetStats().target_binds);
+}
+
+class PatternImage : public vtex::ImageSource
+{
+public:
+	virtual int GetWidth() const override { return VTEX_SIZE; }
+	virtual int GetHeight() const override { return VTEX_SIZE; }
+
+	virtual bool ReadRows(int, int n, uint8_t* dst) override
+	{
+		memset(dst, 0x80, static_cast<size_t>(n) * VTEX_SIZE * 4);
+		return true;
+	}
+
+}; // PatternImage
+
+// Stream() hands the late feedback to Update(), the trace records what
+// it got, one frame per readback
+void test_texture(const std::string& filepath, const textile::VTexInfo& info,
+                  const textile::PageIndexer& indexer, int latency)
+{
+	const std::string trace_path = filepath + ".vttr";
+
+	auto backend = std::make_shared<vtex::RecordingBackend>();
+	vtex::PagePool::Config pool_cfg;
+	pool_cfg.atlas_size = info.PageSize() * 8;
+	auto pool = std::make_shared<vtex::PagePool>(backend, info.PageSize(), vtex::PageFormat::RGBA8, pool_cfg);
+
+	vtex::VirtualTextureConfig cfg;
+	cfg.feedback_size    = SIZE;
+	cfg.feedback_latency = latency;
+	cfg.feedback_async   = false;
+	{
+		vtex::VirtualTexture vt(filepath, info, pool, cfg);
+		vtex::RequestTraceWriter writer(trace_path, info);
+		vt.SetTraceWriter(&writer);
+
+		std::vector<uint8_t> pixels(SIZE * SIZE * 4);
+		std::vector<uint8_t> other(SIZE * SIZE * 4);
+		fill_feedback(textile::Page(0, 0, 1), other);
+		for (uint64_t frame = 0; frame < FRAMES; ++frame)
+		{
+			fill_feedback(frame_page(info, frame), pixels);
+			vt.Stream([&]() {
+				backend->DrawPixels(pixels.data(), SIZE, SIZE);
+			});
+			pool->Update();
+			if (latency > 0) {
+				backend->DrawPixels(other.data(), SIZE, SIZE);
+			}
+		}
+		vt.SetTraceWriter(nullptr);
+		check(writer.Finish(), "trace is written", latency);
+	}
+
+	vtex::RequestTrace trace(trace_path);
+	check(trace.IsValid(), "trace is read", latency);
+	auto& frames = trace.GetFrames();
+	check(static_cast<int>(frames.size()) == FRAMES - latency, "Update() gets one frame per readback", latency);
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		const int page_idx = indexer.CalcPageIdx(frame_page(info, i));
+		bool found = false;
+		for (auto& req : frames[i]) {
+			found = found || (req.page_idx == page_idx && req.count == SIZE * SIZE);
+		}
+		check(found, "Update() gets the frames in order", latency);
+	}
+
+	std::remove(trace_path.c_str());
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string filepath = argc > 1 ? argv[1] : "vtex_test_readback.vtex";
+
+	vtex::Tiler::Config tiler_cfg;
+	tiler_cfg.tile_size   = TILE_SIZE;
+	tiler_cfg.border_size = BORDER_SIZE;
+	tiler_cfg.format      = vtex::PageFormat::RGBA8;
+	PatternImage image;
+	if (!vtex::Tiler(tiler_cfg).Run(image, filepath)) {
+		printf("can't write %s\n", filepath.c_str());
+		return 1;
+	}
+	const auto info = vtex::Tiler::MakeInfo(VTEX_SIZE, VTEX_SIZE, TILE_SIZE, BORDER_SIZE);
+	textile::PageIndexer indexer(info);
+
+	for (int latency : { 0, 1, 2, 3 })
+	{
+		test_ring(latency);
+		test_buffer(info, indexer, latency, false);
+		test_buffer(info, indexer, latency, true);
+		test_texture(filepath, info, indexer, latency);
+	}
+
+	std::remove(filepath.c_str());
+
+	if (g_failed > 0) {
+		printf("%d checks failed\n", g_failed);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,252 @@
+#include "vtex/VirtualTexture.h"
+#include "vtex/RecordingBackend.h"
+#include "vtex/SoftRenderer.h"
+#include "vtex/ImageSource.h"
+#include "vtex/Tiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The whole loop without a GPU: SoftRenderer's feedback goes through
+// VirtualTexture::Stream() and PagePool::Update(), then RenderFinal()
+// samples the atlas through the PageTable. Once the pages are in, every
+// pixel has to match the source's mip chain sampled directly at the
+// level the feedback asked for, the source is noise so a wrong page,
+// level, layer or texel offset is seen. Fails if a view never does.
+
+namespace
+{
+
+const int VTEX_SIZE   = 2048;
+const int TILE_SIZE   = 128;
+const int BORDER_SIZE = 4;
+const int SIZE        = 256;
+const int MAX_FRAMES  = 300;
+// per channel, the atlas and the reference round texel centers apart
+const int TOLERANCE   = 2;
+
+int g_failed = 0;
+
+void check(bool ok, const char* what, int layers)
+{
+	if (!ok) {
+		printf("FAILED: %s, %d layers\n", what, layers);
+		++g_failed;
+	}
+}
+
+uint8_t noise(int x, int y, int c)
+{
+	uint32_t h = static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u ^ static_cast<uint32_t>(c) * 83492791u;
+	h ^= h >> 13;
+	h *= 0x5bd1e995u;
+	h ^= h >> 15;
+	return static_cast<uint8_t>(h);
+}
+
+class NoiseImage : public vtex::ImageSource
+{
+public:
+	virtual int GetWidth() const override { return VTEX_SIZE; }
+	virtual int GetHeight() const override { return VTEX_SIZE; }
+
+	virtual bool ReadRows(int y, int n, uint8_t* dst) override
+	{
+		for (int row = y; row < y + n; ++row) {
+			for (int x = 0; x < VTEX_SIZE; ++x, dst += 4) {
+				dst[0] = noise(x, row, 0);
+				dst[1] = noise(x, row, 1);
+				dst[2] = noise(x, row, 2);
+				dst[3] = 255;
+			}
+		}
+		return true;
+	}
+
+}; // NoiseImage
+
+// the levels the Tiler writes, with its 2x2 box filter
+std::vector<std::vector<uint8_t>> build_mips()
+{
+	std::vector<std::vector<uint8_t>> mips(1);
+	NoiseImage image;
+	mips[0].resize(static_cast<size_t>(VTEX_SIZE) * VTEX_SIZE * 4);
+	image.ReadRows(0, VTEX_SIZE, mips[0].data());
+	for (int size = VTEX_SIZE / 2; size >= TILE_SIZE; size /= 2)
+	{
+		auto& src = mips.back();
+		std::vector<uint8_t> dst(static_cast<size_t>(size) * size * 4);
+		for (int y = 0; y < size; ++y) {
+			for (int x = 0; x < size; ++x) {
+				for (int c = 0; c < 4; ++c) {
+					auto texel = [&](int dx, int dy) {
+						return src[((static_cast<size_t>(y) * 2 + dy) * size * 2 + x * 2 + dx) * 4 + c];
+					};
+					const int sum = texel(0, 0) + texel(1, 0) + texel(0, 1) + texel(1, 1);
+					dst[(static_cast<size_t>(y) * size + x) * 4 + c] = static_cast<uint8_t>((sum + 2) >> 2);
+				}
+			}
+		}
+		mips.push_back(std::move(dst));
+	}
+	return mips;
+}
+
+// SoftRenderer's bilinear sample, clamped to the level's edge like the
+// Tiler's borders
+void sample_bilinear(const uint8_t* img, int size, float u, float v, uint8_t* dst)
+{
+	float fx = u * size - 0.5f;
+	float fy = v * size - 0.5f;
+	int x0 = static_cast<int>(std::floor(fx));
+	int y0 = static_cast<int>(std::floor(fy));
+	float tx = fx - x0;
+	float ty = fy - y0;
+
+	auto texel = [&](int x, int y) {
+		x = std::min(std::max(x, 0), size - 1);
+		y = std::min(std::max(y, 0), size - 1);
+		return img + (static_cast<size_t>(y) * size + x) * 4;
+	};
+	for (int c = 0; c < 4; ++c)
+	{
+		float top = texel(x0, y0)[c] + (texel(x0 + 1, y0)[c] - texel(x0, y0)[c]) * tx;
+		float bot = texel(x0, y0 + 1)[c] + (texel(x0 + 1, y0 + 1)[c] - texel(x0, y0 + 1)[c]) * tx;
+		dst[c] = static_cast<uint8_t>(top + (bot - top) * ty + 0.5f);
+	}
+}
+
+// the frame the final pass should draw, at the levels of the feedback
+// of the same uv buffer
+void render_reference(const vtex::UvBuffer& uv, const uint8_t* feedback,
+                      const std::vector<std::vector<uint8_t>>& mips, uint8_t* dst)
+{
+	for (size_t i = 0, n = static_cast<size_t>(uv.width) * uv.height; i < n; ++i)
+	{
+		if (!uv.covered[i]) {
+			std::fill(dst + i * 4, dst + i * 4 + 4, 0);
+			continue;
+		}
+		const int level = feedback[i * 4 + 2];
+		sample_bilinear(mips[level].data(), VTEX_SIZE >> level, uv.uv[i * 2], uv.uv[i * 2 + 1], dst + i * 4);
+	}
+}
+
+int count_mismatches(const uint8_t* a, const uint8_t* b, size_t pixel_n)
+{
+	int n = 0;
+	for (size_t i = 0; i < pixel_n * 4; ++i) {
+		if (std::abs(a[i] - b[i]) > TOLERANCE) {
+			++n;
+			i = i / 4 * 4 + 3;
+		}
+	}
+	return n;
+}
+
+void test_views(const std::string& filepath, const textile::VTexInfo& info,
+                const std::vector<std::vector<uint8_t>>& mips, int layers)
+{
+	auto backend = std::make_shared<vtex::RecordingBackend>();
+	vtex::PagePool::Config pool_cfg;
+	// room for the 24 pages of the largest view, fewer than two views'
+	// pages, they evict each other's
+	pool_cfg.atlas_size   = info.PageSize() * (layers == 1 ? 6 : 4);
+	pool_cfg.atlas_layers = layers;
+	auto pool = std::make_shared<vtex::PagePool>(backend, info.PageSize(), vtex::PageFormat::RGBA8, pool_cfg);
+	pool->GetAtlas().EnableShadow();
+
+	vtex::VirtualTextureConfig cfg;
+	cfg.feedback_size    = SIZE;
+	cfg.feedback_latency = 0;
+	cfg.feedback_async   = false;
+	// the final pass is drawn at the feedback's size
+	cfg.mip_bias = 0;
+	cfg.mip_bias_control.min_bias = 0;
+	cfg.mip_bias_control.max_bias = 0;
+	vtex::VirtualTexture vt(filepath, info, pool, cfg);
+
+	vtex::SoftRenderer renderer;
+	vtex::UvBuffer uv;
+	uv.Resize(SIZE, SIZE);
+	auto params = vtex::SoftRenderer::MakeParams(info, pool_cfg.atlas_size, 0);
+
+	const size_t pixel_n = static_cast<size_t>(SIZE) * SIZE;
+	std::vector<uint8_t> feedback(pixel_n * 4), ref(pixel_n * 4), final(pixel_n * 4);
+
+	const float views[][4] = {
+		{ 0.5f, -0.2f, 0.05f, 0.6f },
+		{ 0.3f, -0.1f, 0.01f, 0.3f },
+		{ 0.2f,  0.1f, 0.20f, 1.2f },
+		{ 0.7f,  0.4f, 0.25f, 1.4f },
+		{ 0.5f, -0.2f, 0.05f, 0.6f },
+	};
+	for (auto& view : views)
+	{
+		uv.FillPlane(view[0], view[1], view[2], view[3], 1.0f);
+		renderer.RenderFeedback(uv, params, feedback.data());
+		render_reference(uv, feedback.data(), mips, ref.data());
+
+		int frames = 0, mismatches = 0;
+		for (; frames < MAX_FRAMES; ++frames)
+		{
+			vt.Stream([&]() {
+				backend->DrawPixels(feedback.data(), SIZE, SIZE);
+			});
+			pool->Update();
+
+			renderer.RenderFinal(uv, params, vt.GetPageTable(), pool->GetAtlas().GetShadow(), final.data());
+			mismatches = count_mismatches(final.data(), ref.data(), pixel_n);
+			if (mismatches == 0) {
+				break;
+			}
+			// the loader threads
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		printf("%d layers, view (%.2f, %.2f, %.2f): %d frames, %d pixels differ\n",
+			layers, view[0], view[1], view[2], frames + 1, mismatches);
+		check(mismatches == 0, "the final pass draws the source at the requested levels", layers);
+	}
+
+	const auto& totals = vt.GetTelemetry().GetTotals();
+	printf("%d layers: %lld pages loaded, %lld evicted\n", layers,
+		static_cast<long long>(totals.loaded), static_cast<long long>(totals.evicted));
+	check(totals.evicted > 0, "the views reuse slots", layers);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	const std::string filepath = argc > 1 ? argv[1] : "vtex_test_render.vtex";
+
+	vtex::Tiler::Config tiler_cfg;
+	tiler_cfg.tile_size   = TILE_SIZE;
+	tiler_cfg.border_size = BORDER_SIZE;
+	tiler_cfg.format      = vtex::PageFormat::RGBA8;
+	NoiseImage image;
+	if (!vtex::Tiler(tiler_cfg).Run(image, filepath)) {
+		printf("can't write %s\n", filepath.c_str());
+		return 1;
+	}
+	const auto info = vtex::Tiler::MakeInfo(VTEX_SIZE, VTEX_SIZE, TILE_SIZE, BORDER_SIZE);
+	const auto mips = build_mips();
+
+	for (int layers : { 1, 2 }) {
+		test_views(filepath, info, mips, layers);
+	}
+
+	std::remove(filepath.c_str());
+
+	if (g_failed > 0) {
+		printf("%d checks failed\n", g_failed);
+		return 1;
+	}
+	return 0;
+}
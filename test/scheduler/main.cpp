@@ -0,0 +1,174 @@
+#include "vtex/UploadScheduler.h"
+
+#include <cmath>
+#include <cstdio>
+
+// UploadScheduler on a simulated clock: every upload advances it by a
+// set cost, so the pages a frame gets are exact. Checks the budgets,
+// the page limits, how fast the estimate follows a changed cost, and
+// the deferred count of a burst of finished pages like a camera cut.
+
+namespace
+{
+
+const size_t PAGE_BYTES = 136 * 136 * 4;
+
+double g_now = 0;
+
+int g_failed = 0;
+
+void check(bool ok, const char* what)
+{
+	if (!ok) {
+		printf("FAILED: %s\n", what);
+		++g_failed;
+	}
+}
+
+struct Costs
+{
+	// of one page, the clock advances by it
+	double upload_ms = 0.25;
+	// of the frame's flush, per page, measured outside the frame
+	double flush_ms = 0;
+};
+
+// one frame of AsyncPageLoader::Drain() and the flush after it, ready
+// pages are waiting, returns the pages uploaded
+int run_frame(vtex::UploadScheduler& sched, int& ready, const Costs& costs)
+{
+	sched.BeginFrame();
+	int pages = 0;
+	while (ready > 0 && sched.CanUpload(PAGE_BYTES))
+	{
+		sched.BeginUpload();
+		g_now += costs.upload_ms;
+		sched.EndUpload(PAGE_BYTES);
+		--ready;
+		++pages;
+	}
+	sched.EndFrame(ready);
+
+	const double flush_ms = costs.flush_ms * pages;
+	g_now += flush_ms;
+	sched.RecordFlush(pages * PAGE_BYTES, static_cast<float>(flush_ms));
+
+	// the rest of the frame
+	g_now += 10;
+
+	return pages;
+}
+
+// pages of the last of `frames` frames with more pages ready than fit
+int steady_pages(vtex::UploadScheduler& sched, const Costs& costs, int frames)
+{
+	int pages = 0;
+	for (int i = 0; i < frames; ++i) {
+		int ready = 1000;
+		pages = run_frame(sched, ready, costs);
+	}
+	return pages;
+}
+
+vtex::UploadScheduler::Clock clock()
+{
+	return []() { return g_now; };
+}
+
+void test_ms_budget()
+{
+	// a little over whole pages, the predictions are not exact
+	vtex::UploadScheduler::Config cfg;
+	cfg.budget_ms = 2.1f;
+	vtex::UploadScheduler sched(cfg, clock());
+
+	Costs costs;
+	check(steady_pages(sched, costs, 4) == 8, "2.1 ms of 0.25 ms pages is 8 pages");
+	check(sched.GetFrameMs() <= cfg.budget_ms, "the frame stays in the budget");
+
+	// twice as slow, the smoothed estimate follows within a few frames
+	costs.upload_ms = 0.5;
+	int frames = 0;
+	while (frames < 30 && steady_pages(sched, costs, 1) != 4) {
+		++frames;
+	}
+	printf("cost doubled: %d frames to settle at %d pages\n", frames + 1, sched.GetFramePages());
+	check(sched.GetFramePages() == 4 && frames < 10, "a doubled cost halves the pages within 10 frames");
+	check(sched.GetFrameMs() <= cfg.budget_ms, "the frame stays in the budget after the change");
+
+	// the flush is paid after the uploads but counts against the
+	// budget, for every page staged
+	costs.upload_ms = 0.25;
+	costs.flush_ms = 0.25;
+	const int pages = steady_pages(sched, costs, 30);
+	check(pages == 4, "the flush cost is added to a page's");
+	check(pages * (costs.upload_ms + costs.flush_ms) <= cfg.budget_ms, "uploads and flush stay in the budget");
+}
+
+void test_byte_budget()
+{
+	vtex::UploadScheduler::Config cfg;
+	cfg.budget_ms = 0;
+	cfg.budget_bytes = PAGE_BYTES * 3;
+	vtex::UploadScheduler sched(cfg, clock());
+
+	check(steady_pages(sched, Costs(), 3) == 3, "the byte budget fits 3 pages");
+	check(sched.GetFrameBytes() <= cfg.budget_bytes, "the frame stays in the byte budget");
+}
+
+void test_limits()
+{
+	vtex::UploadScheduler::Config cfg;
+	cfg.budget_ms = 1.0f;
+	cfg.min_pages = 2;
+	cfg.max_pages = 6;
+	vtex::UploadScheduler sched(cfg, clock());
+
+	Costs costs;
+	costs.upload_ms = 5;
+	check(steady_pages(sched, costs, 3) == 2, "min_pages are uploaded over budget");
+
+	costs.upload_ms = 0.01;
+	check(steady_pages(sched, costs, 30) == 6, "no more than max_pages");
+}
+
+// a camera cut finishes 100 pages at once, they are spread over frames
+// and reported deferred until they are in
+void test_burst()
+{
+	vtex::UploadScheduler::Config cfg;
+	cfg.budget_ms = 2.1f;
+	vtex::UploadScheduler sched(cfg, clock());
+
+	Costs costs;
+	steady_pages(sched, costs, 4);
+
+	int ready = 100;
+	int frames = 0;
+	bool deferred_ok = true;
+	while (ready > 0 && frames < 100)
+	{
+		run_frame(sched, ready, costs);
+		deferred_ok = deferred_ok && sched.GetDeferredCount() == ready;
+		++frames;
+	}
+	printf("burst of 100 pages: %d frames at 2.1 ms, %d at 5 pages a frame\n", frames, (100 + 4) / 5);
+	check(deferred_ok, "the pages left are reported deferred");
+	check(frames == static_cast<int>(std::ceil(100 / 8.0)), "the burst takes 100 / 8 frames");
+}
+
+}
+
+int main()
+{
+	test_ms_budget();
+	test_byte_budget();
+	test_limits();
+	test_burst();
+
+	if (g_failed > 0) {
+		printf("%d checks failed\n", g_failed);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include "vtex/TraceReplayer.h"
+#include "vtex/RequestTrace.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+void print_usage()
+{
+	printf("usage: vtex_replay <trace> <src.vtex> [options]\n"
+	       "  --atlas <n>      atlas size in texels, default 4096\n"
+	       "  --layers <n>     atlas layers, default 1\n"
+	       "  --policy <name>  lru, clock, lfu or all, default lru\n"
+	       "  --uploads <n>    uploads per frame, default the time budget\n"
+	       "  --async          don't wait for a frame's loads\n");
+}
+
+bool parse_policy(const char* str, std::vector<vtex::ReplacementPolicyType>& policies)
+{
+	struct Item { const char* name; vtex::ReplacementPolicyType type; };
+	static const Item ITEMS[] = {
+		{ "lru",   vtex::ReplacementPolicyType::LRU },
+		{ "clock", vtex::ReplacementPolicyType::CLOCK },
+		{ "lfu",   vtex::ReplacementPolicyType::LFU },
+	};
+
+	policies.clear();
+	for (auto& item : ITEMS) {
+		if (strcmp(str, "all") == 0 || strcmp(str, item.name) == 0) {
+			policies.push_back(item.type);
+		}
+	}
+	return !policies.empty();
+}
+
+void print_result(const vtex::TraceReplayer::Result& r)
+{
+	printf("%s: %d frames in %.2f s, %.0f frames/s, update %.3f ms/frame\n",
+		r.policy.c_str(), r.frames, r.seconds, r.FramesPerSecond(), r.update_ms);
+	printf("  hit rate %.2f%% (%lld of %lld), %lld loads, %lld evictions\n",
+		r.HitRate() * 100, static_cast<long long>(r.hits), static_cast<long long>(r.requests),
+		static_cast<long long>(r.loads), static_cast<long long>(r.evictions));
+	printf("  load latency in frames: p50 %d, p95 %d, p99 %d, %d abandoned\n",
+		r.LatencyPercentile(0.5f), r.LatencyPercentile(0.95f), r.LatencyPercentile(0.99f), r.abandoned);
+	printf("  fallback mips in %d frames, %lld page frames\n",
+		r.fallback_frames, static_cast<long long>(r.fallback_pages));
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3) {
+		print_usage();
+		return 1;
+	}
+
+	const std::string trace_path = argv[1];
+	const std::string vtex_path  = argv[2];
+
+	vtex::TraceReplayer::Config cfg;
+	std::vector<vtex::ReplacementPolicyType> policies = { cfg.policy };
+	for (int i = 3; i < argc; ++i)
+	{
+		const char* key = argv[i];
+		if (strcmp(key, "--async") == 0) {
+			cfg.wait_loads = false;
+			continue;
+		}
+
+		const char* val = i + 1 < argc ? argv[++i] : "";
+		if (strcmp(key, "--atlas") == 0) {
+			cfg.atlas_size = atoi(val);
+		} else if (strcmp(key, "--layers") == 0) {
+			cfg.atlas_layers = atoi(val);
+		} else if (strcmp(key, "--uploads") == 0) {
+			cfg.uploads_per_frame = atoi(val);
+		} else if (strcmp(key, "--policy") != 0 || !parse_policy(val, policies)) {
+			print_usage();
+			return 1;
+		}
+	}
+
+	vtex::RequestTrace trace(trace_path);
+	if (!trace.IsValid()) {
+		fprintf(stderr, "can't read %s\n", trace_path.c_str());
+		return 1;
+	}
+
+	for (auto policy : policies)
+	{
+		cfg.policy = policy;
+
+		vtex::TraceReplayer::Result result;
+		if (!vtex::TraceReplayer(cfg).Run(trace, vtex_path, result)) {
+			fprintf(stderr, "can't replay %s on %s\n", trace_path.c_str(), vtex_path.c_str());
+			return 1;
+		}
+		print_result(result);
+	}
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+#include "vtex/Tiler.h"
+#include "vtex/RawImageFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace
+{
+
+void print_usage()
+{
+	printf("usage: vtex_tiler <src.raw> <width> <height> <channels> <dst.vtex> [options]\n"
+	       "  the source has to be square, its width a power of 2 times the tile size\n"
+	       "  dst is a vtex page file, textile::PageLoader can't read it\n"
+	       "  --tile <n>       tile size, default 128\n"
+	       "  --border <n>     border size, default 4\n"
+	       "  --format <fmt>   r8, rg8, rgb8, rgba8, bc1, bc3 or bc7, default bc1\n"
+	       "  --threads <n>    default one per hardware thread\n");
+}
+
+bool parse_format(const char* str, vtex::PageFormat& fmt)
+{
+	struct Item { const char* name; vtex::PageFormat fmt; };
+	static const Item ITEMS[] = {
+		{ "r8",    vtex::PageFormat::R8 },
+		{ "rg8",   vtex::PageFormat::RG8 },
+		{ "rgb8",  vtex::PageFormat::RGB8 },
+		{ "rgba8", vtex::PageFormat::RGBA8 },
+		{ "bc1",   vtex::PageFormat::BC1 },
+		{ "bc3",   vtex::PageFormat::BC3 },
+		{ "bc7",   vtex::PageFormat::BC7 },
+	};
+	for (auto& item : ITEMS) {
+		if (strcmp(str, item.name) == 0) {
+			fmt = item.fmt;
+			return true;
+		}
+	}
+	return false;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 6) {
+		print_usage();
+		return 1;
+	}
+
+	const std::string src_path = argv[1];
+	const int width    = atoi(argv[2]);
+	const int height   = atoi(argv[3]);
+	const int channels = atoi(argv[4]);
+	const std::string dst_path = argv[5];
+
+	vtex::Tiler::Config cfg;
+	for (int i = 6; i + 1 < argc; i += 2)
+	{
+		const char* key = argv[i];
+		const char* val = argv[i + 1];
+		if (strcmp(key, "--tile") == 0) {
+			cfg.tile_size = atoi(val);
+		} else if (strcmp(key, "--border") == 0) {
+			cfg.border_size = atoi(val);
+		} else if (strcmp(key, "--threads") == 0) {
+			cfg.thread_n = atoi(val);
+		} else if (strcmp(key, "--format") != 0 || !parse_format(val, cfg.format)) {
+			print_usage();
+			return 1;
+		}
+	}
+
+	const int tiles = cfg.tile_size > 0 ? width / cfg.tile_size : 0;
+	if (width != height || tiles <= 0 || width % cfg.tile_size != 0 || (tiles & (tiles - 1)) != 0) {
+		fprintf(stderr, "%dx%d is not square with a power of 2 tiles of %d a side\n", width, height, cfg.tile_size);
+		return 1;
+	}
+
+	vtex::RawImageFile src(src_path, width, height, channels);
+	if (!src.IsValid()) {
+		fprintf(stderr, "can't open %s\n", src_path.c_str());
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	vtex::Tiler tiler(cfg);
+	if (!tiler.Run(src, dst_path)) {
+		fprintf(stderr, "failed to write %s\n", dst_path.c_str());
+		return 1;
+	}
+
+	std::chrono::duration<double> dt = std::chrono::steady_clock::now() - start;
+	auto& stats = tiler.GetStats();
+	printf("%d levels, %d pages, %.1f MB in %.1f s\n", stats.levels, stats.pages,
+		stats.bytes / (1024.0 * 1024.0), dt.count());
+
+	return 0;
+}